@@ -0,0 +1,95 @@
+// Runtime selection of a BasicProjector specialization.
+#include "basic_projector.h"
+
+#include <string>
+
+namespace roi_projector {
+
+namespace {
+
+template <class Scalar>
+constexpr const char* ScalarName() {
+  return std::is_same<Scalar, float>::value ? "float" : "double";
+}
+
+template <class Scalar, class Dist1Model, class Dist2Model>
+class SpecializedProjector final : public ProjectorHandle {
+ public:
+  explicit SpecializedProjector(const CompiledCalibration& calib)
+      : projector_(calib),
+        name_(std::string(ScalarName<Scalar>()) + "/" + Dist1Model::kName +
+              "/" + Dist2Model::kName) {}
+
+  size_t ProjectPoints(const Point3D* points, size_t count, Point2D* out,
+                       ProjectStatus* status) const noexcept override {
+    return projector_.ProjectPoints(points, count, out, status);
+  }
+
+  const char* Name() const override { return name_.c_str(); }
+
+ private:
+  BasicProjector<Scalar, Dist1Model, Dist2Model> projector_;
+  std::string name_;
+};
+
+enum class DistortionKind { kNone, kRadial, kBrownConrady };
+
+DistortionKind Classify(bool has_dist, const double dist[5]) {
+  if (!has_dist) {
+    return DistortionKind::kNone;
+  }
+  if (dist[2] == 0.0 && dist[3] == 0.0) {
+    return DistortionKind::kRadial;
+  }
+  return DistortionKind::kBrownConrady;
+}
+
+template <class Scalar, class Dist1Model>
+std::unique_ptr<ProjectorHandle> MakeWithDist2(const CompiledCalibration& c,
+                                               DistortionKind dist2) {
+  switch (dist2) {
+    case DistortionKind::kNone:
+      return std::make_unique<
+          SpecializedProjector<Scalar, Dist1Model, NoDistortion>>(c);
+    case DistortionKind::kRadial:
+      return std::make_unique<
+          SpecializedProjector<Scalar, Dist1Model, RadialDistortion>>(c);
+    case DistortionKind::kBrownConrady:
+      break;
+  }
+  return std::make_unique<
+      SpecializedProjector<Scalar, Dist1Model, BrownConrady>>(c);
+}
+
+template <class Scalar>
+std::unique_ptr<ProjectorHandle> MakeWithScalar(const CompiledCalibration& c,
+                                                DistortionKind dist1,
+                                                DistortionKind dist2) {
+  switch (dist1) {
+    case DistortionKind::kNone:
+      return MakeWithDist2<Scalar, NoDistortion>(c, dist2);
+    case DistortionKind::kRadial:
+      return MakeWithDist2<Scalar, RadialDistortion>(c, dist2);
+    case DistortionKind::kBrownConrady:
+      break;
+  }
+  return MakeWithDist2<Scalar, BrownConrady>(c, dist2);
+}
+
+}  // namespace
+
+std::unique_ptr<ProjectorHandle> MakeSpecializedProjector(
+    const Projector& projector, bool use_float) {
+  if (!projector.has_calibration()) {
+    return nullptr;
+  }
+  const CompiledCalibration& c = projector.compiled_calibration();
+  const DistortionKind dist1 = Classify(c.has_dist1, c.dist1);
+  const DistortionKind dist2 = Classify(c.has_dist2, c.dist2);
+  if (use_float) {
+    return MakeWithScalar<float>(c, dist1, dist2);
+  }
+  return MakeWithScalar<double>(c, dist1, dist2);
+}
+
+}  // namespace roi_projector
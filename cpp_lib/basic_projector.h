@@ -0,0 +1,230 @@
+// Projector specialized at compile time on scalar type and distortion model.
+// MakeSpecializedProjector inspects a loaded Projector and returns the
+// tightest specialization behind a type-erased handle, so per-point
+// distortion checks disappear from the hot loop.
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+#include "roi_projector.h"
+
+namespace roi_projector {
+
+// Distortion models, from cheapest to most general.
+struct NoDistortion {
+  static constexpr const char* kName = "none";
+};
+struct RadialDistortion {  // k1, k2, k3; p1 = p2 = 0
+  static constexpr const char* kName = "radial";
+};
+struct BrownConrady {  // k1, k2, p1, p2, k3
+  static constexpr const char* kName = "brown-conrady";
+};
+
+template <class Scalar, class Dist1Model, class Dist2Model>
+class BasicProjector {
+  static_assert(std::is_floating_point<Scalar>::value,
+                "Scalar must be float or double");
+
+ public:
+  explicit BasicProjector(const CompiledCalibration& calib)
+      : inv_fx1_(static_cast<Scalar>(calib.inv_fx1)),
+        inv_fy1_(static_cast<Scalar>(calib.inv_fy1)),
+        cx1_(static_cast<Scalar>(calib.cx1)),
+        cy1_(static_cast<Scalar>(calib.cy1)),
+        fx2_(static_cast<Scalar>(calib.fx2)),
+        fy2_(static_cast<Scalar>(calib.fy2)),
+        cx2_(static_cast<Scalar>(calib.cx2)),
+        cy2_(static_cast<Scalar>(calib.cy2)),
+        lut1_(std::is_same<Dist1Model, NoDistortion>::value ? nullptr
+                                                            : calib.lut1),
+        max_iterations_(calib.undistort_max_iterations),
+        tolerance2_(Square(std::max(
+            static_cast<Scalar>(calib.undistort_tolerance),
+            Scalar(16) * std::numeric_limits<Scalar>::epsilon()))) {
+    // Pinhole camera2 uses the K2-folded matrix.
+    const auto& m = std::is_same<Dist2Model, NoDistortion>::value ? calib.k2rt
+                                                                  : calib.rt;
+    for (size_t r = 0; r < 3; ++r) {
+      for (size_t c = 0; c < 4; ++c) {
+        m_[r][c] = static_cast<Scalar>(m[r][c]);
+      }
+    }
+    for (size_t i = 0; i < 5; ++i) {
+      dist1_[i] = static_cast<Scalar>(calib.dist1[i]);
+      dist2_[i] = static_cast<Scalar>(calib.dist2[i]);
+    }
+  }
+
+  ProjectStatus Project(Scalar u, Scalar v, Scalar depth, Scalar& out_u,
+                        Scalar& out_v) const noexcept {
+    if (!(depth > Scalar(0)) || !std::isfinite(depth)) {
+      return ProjectStatus::kInvalidDepth;
+    }
+    Scalar x_norm = (u - cx1_) * inv_fx1_;
+    Scalar y_norm = (v - cy1_) * inv_fy1_;
+    if constexpr (!std::is_same<Dist1Model, NoDistortion>::value) {
+      double lut_x = 0.0;
+      double lut_y = 0.0;
+      if (lut1_ != nullptr && lut1_->Sample(u, v, lut_x, lut_y)) {
+        x_norm = static_cast<Scalar>(lut_x);
+        y_norm = static_cast<Scalar>(lut_y);
+      } else if (!Undistort(x_norm, y_norm)) {
+        return ProjectStatus::kUndistortDiverged;
+      }
+    }
+
+    const Scalar x = x_norm * depth;
+    const Scalar y = y_norm * depth;
+    const Scalar z = depth;
+    const Scalar x2 = m_[0][0] * x + m_[0][1] * y + m_[0][2] * z + m_[0][3];
+    const Scalar y2 = m_[1][0] * x + m_[1][1] * y + m_[1][2] * z + m_[1][3];
+    const Scalar z2 = m_[2][0] * x + m_[2][1] * y + m_[2][2] * z + m_[2][3];
+    if (!(z2 > Scalar(0)) || !std::isfinite(z2)) {
+      return ProjectStatus::kProjectionFailed;
+    }
+
+    if constexpr (std::is_same<Dist2Model, NoDistortion>::value) {
+      out_u = x2 / z2;
+      out_v = y2 / z2;
+    } else {
+      Scalar xd = x2 / z2;
+      Scalar yd = y2 / z2;
+      DistortWith<Dist2Model>(dist2_, xd, yd);
+      out_u = fx2_ * xd + cx2_;
+      out_v = fy2_ * yd + cy2_;
+    }
+    return (std::isfinite(out_u) && std::isfinite(out_v))
+               ? ProjectStatus::kOk
+               : ProjectStatus::kProjectionFailed;
+  }
+
+  // Same contract as Projector::ProjectPoints (AoS layout).
+  size_t ProjectPoints(const Point3D* points, size_t count, Point2D* out,
+                       ProjectStatus* status) const noexcept {
+    size_t ok_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+      Scalar ou = 0;
+      Scalar ov = 0;
+      const ProjectStatus st =
+          Project(static_cast<Scalar>(points[i].u),
+                  static_cast<Scalar>(points[i].v),
+                  static_cast<Scalar>(points[i].z), ou, ov);
+      if (st == ProjectStatus::kOk) {
+        out[i].u = ou;
+        out[i].v = ov;
+        ++ok_count;
+      } else {
+        out[i].u = std::numeric_limits<double>::quiet_NaN();
+        out[i].v = std::numeric_limits<double>::quiet_NaN();
+      }
+      if (status != nullptr) {
+        status[i] = st;
+      }
+    }
+    return ok_count;
+  }
+
+ private:
+  static Scalar Square(Scalar x) noexcept { return x * x; }
+
+  // Forward distortion; tangential terms are compiled out unless `Model` is
+  // BrownConrady.
+  template <class Model>
+  static void DistortWith(const Scalar* dist, Scalar& x, Scalar& y) noexcept {
+    const Scalar r2 = x * x + y * y;
+    const Scalar radial =
+        Scalar(1) + dist[0] * r2 + dist[1] * r2 * r2 + dist[4] * r2 * r2 * r2;
+    Scalar xd = x * radial;
+    Scalar yd = y * radial;
+    if constexpr (std::is_same<Model, BrownConrady>::value) {
+      xd += Scalar(2) * dist[2] * x * y + dist[3] * (r2 + Scalar(2) * x * x);
+      yd += dist[2] * (r2 + Scalar(2) * y * y) + Scalar(2) * dist[3] * x * y;
+    }
+    x = xd;
+    y = yd;
+  }
+
+  // Newton inverse of the camera1 distortion (see projection_kernel.h).
+  bool Undistort(Scalar& x_io, Scalar& y_io) const noexcept {
+    const Scalar* d = dist1_;
+    const Scalar xd = x_io;
+    const Scalar yd = y_io;
+    Scalar x = xd;
+    Scalar y = yd;
+    for (int step = 0;; ++step) {
+      Scalar fx = x;
+      Scalar fy = y;
+      DistortWith<Dist1Model>(d, fx, fy);
+      const Scalar res_x = fx - xd;
+      const Scalar res_y = fy - yd;
+      if (res_x * res_x + res_y * res_y < tolerance2_) {
+        x_io = x;
+        y_io = y;
+        return true;
+      }
+      if (step == max_iterations_) {
+        return false;
+      }
+      const Scalar r2 = x * x + y * y;
+      const Scalar radial =
+          Scalar(1) + d[0] * r2 + d[1] * r2 * r2 + d[4] * r2 * r2 * r2;
+      const Scalar d_radial =
+          d[0] + Scalar(2) * d[1] * r2 + Scalar(3) * d[4] * r2 * r2;
+      Scalar a = radial + Scalar(2) * x * x * d_radial;
+      Scalar b = Scalar(2) * x * y * d_radial;
+      Scalar c = radial + Scalar(2) * y * y * d_radial;
+      if constexpr (std::is_same<Dist1Model, BrownConrady>::value) {
+        a += Scalar(2) * d[2] * y + Scalar(6) * d[3] * x;
+        b += Scalar(2) * d[2] * x + Scalar(2) * d[3] * y;
+        c += Scalar(6) * d[2] * y + Scalar(2) * d[3] * x;
+      }
+      const Scalar det = a * c - b * b;
+      x -= (c * res_x - b * res_y) / det;
+      y -= (a * res_y - b * res_x) / det;
+      if (!std::isfinite(x) || !std::isfinite(y)) {
+        return false;
+      }
+    }
+  }
+
+  Scalar inv_fx1_;
+  Scalar inv_fy1_;
+  Scalar cx1_;
+  Scalar cy1_;
+  Scalar fx2_;
+  Scalar fy2_;
+  Scalar cx2_;
+  Scalar cy2_;
+  Scalar m_[3][4] = {};  // R|t, or K2 * R|t for a pinhole camera2
+  Scalar dist1_[5] = {};
+  Scalar dist2_[5] = {};
+  const UndistortLut* lut1_;
+  int max_iterations_;
+  Scalar tolerance2_;
+};
+
+// Type-erased BasicProjector.
+class ProjectorHandle {
+ public:
+  virtual ~ProjectorHandle() = default;
+  virtual size_t ProjectPoints(const Point3D* points, size_t count,
+                               Point2D* out,
+                               ProjectStatus* status) const noexcept = 0;
+  // e.g. "double/brown-conrady/radial" (scalar/camera1/camera2).
+  virtual const char* Name() const = 0;
+};
+
+// Picks the distortion model of each camera from the loaded coefficients
+// (all zero -> none, p1 = p2 = 0 -> radial, else Brown-Conrady).
+// The handle shares the projector's undistortion table, which must outlive
+// it. Returns null if `projector` has no calibration loaded.
+std::unique_ptr<ProjectorHandle> MakeSpecializedProjector(
+    const Projector& projector, bool use_float = false);
+
+}  // namespace roi_projector
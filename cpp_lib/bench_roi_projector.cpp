@@ -0,0 +1,1253 @@
+// Micro-benchmarks for roi_projector.
+// Usage: roi_projector_bench [calib.json] [name_filter]
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "basic_projector.h"
+#include "calibration_binary.h"
+#include "calibration_json.h"
+#include "calibration_reload.h"
+#include "depth_integral.h"
+#include "depth_pyramid.h"
+#include "depth_sampler.h"
+#include "roi_assigner.h"
+#include "roi_coverage.h"
+#include "roi_projector.h"
+#include "roi_raster.h"
+#include "roi_trace.h"
+#if defined(ROI_PROJECTOR_BENCH_STATIC_CALIBRATION)
+#include "static_projector.h"
+#include "test_calibration.h"
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchContext {
+  roi_projector::Projector projector;
+  std::string calib_path;
+};
+
+// Keeps results observable so the optimizer cannot drop the measured work.
+volatile double g_sink = 0.0;
+
+double SecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void Report(const char* name, double items, const char* unit, double seconds) {
+  std::cout << "  " << name << ": " << (items / seconds / 1e6) << " M" << unit
+            << "/s (" << (seconds * 1e9 / items) << " ns/" << unit << ")\n";
+}
+
+// Grid of (u,v,z) samples covering the 1920x1200 3D camera image.
+std::vector<roi_projector::Point3D> MakeSamples(size_t count) {
+  std::vector<roi_projector::Point3D> pts(count);
+  for (size_t i = 0; i < count; ++i) {
+    pts[i].u = 40.0 + static_cast<double>((i * 37) % 1840);
+    pts[i].v = 30.0 + static_cast<double>((i * 53) % 1140);
+    pts[i].z = 800.0 + static_cast<double>((i * 11) % 700);
+  }
+  return pts;
+}
+
+void BenchProjectPoints(BenchContext& ctx) {
+  constexpr size_t kPoints = 4096;
+  constexpr int kRounds = 200;
+  const auto pts = MakeSamples(kPoints);
+
+  {
+    std::array<roi_projector::Point3D, 4> corners{};
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      for (size_t i = 0; i + 4 <= kPoints; i += 4) {
+        std::copy(pts.begin() + i, pts.begin() + i + 4, corners.begin());
+        const auto result = ctx.projector.ProjectCorners(corners);
+        g_sink = g_sink + result.points[0].u;
+      }
+    }
+    Report("ProjectCorners (4-point)", kPoints * kRounds, "pt",
+           SecondsSince(start));
+  }
+
+  {
+    std::vector<roi_projector::Point2D> out(kPoints);
+    std::vector<roi_projector::ProjectStatus> status(kPoints);
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      ctx.projector.ProjectPoints(pts.data(), kPoints, out.data(),
+                                  status.data());
+      g_sink = g_sink + out[0].u;
+    }
+    Report("ProjectPoints AoS", kPoints * kRounds, "pt", SecondsSince(start));
+  }
+
+  {
+    std::vector<double> u(kPoints), v(kPoints), z(kPoints);
+    for (size_t i = 0; i < kPoints; ++i) {
+      u[i] = pts[i].u;
+      v[i] = pts[i].v;
+      z[i] = pts[i].z;
+    }
+    std::vector<double> out_u(kPoints), out_v(kPoints);
+    std::vector<roi_projector::ProjectStatus> status(kPoints);
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      ctx.projector.ProjectPoints(u.data(), v.data(), z.data(), kPoints,
+                                  out_u.data(), out_v.data(), status.data());
+      g_sink = g_sink + out_u[0];
+    }
+    Report("ProjectPoints SoA", kPoints * kRounds, "pt", SecondsSince(start));
+  }
+}
+
+// Throughput of each available projection kernel, plus its largest
+// deviation from the scalar kernel on the same inputs.
+void BenchKernels(BenchContext& ctx) {
+  using roi_projector::KernelIsa;
+  constexpr size_t kPoints = 4096;
+  constexpr int kRounds = 200;
+  const auto pts = MakeSamples(kPoints);
+  std::vector<double> u(kPoints), v(kPoints), z(kPoints);
+  for (size_t i = 0; i < kPoints; ++i) {
+    u[i] = pts[i].u;
+    v[i] = pts[i].v;
+    z[i] = pts[i].z;
+  }
+
+  const KernelIsa saved = roi_projector::ActiveKernelIsa();
+  std::vector<double> ref_u(kPoints), ref_v(kPoints);
+  roi_projector::SetKernelIsa(KernelIsa::kScalar);
+  ctx.projector.ProjectPoints(u.data(), v.data(), z.data(), kPoints,
+                              ref_u.data(), ref_v.data(), nullptr);
+
+  const KernelIsa kAll[] = {KernelIsa::kScalar, KernelIsa::kNeon,
+                            KernelIsa::kAvx2, KernelIsa::kAvx512};
+  for (KernelIsa isa : kAll) {
+    if (!roi_projector::SetKernelIsa(isa)) {
+      std::cout << "  " << roi_projector::KernelIsaName(isa)
+                << ": not supported\n";
+      continue;
+    }
+    std::vector<double> out_u(kPoints), out_v(kPoints);
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      ctx.projector.ProjectPoints(u.data(), v.data(), z.data(), kPoints,
+                                  out_u.data(), out_v.data(), nullptr);
+      g_sink = g_sink + out_u[0];
+    }
+    const double seconds = SecondsSince(start);
+    double max_diff = 0.0;
+    for (size_t i = 0; i < kPoints; ++i) {
+      max_diff = std::max(max_diff, std::fabs(out_u[i] - ref_u[i]));
+      max_diff = std::max(max_diff, std::fabs(out_v[i] - ref_v[i]));
+    }
+    Report(roi_projector::KernelIsaName(isa), kPoints * kRounds, "pt",
+           seconds);
+    std::cout << "    max |diff| vs scalar: " << max_diff << " px\n";
+  }
+  roi_projector::SetKernelIsa(saved);
+}
+
+// Camera1 undistortion in kFast mode: table fetch at several strides vs the
+// iterative solve. A table whose residual misses kFast's tolerance is not
+// used, so its row measures the solve.
+void BenchUndistortLut(BenchContext& ctx) {
+  constexpr size_t kPoints = 4096;
+  constexpr int kRounds = 200;
+  const auto pts = MakeSamples(kPoints);
+  std::vector<roi_projector::Point2D> out(kPoints);
+
+  struct Variant {
+    const char* name;
+    bool enabled;
+    int stride;
+  };
+  const Variant kVariants[] = {
+      {"iterative solve", false, 1},
+      {"lut stride 1", true, 1},
+      {"lut stride 2", true, 2},
+      {"lut stride 4", true, 4},
+  };
+  for (const auto& variant : kVariants) {
+    roi_projector::UndistortLutOptions options;
+    options.enabled = variant.enabled;
+    options.stride = variant.stride;
+    options.memory_budget_bytes = size_t{64} << 20;
+    roi_projector::Projector projector;
+    const auto load_start = Clock::now();
+    if (!projector.LoadCalibration(ctx.calib_path, options)) {
+      continue;
+    }
+    const double load_ms = SecondsSince(load_start) * 1e3;
+    projector.SetUndistortMode(roi_projector::UndistortMode::kFast);
+    const auto* lut = projector.undistort_lut();
+    std::cout << "  " << variant.name << " (load " << load_ms << " ms, table "
+              << (lut != nullptr ? lut->SizeBytes() / 1024 : 0) << " KiB";
+    if (lut != nullptr) {
+      std::cout << ", residual " << lut->max_residual
+                << (projector.compiled_calibration().lut1 != nullptr
+                        ? ", used"
+                        : ", not used");
+    }
+    std::cout << ")\n";
+
+    const roi_projector::KernelIsa saved = roi_projector::ActiveKernelIsa();
+    for (roi_projector::KernelIsa isa :
+         {saved, roi_projector::KernelIsa::kScalar}) {
+      roi_projector::SetKernelIsa(isa);
+      const auto start = Clock::now();
+      for (int r = 0; r < kRounds; ++r) {
+        projector.ProjectPoints(pts.data(), kPoints, out.data(), nullptr);
+        g_sink = g_sink + out[0].u;
+      }
+      Report(roi_projector::KernelIsaName(isa), kPoints * kRounds, "pt",
+             SecondsSince(start));
+    }
+    roi_projector::SetKernelIsa(saved);
+  }
+}
+
+// Newton undistortion modes without the table: throughput, mean steps and
+// points reported as diverged.
+void BenchUndistortModes(BenchContext& ctx) {
+  using roi_projector::UndistortMode;
+  constexpr size_t kPoints = 4096;
+  constexpr int kRounds = 200;
+  const auto pts = MakeSamples(kPoints);
+  std::vector<roi_projector::Point2D> out(kPoints);
+  std::vector<roi_projector::ProjectStatus> status(kPoints);
+  std::vector<uint8_t> iterations(kPoints);
+
+  roi_projector::UndistortLutOptions options;
+  options.enabled = false;
+  roi_projector::Projector projector;
+  if (!projector.LoadCalibration(ctx.calib_path, options)) {
+    return;
+  }
+  const struct {
+    const char* name;
+    UndistortMode mode;
+  } kModes[] = {{"fast", UndistortMode::kFast},
+                {"balanced", UndistortMode::kBalanced},
+                {"exact", UndistortMode::kExact}};
+  for (const auto& entry : kModes) {
+    projector.SetUndistortMode(entry.mode);
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      projector.ProjectPoints(pts.data(), kPoints, out.data(), status.data(),
+                              iterations.data());
+      g_sink = g_sink + out[0].u;
+    }
+    Report(entry.name, kPoints * kRounds, "pt", SecondsSince(start));
+    size_t steps = 0;
+    size_t diverged = 0;
+    for (size_t i = 0; i < kPoints; ++i) {
+      steps += iterations[i];
+      diverged += (status[i] ==
+                   roi_projector::ProjectStatus::kUndistortDiverged) ? 1 : 0;
+    }
+    std::cout << "    mean steps " << static_cast<double>(steps) / kPoints
+              << ", diverged " << diverged << "/" << kPoints << "\n";
+  }
+}
+
+// Writes a copy of the calibration with both distortion keys renamed, so it
+// loads as a distortion-free pair. Returns the copy's path or "".
+std::string WriteDistortionFreeCopy(const std::string& calib_path) {
+  std::ifstream in(calib_path, std::ios::in | std::ios::binary);
+  if (!in) {
+    return std::string();
+  }
+  std::ostringstream ss;
+  ss << in.rdbuf();
+  std::string json = ss.str();
+  for (const char* key : {"\"camera1_distortion\"", "\"camera2_distortion\""}) {
+    const size_t pos = json.find(key);
+    if (pos != std::string::npos) {
+      json.insert(pos + 1, "unused_");
+    }
+  }
+  const std::string out_path = "/tmp/roi_projector_bench_nodist.json";
+  std::ofstream out(out_path, std::ios::out | std::ios::binary);
+  out << json;
+  return out ? out_path : std::string();
+}
+
+// Per-point cost of the transform for distorted and distortion-free
+// calibrations, through ProjectCorners and the scalar/active kernels.
+void BenchTransform(BenchContext& ctx) {
+  constexpr size_t kPoints = 4096;
+  constexpr int kRounds = 200;
+  const auto pts = MakeSamples(kPoints);
+  std::vector<roi_projector::Point2D> out(kPoints);
+
+  const std::string nodist_path = WriteDistortionFreeCopy(ctx.calib_path);
+  const struct {
+    const char* name;
+    std::string path;
+  } kCalibs[] = {{"distorted", ctx.calib_path},
+                 {"distortion-free", nodist_path}};
+  for (const auto& calib : kCalibs) {
+    roi_projector::Projector projector;
+    if (calib.path.empty() || !projector.LoadCalibration(calib.path)) {
+      continue;
+    }
+    std::cout << "  " << calib.name << "\n";
+    {
+      std::array<roi_projector::Point3D, 4> corners{};
+      const auto start = Clock::now();
+      for (int r = 0; r < kRounds; ++r) {
+        for (size_t i = 0; i + 4 <= kPoints; i += 4) {
+          std::copy(pts.begin() + i, pts.begin() + i + 4, corners.begin());
+          g_sink = g_sink + projector.ProjectCorners(corners).points[0].u;
+        }
+      }
+      Report("ProjectCorners", kPoints * kRounds, "pt", SecondsSince(start));
+    }
+    const roi_projector::KernelIsa saved = roi_projector::ActiveKernelIsa();
+    for (roi_projector::KernelIsa isa :
+         {roi_projector::KernelIsa::kScalar, saved}) {
+      roi_projector::SetKernelIsa(isa);
+      const auto start = Clock::now();
+      for (int r = 0; r < kRounds; ++r) {
+        projector.ProjectPoints(pts.data(), kPoints, out.data(), nullptr);
+        g_sink = g_sink + out[0].u;
+      }
+      Report(roi_projector::KernelIsaName(isa), kPoints * kRounds, "pt",
+             SecondsSince(start));
+    }
+    roi_projector::SetKernelIsa(saved);
+  }
+}
+
+// Compile-time specialized projectors against the runtime-dispatched
+// Projector, for distorted and distortion-free calibrations.
+void BenchSpecialized(BenchContext& ctx) {
+  constexpr size_t kPoints = 4096;
+  constexpr int kRounds = 200;
+  const auto pts = MakeSamples(kPoints);
+  std::vector<roi_projector::Point2D> ref(kPoints);
+  std::vector<roi_projector::Point2D> out(kPoints);
+
+  const std::string nodist_path = WriteDistortionFreeCopy(ctx.calib_path);
+  const struct {
+    const char* name;
+    std::string path;
+  } kCalibs[] = {{"distorted", ctx.calib_path},
+                 {"distortion-free", nodist_path}};
+  for (const auto& calib : kCalibs) {
+    roi_projector::Projector projector;
+    if (calib.path.empty() || !projector.LoadCalibration(calib.path)) {
+      continue;
+    }
+    std::cout << "  " << calib.name << "\n";
+    const roi_projector::KernelIsa saved = roi_projector::ActiveKernelIsa();
+    roi_projector::SetKernelIsa(roi_projector::KernelIsa::kScalar);
+    {
+      const auto start = Clock::now();
+      for (int r = 0; r < kRounds; ++r) {
+        projector.ProjectPoints(pts.data(), kPoints, ref.data(), nullptr);
+        g_sink = g_sink + ref[0].u;
+      }
+      Report("Projector (scalar)", kPoints * kRounds, "pt",
+             SecondsSince(start));
+    }
+    roi_projector::SetKernelIsa(saved);
+
+    for (bool use_float : {false, true}) {
+      const auto handle =
+          roi_projector::MakeSpecializedProjector(projector, use_float);
+      const auto start = Clock::now();
+      for (int r = 0; r < kRounds; ++r) {
+        handle->ProjectPoints(pts.data(), kPoints, out.data(), nullptr);
+        g_sink = g_sink + out[0].u;
+      }
+      const double seconds = SecondsSince(start);
+      double max_diff = 0.0;
+      for (size_t i = 0; i < kPoints; ++i) {
+        max_diff = std::max({max_diff, std::fabs(out[i].u - ref[i].u),
+                             std::fabs(out[i].v - ref[i].v)});
+      }
+      Report(handle->Name(), kPoints * kRounds, "pt", seconds);
+      std::cout << "    max diff vs scalar kernel: " << max_diff << " px\n";
+    }
+  }
+}
+
+// ROI/barcode pairs around a 200x150 ROI: fully inside, straddling an edge
+// and disjoint.
+std::vector<std::array<roi_projector::Point2D, 4>> MakeBarcodes(size_t count) {
+  std::vector<std::array<roi_projector::Point2D, 4>> barcodes(count);
+  for (size_t i = 0; i < count; ++i) {
+    const double x = -40.0 + static_cast<double>((i * 29) % 260);
+    const double y = -30.0 + static_cast<double>((i * 17) % 200);
+    const double w = 20.0 + static_cast<double>(i % 30);
+    barcodes[i] = {{{x, y}, {x + w, y + 3.0}, {x + w - 2.0, y + 25.0},
+                    {x - 2.0, y + 22.0}}};
+  }
+  return barcodes;
+}
+
+const std::array<roi_projector::Point2D, 4> kBenchRoi = {
+    {{0.0, 0.0}, {200.0, 0.0}, {200.0, 150.0}, {0.0, 150.0}}};
+
+void CountRecords(const roi_projector::TraceRecord*, size_t count,
+                  void* user) {
+  *static_cast<size_t*>(user) += count;
+}
+
+// IsRoiInsideQuad with trace points compiled out (or idle), with tracing
+// running, and with the old synchronous "[IOU Debug]" output emulated by
+// two std::endl-flushed lines per check into /dev/null.
+void BenchRoiInsideQuad(BenchContext&) {
+  constexpr int kRounds = 2000;
+  const auto barcodes = MakeBarcodes(256);
+  const double checks = static_cast<double>(barcodes.size()) * kRounds;
+
+  auto run = [&](const char* name, auto&& after_check) {
+    size_t inside = 0;
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      for (const auto& barcode : barcodes) {
+        const bool ok = roi_projector::IsRoiInsideQuad(kBenchRoi, barcode);
+        inside += ok ? 1 : 0;
+        after_check(barcode, ok);
+      }
+    }
+    Report(name, checks, "check", SecondsSince(start));
+    g_sink = g_sink + static_cast<double>(inside);
+  };
+
+  run(roi_projector::TraceCompiledIn() ? "trace compiled in, idle"
+                                       : "trace compiled out",
+      [](const auto&, bool) {});
+
+  if (roi_projector::TraceCompiledIn()) {
+    size_t records = 0;
+    const uint64_t dropped_before = roi_projector::TraceDroppedRecords();
+    roi_projector::StartTracing(&CountRecords, &records);
+    run("trace running", [](const auto&, bool) {});
+    roi_projector::StopTracing();
+    std::cout << "    records: " << records << ", dropped: "
+              << (roi_projector::TraceDroppedRecords() - dropped_before)
+              << "\n";
+  } else {
+    std::cout << "  trace running: skipped (ROI_PROJECTOR_ENABLE_TRACE=OFF)\n";
+  }
+
+  std::ofstream devnull("/dev/null");
+  run("legacy std::endl output", [&](const auto& barcode, bool ok) {
+    devnull << "[IOU Debug] area_quad=" << 30000.0
+            << ", area_barcode=" << barcode[1].u << ", intersection_size=" << 4
+            << std::endl
+            << std::flush;
+    devnull << "[IOU Debug] IOU: " << (ok ? 1.0 : 0.0) << std::endl
+            << std::flush;
+  });
+}
+
+// One ROI against 1, 16 and 256 barcodes: IsRoiInsideQuad per barcode
+// versus ScoreBarcodes, which prepares the ROI once.
+void BenchCoverage(BenchContext&) {
+  for (size_t count : {size_t{1}, size_t{16}, size_t{256}}) {
+    const auto barcodes = MakeBarcodes(count);
+    const int rounds = static_cast<int>(512000 / count);
+    const double checks = static_cast<double>(count) * rounds;
+    std::vector<double> coverage(count);
+    std::cout << "  " << count << " barcodes\n";
+    {
+      const auto start = Clock::now();
+      size_t inside = 0;
+      for (int r = 0; r < rounds; ++r) {
+        for (const auto& barcode : barcodes) {
+          inside += roi_projector::IsRoiInsideQuad(kBenchRoi, barcode) ? 1 : 0;
+        }
+      }
+      Report("IsRoiInsideQuad", checks, "check", SecondsSince(start));
+      g_sink = g_sink + static_cast<double>(inside);
+    }
+    {
+      std::unique_ptr<bool[]> flags(new bool[count]);
+      const auto start = Clock::now();
+      size_t inside = 0;
+      for (int r = 0; r < rounds; ++r) {
+        inside += roi_projector::ScoreBarcodes(
+            kBenchRoi, barcodes.data(), count,
+            roi_projector::kDefaultCoverageThreshold, coverage.data(),
+            flags.get());
+      }
+      Report("ScoreBarcodes", checks, "check", SecondsSince(start));
+      g_sink = g_sink + static_cast<double>(inside) + coverage[0];
+    }
+  }
+
+  // Which tier decided each of the 256 barcodes.
+  const auto barcodes = MakeBarcodes(256);
+  roi_projector::ResetCoverageTierStats();
+  roi_projector::ScoreBarcodes(kBenchRoi, barcodes.data(), barcodes.size(),
+                               roi_projector::kDefaultCoverageThreshold,
+                               nullptr, nullptr);
+  const roi_projector::CoverageTierStats stats =
+      roi_projector::GetCoverageTierStats();
+  std::cout << "  tiers:";
+  for (size_t i = 0; i < roi_projector::kCoverageTierCount; ++i) {
+    std::cout << " " << roi_projector::CoverageTierName(
+                            static_cast<roi_projector::CoverageTier>(i))
+              << "=" << stats.calls[i];
+  }
+  std::cout << "\n";
+}
+
+// 64 ROIs x 512 barcodes spread over a 4096x3000 camera2 image: every pair
+// through ScoreBarcodes versus RoiAssigner.
+void BenchAssigner(BenchContext&) {
+  constexpr size_t kRois = 64;
+  constexpr size_t kBarcodes = 512;
+  constexpr int kRounds = 200;
+  std::vector<roi_projector::Quad> rois(kRois);
+  for (size_t i = 0; i < kRois; ++i) {
+    const double u = 40.0 + 500.0 * static_cast<double>(i % 8);
+    const double v = 30.0 + 370.0 * static_cast<double>(i / 8);
+    rois[i] = {{{u, v}, {u + 420.0, v + 8.0}, {u + 412.0, v + 300.0},
+                {u - 6.0, v + 292.0}}};
+  }
+  std::vector<roi_projector::Quad> barcodes(kBarcodes);
+  for (size_t i = 0; i < kBarcodes; ++i) {
+    const double u = static_cast<double>((i * 389) % 4000);
+    const double v = static_cast<double>((i * 211) % 2950);
+    const double w = 60.0 + static_cast<double>(i % 40);
+    barcodes[i] = {{{u, v}, {u + w, v + 4.0}, {u + w - 3.0, v + 35.0},
+                    {u - 3.0, v + 31.0}}};
+  }
+
+  {
+    std::vector<double> coverage(kBarcodes);
+    const auto start = Clock::now();
+    size_t passed = 0;
+    for (int r = 0; r < kRounds; ++r) {
+      for (const auto& roi : rois) {
+        passed += roi_projector::ScoreBarcodes(
+            roi, barcodes.data(), kBarcodes,
+            roi_projector::kDefaultCoverageThreshold, coverage.data(),
+            nullptr);
+      }
+    }
+    const double seconds = SecondsSince(start);
+    std::cout << "  all pairs: " << (seconds / kRounds * 1e6)
+              << " us/frame\n";
+    g_sink = g_sink + static_cast<double>(passed);
+  }
+  {
+    roi_projector::RoiAssigner assigner;
+    roi_projector::RoiAssignment result;
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      assigner.Assign(rois.data(), kRois, barcodes.data(), kBarcodes, result);
+      g_sink = g_sink + static_cast<double>(result.unmatched_barcodes.size());
+    }
+    const double seconds = SecondsSince(start);
+    std::cout << "  RoiAssigner: " << (seconds / kRounds * 1e6)
+              << " us/frame (" << assigner.last_candidate_count()
+              << " candidate pairs of " << kRois * kBarcodes << ", "
+              << (kBarcodes - result.unmatched_barcodes.size())
+              << " barcodes matched)\n";
+  }
+}
+
+// Independent ROI/barcode pairs as in an offline replay: CoverageRoi per
+// pair versus ComputePairCoverage on each available kernel.
+void BenchPairCoverage(BenchContext&) {
+  using roi_projector::KernelIsa;
+  constexpr size_t kPairs = 4096;
+  constexpr int kRounds = 200;
+  const auto barcodes = MakeBarcodes(kPairs);
+  std::vector<roi_projector::Quad> rois(kPairs);
+  for (size_t i = 0; i < kPairs; ++i) {
+    // Slightly perspective-distorted variants of kBenchRoi.
+    const double s = 0.01 * static_cast<double>(i % 7);
+    rois[i] = {{{0.0, 0.0}, {200.0, 200.0 * s}, {200.0 - 150.0 * s, 150.0},
+                {0.0, 150.0}}};
+  }
+  const double checks = static_cast<double>(kPairs) * kRounds;
+
+  std::vector<double> ref(kPairs);
+  {
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      for (size_t i = 0; i < kPairs; ++i) {
+        ref[i] = roi_projector::CoverageRoi(rois[i]).Coverage(barcodes[i]);
+      }
+      g_sink = g_sink + ref[0];
+    }
+    Report("CoverageRoi", checks, "pair", SecondsSince(start));
+  }
+
+  const KernelIsa saved = roi_projector::ActiveKernelIsa();
+  const KernelIsa kAll[] = {KernelIsa::kScalar, KernelIsa::kNeon,
+                            KernelIsa::kAvx2, KernelIsa::kAvx512};
+  std::vector<double> coverage(kPairs);
+  for (KernelIsa isa : kAll) {
+    if (!roi_projector::SetKernelIsa(isa)) {
+      std::cout << "  " << roi_projector::KernelIsaName(isa)
+                << ": not supported\n";
+      continue;
+    }
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      roi_projector::ComputePairCoverage(rois.data(), barcodes.data(), kPairs,
+                                         coverage.data());
+      g_sink = g_sink + coverage[0];
+    }
+    const double seconds = SecondsSince(start);
+    double max_diff = 0.0;
+    for (size_t i = 0; i < kPairs; ++i) {
+      max_diff = std::max(max_diff, std::fabs(coverage[i] - ref[i]));
+    }
+    Report(roi_projector::KernelIsaName(isa), checks, "pair", seconds);
+    std::cout << "    max |diff| vs CoverageRoi: " << max_diff << "\n";
+  }
+  roi_projector::SetKernelIsa(saved);
+}
+
+// Per-frame rasterization of a projected ROI into a 5472x3736 reader image:
+// spans and bit mask for the quad, and spans for a 64-vertex polygon as
+// produced by edge densification.
+void BenchRaster(BenchContext&) {
+  constexpr int kRounds = 2000;
+  roi_projector::RasterOptions options;
+  options.width = 5472;
+  options.height = 3736;
+  options.dilation_px = 8.0;
+  const roi_projector::Quad quad = {
+      {{1210.3, 820.7}, {3620.9, 905.2}, {3540.4, 2710.6}, {1150.8, 2633.1}}};
+  std::vector<roi_projector::Point2D> polygon(64);
+  for (size_t i = 0; i < polygon.size(); ++i) {
+    const double a = 6.283185307179586 * static_cast<double>(i) / 64.0;
+    polygon[i] = {2400.0 + 1200.0 * std::cos(a), 1800.0 + 900.0 * std::sin(a)};
+  }
+  const double frame_pixels =
+      static_cast<double>(options.width) * options.height;
+
+  roi_projector::RoiSpans spans;
+  roi_projector::RoiMask mask;
+  {
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      roi_projector::RasterizeRoi(quad.data(), quad.size(), options, spans);
+      g_sink = g_sink + spans.spans[0].x0;
+    }
+    const double seconds = SecondsSince(start);
+    std::cout << "  quad spans: " << (seconds / kRounds * 1e6)
+              << " us/frame, " << spans.spans.size() << " rows, "
+              << (100.0 * spans.PixelCount() / frame_pixels)
+              << "% of the sensor\n";
+  }
+  {
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      roi_projector::BuildRoiMask(spans, options.width, mask);
+      g_sink = g_sink + static_cast<double>(mask.words[0]);
+    }
+    const double seconds = SecondsSince(start);
+    std::cout << "  quad mask: " << (seconds / kRounds * 1e6)
+              << " us/frame, " << mask.words.size() * 8 / 1024 << " KiB\n";
+  }
+  {
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      roi_projector::RasterizeRoi(polygon.data(), polygon.size(), options,
+                                  spans);
+      g_sink = g_sink + spans.spans[0].x0;
+    }
+    const double seconds = SecondsSince(start);
+    std::cout << "  64-vertex spans: " << (seconds / kRounds * 1e6)
+              << " us/frame\n";
+  }
+}
+
+// Edge-densified projection of one ROI near the image corners, where
+// distortion bends its edges most, against the four-corner projection.
+void BenchDenseRoi(BenchContext& ctx) {
+  constexpr int kRounds = 20000;
+  const std::array<roi_projector::Point3D, 4> corners = {
+      {{60.0, 50.0, 820.0},
+       {1860.0, 70.0, 900.0},
+       {1850.0, 1150.0, 1300.0},
+       {70.0, 1140.0, 1100.0}}};
+  {
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      g_sink = g_sink + ctx.projector.ProjectCorners(corners).points[0].u;
+    }
+    Report("ProjectCorners", kRounds, "roi", SecondsSince(start));
+  }
+  std::array<roi_projector::Point2D, 4 * roi_projector::kMaxDenseSamplesPerEdge>
+      out{};
+  for (int samples : {4, 16, 64}) {
+    for (bool hull : {false, true}) {
+      roi_projector::DenseRoiOptions options;
+      options.samples_per_edge = samples;
+      options.convex_hull = hull;
+      size_t count = 0;
+      const auto start = Clock::now();
+      for (int r = 0; r < kRounds; ++r) {
+        count = ctx.projector
+                    .ProjectDenseRoi(corners, options, out.data(), out.size())
+                    .count;
+        g_sink = g_sink + out[0].u;
+      }
+      const std::string name = std::to_string(samples) + " per edge, " +
+                               std::to_string(count) +
+                               (hull ? " hull vertices" : " points");
+      Report(name.c_str(), kRounds, "roi", SecondsSince(start));
+    }
+  }
+
+  // Envelope over a depth range, at the default sampling and at the
+  // extremes only.
+  const std::array<roi_projector::Point2D, 4> corners_uv = {
+      {{60.0, 50.0}, {1860.0, 70.0}, {1850.0, 1150.0}, {70.0, 1140.0}}};
+  std::array<roi_projector::Point2D,
+             4 * roi_projector::kMaxDenseSamplesPerEdge *
+                 roi_projector::kMaxEnvelopeDepthSamples>
+      envelope{};
+  for (int samples : {1, 16}) {
+    roi_projector::RoiEnvelopeOptions options;
+    options.samples_per_edge = samples;
+    size_t count = 0;
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      count = ctx.projector
+                  .ProjectRoiEnvelope(corners_uv, 700.0, 1500.0, options,
+                                      envelope.data(), envelope.size())
+                  .count;
+      g_sink = g_sink + envelope[0].u;
+    }
+    const std::string name = "envelope, " + std::to_string(samples) +
+                             " per edge, " + std::to_string(count) +
+                             " hull vertices";
+    Report(name.c_str(), kRounds, "roi", SecondsSince(start));
+  }
+}
+
+// Corner depths from a 1920x1200 depth frame with scattered holes: one
+// sample per window size, and the one-call ROI projection.
+void BenchDepthSampler(BenchContext& ctx) {
+  constexpr int kWidth = 1920;
+  constexpr int kHeight = 1200;
+  constexpr int kRounds = 20000;
+  std::vector<float> depth(static_cast<size_t>(kWidth) * kHeight);
+  for (size_t i = 0; i < depth.size(); ++i) {
+    // About one pixel in five is a hole.
+    const bool hole = (i * 2654435761u) % 5 == 0;
+    depth[i] = hole ? 0.0f : 900.0f + static_cast<float>(i % 97);
+  }
+  roi_projector::DepthImageView image;
+  image.data = depth.data();
+  image.width = kWidth;
+  image.height = kHeight;
+  const auto pts = MakeSamples(kRounds);
+
+  for (int radius : {2, 7, 15}) {
+    roi_projector::DepthSampleOptions options;
+    options.window_radius = radius;
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      g_sink = g_sink +
+               roi_projector::SampleDepth(image, pts[r].u, pts[r].v, options)
+                   .depth;
+    }
+    const std::string name =
+        "window " + std::to_string(2 * radius + 1) + "x" +
+        std::to_string(2 * radius + 1);
+    Report(name.c_str(), kRounds, "sample", SecondsSince(start));
+  }
+
+  const std::array<roi_projector::Point2D, 4> roi = {
+      {{400.0, 300.0}, {1500.0, 320.0}, {1480.0, 900.0}, {420.0, 880.0}}};
+  const roi_projector::DepthSampleOptions options;
+  const auto start = Clock::now();
+  for (int r = 0; r < kRounds; ++r) {
+    g_sink = g_sink + roi_projector::ProjectRoiFromDepth(ctx.projector, image,
+                                                         roi, options)
+                          .corners.points[0]
+                          .u;
+  }
+  Report("ProjectRoiFromDepth", kRounds, "roi", SecondsSince(start));
+}
+
+// Per-frame summed-area tables over a 1920x1200 depth frame, then the
+// statistics of 256 ROIs from them.
+void BenchDepthIntegral(BenchContext&) {
+  constexpr int kWidth = 1920;
+  constexpr int kHeight = 1200;
+  constexpr int kFrames = 20;
+  std::vector<float> depth(static_cast<size_t>(kWidth) * kHeight);
+  for (size_t i = 0; i < depth.size(); ++i) {
+    const bool hole = (i * 2654435761u) % 5 == 0;
+    depth[i] = hole ? 0.0f : 900.0f + static_cast<float>(i % 97);
+  }
+  roi_projector::DepthImageView image;
+  image.data = depth.data();
+  image.width = kWidth;
+  image.height = kHeight;
+
+  roi_projector::DepthIntegral integral;
+  for (int threads : {1, 2, 4, 0}) {
+    integral.Build(image, threads);  // sizes the tables, starts the workers
+    const auto start = Clock::now();
+    for (int f = 0; f < kFrames; ++f) {
+      integral.Build(image, threads);
+    }
+    const double seconds = SecondsSince(start);
+    std::cout << "  build, "
+              << (threads == 0 ? std::to_string(
+                                     std::thread::hardware_concurrency()) +
+                                     " (all hardware) threads"
+                               : std::to_string(threads) + " threads")
+              << ": " << (seconds / kFrames * 1e3) << " ms/frame\n";
+  }
+
+  constexpr size_t kRois = 256;
+  constexpr int kRounds = 2000;
+  std::vector<std::array<roi_projector::Point2D, 4>> rois(kRois);
+  for (size_t i = 0; i < kRois; ++i) {
+    const double u = 20.0 + static_cast<double>((i * 131) % 1700);
+    const double v = 20.0 + static_cast<double>((i * 71) % 1000);
+    rois[i] = {{{u, v}, {u + 150.0, v + 10.0}, {u + 140.0, v + 120.0},
+                {u - 5.0, v + 110.0}}};
+  }
+  const auto start = Clock::now();
+  for (int r = 0; r < kRounds; ++r) {
+    for (const auto& roi : rois) {
+      g_sink = g_sink + integral.BoundingBoxStats(roi).variance;
+    }
+  }
+  Report("BoundingBoxStats", static_cast<double>(kRounds) * kRois, "roi",
+         SecondsSince(start));
+}
+
+// Min/max pyramid of a 1920x1200 depth frame: build per kernel ISA, then
+// conservative depth bounds of the same ROIs as above.
+void BenchDepthPyramid(BenchContext&) {
+  using roi_projector::KernelIsa;
+  constexpr int kWidth = 1920;
+  constexpr int kHeight = 1200;
+  constexpr int kFrames = 50;
+  std::vector<float> depth(static_cast<size_t>(kWidth) * kHeight);
+  for (size_t i = 0; i < depth.size(); ++i) {
+    const bool hole = (i * 2654435761u) % 5 == 0;
+    depth[i] = hole ? 0.0f : 900.0f + static_cast<float>(i % 97);
+  }
+  roi_projector::DepthImageView image;
+  image.data = depth.data();
+  image.width = kWidth;
+  image.height = kHeight;
+
+  roi_projector::DepthPyramid pyramid;
+  const KernelIsa saved = roi_projector::ActiveKernelIsa();
+  const KernelIsa kAll[] = {KernelIsa::kScalar, KernelIsa::kNeon,
+                            KernelIsa::kAvx2, KernelIsa::kAvx512};
+  for (KernelIsa isa : kAll) {
+    if (!roi_projector::SetKernelIsa(isa)) {
+      std::cout << "  " << roi_projector::KernelIsaName(isa)
+                << ": not supported\n";
+      continue;
+    }
+    pyramid.Build(image);  // sizes the arena
+    const auto start = Clock::now();
+    for (int f = 0; f < kFrames; ++f) {
+      pyramid.Build(image);
+    }
+    std::cout << "  build, " << roi_projector::KernelIsaName(isa) << ": "
+              << (SecondsSince(start) / kFrames * 1e3) << " ms/frame\n";
+  }
+  roi_projector::SetKernelIsa(saved);
+
+  constexpr size_t kRois = 256;
+  constexpr int kRounds = 2000;
+  std::vector<std::array<roi_projector::Point2D, 4>> rois(kRois);
+  for (size_t i = 0; i < kRois; ++i) {
+    const double u = 20.0 + static_cast<double>((i * 131) % 1700);
+    const double v = 20.0 + static_cast<double>((i * 71) % 1000);
+    rois[i] = {{{u, v}, {u + 150.0, v + 10.0}, {u + 140.0, v + 120.0},
+                {u - 5.0, v + 110.0}}};
+  }
+  const auto start = Clock::now();
+  for (int r = 0; r < kRounds; ++r) {
+    for (const auto& roi : rois) {
+      g_sink = g_sink + pyramid.RoiRange(roi).z_max;
+    }
+  }
+  Report("RoiRange", static_cast<double>(kRounds) * kRois, "roi",
+         SecondsSince(start));
+}
+
+// Calibration bundle: `stations` entries, each with its own matrices,
+// metadata and history, ahead of the top-level keys of `calib_json`.
+std::string MakeCalibrationBundle(const std::string& calib_json,
+                                  int stations) {
+  std::ostringstream ss;
+  ss.precision(17);
+  ss << "{\n  \"metadata\": {\"site\": \"line 3\", \"tool\": "
+        "\"calibration.py\", \"note\": \"\\\"camera1_matrix\\\" is "
+        "per station\"},\n  \"stations\": [";
+  for (int s = 0; s < stations; ++s) {
+    ss << (s == 0 ? "\n" : ",\n") << "    {\"id\": \"station_" << s
+       << "\", \"enabled\": true, \"extrinsic_matrix\": [";
+    for (int i = 0; i < 16; ++i) {
+      ss << (i == 0 ? "" : ", ") << (i % 5 == 0 ? 1.0 : 0.001 * (s + i));
+    }
+    ss << "], \"camera1_matrix\": [[2141.442000362903, 0.0, 959.5], "
+          "[0.0, 2141.359883417685, 599.5], [0.0, 0.0, 1.0]], "
+          "\"camera1_distortion\": [-0.0067, -3.0618, -7.7e-06, "
+          "-0.00045, 57.163], \"history\": [";
+    for (int h = 0; h < 4; ++h) {
+      ss << (h == 0 ? "" : ", ") << "{\"time\": \"2024-05-0" << h + 1
+         << "T08:00:00Z\", \"rms\": " << 0.1 + 0.01 * h
+         << ", \"operator\": null}";
+    }
+    ss << "]}";
+  }
+  ss << "\n  ],\n" << calib_json.substr(calib_json.find('{') + 1);
+  return ss.str();
+}
+
+// Calibration JSON parsing over bundles of growing size: cost per byte
+// should stay flat, i.e. load time grows linearly with the file.
+void BenchCalibrationJson(BenchContext& ctx) {
+  std::ifstream in(ctx.calib_path, std::ios::in | std::ios::binary);
+  std::ostringstream ss;
+  ss << in.rdbuf();
+  const std::string calib_json = ss.str();
+
+  roi_projector::CalibrationJson json;
+  for (int stations : {0, 10, 100, 1000, 10000}) {
+    const std::string bundle = MakeCalibrationBundle(calib_json, stations);
+    const int rounds = std::max(5, static_cast<int>(20000000 / bundle.size()));
+    const auto start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+      if (!json.Parse(bundle)) {
+        std::cerr << "bundle failed to parse\n";
+        return;
+      }
+      g_sink = g_sink + json.Find("camera1_matrix").values[0];
+    }
+    const double seconds = SecondsSince(start) / rounds;
+    std::cout << "  " << stations << " stations, " << bundle.size() / 1024
+              << " KiB: " << seconds * 1e6 << " us/parse, "
+              << seconds * 1e9 / bundle.size() << " ns/byte\n";
+  }
+
+  // Whole load from disk, without the undistortion table.
+  roi_projector::UndistortLutOptions options;
+  options.enabled = false;
+  const std::string path = "/tmp/roi_projector_bench_bundle.json";
+  for (int stations : {0, 10000}) {
+    {
+      std::ofstream out(path, std::ios::out | std::ios::binary);
+      out << MakeCalibrationBundle(calib_json, stations);
+    }
+    roi_projector::Projector projector;
+    constexpr int kRounds = 20;
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      if (!projector.LoadCalibration(path, options)) {
+        std::cerr << "bundle failed to load\n";
+        return;
+      }
+    }
+    std::cout << "  LoadCalibration, " << stations << " stations: "
+              << SecondsSince(start) / kRounds * 1e6 << " us\n";
+  }
+  std::remove(path.c_str());
+}
+
+// Startup from the calibration JSON (parse plus camera1 table build)
+// against the binary file of the same calibration, with and without the
+// table, and the checksum alone.
+void BenchCalibrationBinary(BenchContext& ctx) {
+  const std::string path = "/tmp/roi_projector_bench_calib.bin";
+  for (bool with_lut : {true, false}) {
+    roi_projector::UndistortLutOptions options;
+    options.enabled = with_lut;
+    const char* what = with_lut ? "with table" : "without table";
+    roi_projector::Projector projector;
+    constexpr int kJsonRounds = 5;
+    auto start = Clock::now();
+    for (int r = 0; r < kJsonRounds; ++r) {
+      if (!projector.LoadCalibration(ctx.calib_path, options)) {
+        std::cerr << "calibration failed to load\n";
+        return;
+      }
+    }
+    std::cout << "  LoadCalibration, " << what << ": "
+              << SecondsSince(start) / kJsonRounds * 1e6 << " us\n";
+
+    if (!projector.SaveCalibrationBinary(path)) {
+      std::cerr << "binary calibration failed to save\n";
+      return;
+    }
+    constexpr int kBinaryRounds = 200;
+    start = Clock::now();
+    for (int r = 0; r < kBinaryRounds; ++r) {
+      if (!projector.LoadCalibrationBinary(path)) {
+        std::cerr << "binary calibration failed to load\n";
+        return;
+      }
+    }
+    std::cout << "  LoadCalibrationBinary, " << what << ": "
+              << SecondsSince(start) / kBinaryRounds * 1e6 << " us\n";
+  }
+  std::remove(path.c_str());
+
+  std::vector<unsigned char> bytes(size_t{1} << 20, 0x5a);
+  constexpr int kRounds = 200;
+  const auto start = Clock::now();
+  for (int r = 0; r < kRounds; ++r) {
+    bytes[0] = static_cast<unsigned char>(r);
+    g_sink = g_sink + static_cast<double>(roi_projector::CalibrationChecksum(
+                          bytes.data(), bytes.size()) &
+                      0xff);
+  }
+  const double seconds = SecondsSince(start) / kRounds;
+  std::cout << "  CalibrationChecksum, 1 MiB: " << seconds * 1e6 << " us ("
+            << bytes.size() / seconds / 1e9 << " GB/s)\n";
+}
+
+// Cost of pinning a snapshot per call next to the projection itself, and
+// of publishing a reloaded binary calibration with no readers left.
+void BenchCalibrationReload(BenchContext& ctx) {
+  roi_projector::SharedProjector shared;
+  shared.Publish(std::make_unique<roi_projector::Projector>(ctx.projector));
+  constexpr int kCalls = 1000000;
+  {
+    const auto start = Clock::now();
+    for (int i = 0; i < kCalls; ++i) {
+      const roi_projector::SharedProjector::Snapshot snapshot =
+          shared.Acquire();
+      g_sink = g_sink + static_cast<double>(snapshot.get() != nullptr);
+    }
+    Report("Acquire + release", kCalls, "call", SecondsSince(start));
+  }
+  const std::array<roi_projector::Point3D, 4> corners = {
+      {{100, 200, 1000}, {1800, 150, 900}, {1700, 1100, 1500},
+       {50, 1000, 2000}}};
+  {
+    const auto start = Clock::now();
+    for (int i = 0; i < kCalls; ++i) {
+      g_sink = g_sink + ctx.projector.ProjectCorners(corners).points[0].u;
+    }
+    Report("ProjectCorners, Projector", kCalls, "call", SecondsSince(start));
+  }
+  {
+    const auto start = Clock::now();
+    for (int i = 0; i < kCalls; ++i) {
+      g_sink = g_sink + shared.Acquire()->ProjectCorners(corners).points[0].u;
+    }
+    Report("ProjectCorners, snapshot per call", kCalls, "call",
+           SecondsSince(start));
+  }
+
+  const std::string path = "/tmp/roi_projector_bench_reload.bin";
+  if (!ctx.projector.SaveCalibrationBinary(path)) {
+    std::cerr << "binary calibration failed to save\n";
+    return;
+  }
+  constexpr int kReloads = 200;
+  const auto start = Clock::now();
+  for (int i = 0; i < kReloads; ++i) {
+    if (!shared.Load(path)) {
+      std::cerr << "binary calibration failed to load\n";
+      return;
+    }
+  }
+  std::cout << "  Load + Publish, binary with table: "
+            << SecondsSince(start) / kReloads * 1e6 << " us\n";
+  std::remove(path.c_str());
+}
+
+// Startup with the camera1 table built, stored in the cache (miss) or
+// mapped from it (hit), and with the build moved to the background.
+void BenchUndistortCache(BenchContext& ctx) {
+  const std::string dir = "/tmp/roi_projector_bench_lut_cache";
+  std::filesystem::remove_all(dir);
+  roi_projector::UndistortLutOptions options;
+  auto load_us = [&](const roi_projector::UndistortLutOptions& opts) {
+    roi_projector::Projector projector;
+    const auto start = Clock::now();
+    projector.LoadCalibration(ctx.calib_path, opts);
+    return SecondsSince(start) * 1e6;
+  };
+  std::cout << "  LoadCalibration, no cache: " << load_us(options) << " us\n";
+  options.cache_dir = dir;
+  std::cout << "  LoadCalibration, cache miss: " << load_us(options)
+            << " us\n";
+  constexpr int kRounds = 50;
+  double hit_us = 0.0;
+  for (int r = 0; r < kRounds; ++r) {
+    hit_us += load_us(options) / kRounds;
+  }
+  std::cout << "  LoadCalibration, cache hit: " << hit_us << " us\n";
+
+  std::filesystem::remove_all(dir);
+  options.build_in_background = true;
+  roi_projector::SharedProjector shared;
+  const auto start = Clock::now();
+  shared.Load(ctx.calib_path, options);
+  const double published_us = SecondsSince(start) * 1e6;
+  while (shared.version() < 2) {
+    std::this_thread::yield();
+  }
+  std::cout << "  SharedProjector::Load, background build: first publish "
+            << published_us << " us, table after "
+            << SecondsSince(start) * 1e6 << " us\n";
+  std::filesystem::remove_all(dir);
+}
+
+#if defined(ROI_PROJECTOR_BENCH_STATIC_CALIBRATION)
+
+// The generated test calibration without distortion, as
+// WriteDistortionFreeCopy writes it.
+constexpr roi_projector::StaticCalibration WithoutDistortion(
+    roi_projector::StaticCalibration calib) {
+  for (int i = 0; i < 5; ++i) {
+    calib.dist1[i] = 0.0;
+    calib.dist2[i] = 0.0;
+  }
+  return calib;
+}
+
+constexpr roi_projector::StaticCalibration kBenchPinhole =
+    WithoutDistortion(roi_projector_generated::kTestCalibration);
+
+template <const roi_projector::StaticCalibration& kCalib>
+void BenchStaticCalibration(const char* name, const std::string& calib_path) {
+  constexpr size_t kPoints = 4096;
+  constexpr int kRounds = 200;
+  const auto pts = MakeSamples(kPoints);
+  std::vector<roi_projector::Point2D> ref(kPoints);
+  std::vector<roi_projector::Point2D> out(kPoints);
+
+  roi_projector::UndistortLutOptions no_lut;
+  no_lut.enabled = false;
+  roi_projector::Projector with_lut;
+  roi_projector::Projector projector;
+  if (calib_path.empty() || !with_lut.LoadCalibration(calib_path) ||
+      !projector.LoadCalibration(calib_path, no_lut)) {
+    return;
+  }
+  std::cout << "  " << name << "\n";
+  auto run = [&](const char* label, const roi_projector::Projector& p,
+                 std::vector<roi_projector::Point2D>& dst) {
+    const auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+      p.ProjectPoints(pts.data(), kPoints, dst.data(), nullptr);
+      g_sink = g_sink + dst[0].u;
+    }
+    Report(label, kPoints * kRounds, "pt", SecondsSince(start));
+  };
+  run("Projector, table", with_lut, out);
+  const roi_projector::KernelIsa saved = roi_projector::ActiveKernelIsa();
+  roi_projector::SetKernelIsa(roi_projector::KernelIsa::kScalar);
+  run("Projector, no table (scalar)", projector, ref);
+  roi_projector::SetKernelIsa(saved);
+  run("Projector, no table (active kernel)", projector, out);
+
+  using Static = roi_projector::StaticProjector<kCalib>;
+  const auto start = Clock::now();
+  for (int r = 0; r < kRounds; ++r) {
+    Static::ProjectPoints(pts.data(), kPoints, out.data(), nullptr);
+    g_sink = g_sink + out[0].u;
+  }
+  const double seconds = SecondsSince(start);
+  double max_diff = 0.0;
+  for (size_t i = 0; i < kPoints; ++i) {
+    max_diff = std::max({max_diff, std::fabs(out[i].u - ref[i].u),
+                         std::fabs(out[i].v - ref[i].v)});
+  }
+  Report("StaticProjector", kPoints * kRounds, "pt", seconds);
+  std::cout << "    max diff vs Projector (scalar, no table): " << max_diff
+            << " px\n";
+}
+
+// StaticProjector on the calibration compiled in from test/calib_out.json
+// against the runtime Projector; meaningful only when run on that file.
+void BenchStaticProjector(BenchContext& ctx) {
+  BenchStaticCalibration<roi_projector_generated::kTestCalibration>(
+      "distorted", ctx.calib_path);
+  BenchStaticCalibration<kBenchPinhole>(
+      "distortion-free", WriteDistortionFreeCopy(ctx.calib_path));
+}
+
+#else
+
+void BenchStaticProjector(BenchContext&) {
+  std::cout << "  not built (needs ROI_PROJECTOR_BUILD_TOOLS)\n";
+}
+
+#endif
+
+struct BenchEntry {
+  const char* name;
+  void (*fn)(BenchContext&);
+};
+
+const BenchEntry kBenches[] = {
+    {"project_points", BenchProjectPoints},
+    {"kernels", BenchKernels},
+    {"undistort_lut", BenchUndistortLut},
+    {"undistort_modes", BenchUndistortModes},
+    {"transform", BenchTransform},
+    {"specialized", BenchSpecialized},
+    {"roi_inside_quad", BenchRoiInsideQuad},
+    {"coverage", BenchCoverage},
+    {"assigner", BenchAssigner},
+    {"pair_coverage", BenchPairCoverage},
+    {"raster", BenchRaster},
+    {"dense_roi", BenchDenseRoi},
+    {"depth_sampler", BenchDepthSampler},
+    {"depth_integral", BenchDepthIntegral},
+    {"depth_pyramid", BenchDepthPyramid},
+    {"calibration_json", BenchCalibrationJson},
+    {"calibration_binary", BenchCalibrationBinary},
+    {"calibration_reload", BenchCalibrationReload},
+    {"undistort_cache", BenchUndistortCache},
+    {"static_projector", BenchStaticProjector},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchContext ctx;
+  ctx.calib_path = (argc > 1) ? argv[1] : "test/calib_out.json";
+  const std::string filter = (argc > 2) ? argv[2] : "";
+
+  if (!ctx.projector.LoadCalibration(ctx.calib_path)) {
+    std::cerr << "Failed to load calibration: " << ctx.calib_path << "\n";
+    return 1;
+  }
+
+  for (const auto& bench : kBenches) {
+    if (!filter.empty() && std::strstr(bench.name, filter.c_str()) == nullptr) {
+      continue;
+    }
+    std::cout << bench.name << "\n";
+    bench.fn(ctx);
+  }
+  return 0;
+}
@@ -0,0 +1,113 @@
+// Writes a calibration JSON file (the test/calib_out.json layout) as a C++
+// header defining a constexpr roi_projector::StaticCalibration, for
+// StaticProjector (static_projector.h). Keys are read as
+// Projector::LoadCalibration reads them.
+// Usage: roi_projector_calib_codegen <calib.json> <out.h>
+//            [--name kName] [--namespace ns]
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "calibration_json.h"
+
+namespace {
+
+// 17 significant digits read back as the same double.
+std::string Number(double value) {
+  char text[32];
+  std::snprintf(text, sizeof(text), "%.17g", value);
+  return text;
+}
+
+// Emits `rows` x `cols` numbers of `key` as a nested initializer. A short
+// or missing distortion array (`optional`) is written as zeros, as
+// LoadCalibration reads it; a short matrix is an error.
+bool EmitArray(const roi_projector::CalibrationJson& json, const char* key,
+               size_t rows, size_t cols, bool optional, std::ostream& out) {
+  const roi_projector::JsonNumbers numbers = json.Find(key);
+  const bool present = numbers.count >= rows * cols;
+  if (!present && !optional) {
+    std::cerr << "Missing or short array: " << key << "\n";
+    return false;
+  }
+  out << "    // " << key << "\n    {";
+  for (size_t r = 0; r < rows; ++r) {
+    if (rows > 1) {
+      out << (r == 0 ? "{" : "\n     {");
+    }
+    for (size_t c = 0; c < cols; ++c) {
+      out << (c == 0 ? "" : ", ")
+          << Number(present ? numbers.values[r * cols + c] : 0.0);
+    }
+    if (rows > 1) {
+      out << (r + 1 == rows ? "}" : "},");
+    }
+  }
+  out << "},\n";
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " <calib.json> <out.h> [--name kName] [--namespace ns]\n";
+    return 2;
+  }
+  std::string name = "kCalibration";
+  std::string ns;
+  for (int i = 3; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+      name = argv[++i];
+    } else if (std::strcmp(argv[i], "--namespace") == 0 && i + 1 < argc) {
+      ns = argv[++i];
+    } else {
+      std::cerr << "Unknown option: " << argv[i] << "\n";
+      return 2;
+    }
+  }
+
+  std::ifstream in(argv[1], std::ios::binary);
+  std::ostringstream text;
+  text << in.rdbuf();
+  const std::string json_text = text.str();
+  roi_projector::CalibrationJson json;
+  if (!in || !json.Parse(json_text)) {
+    std::cerr << "Failed to read calibration: " << argv[1] << "\n";
+    return 1;
+  }
+
+  std::ostringstream out;
+  out << "// Generated by roi_projector_calib_codegen from " << argv[1]
+      << ".\n// Do not edit; regenerate from the calibration file.\n"
+      << "#pragma once\n\n#include \"static_projector.h\"\n\n";
+  if (!ns.empty()) {
+    out << "namespace " << ns << " {\n\n";
+  }
+  out << "inline constexpr roi_projector::StaticCalibration " << name
+      << " = {\n";
+  if (!EmitArray(json, "extrinsic_matrix", 4, 4, false, out) ||
+      !EmitArray(json, "camera1_matrix", 3, 3, false, out) ||
+      !EmitArray(json, "camera2_matrix", 3, 3, false, out) ||
+      !EmitArray(json, "camera1_distortion", 1, 5, true, out) ||
+      !EmitArray(json, "camera2_distortion", 1, 5, true, out)) {
+    return 1;
+  }
+  out << "};\n";
+  if (!ns.empty()) {
+    out << "\n}  // namespace " << ns << "\n";
+  }
+
+  std::ofstream file(argv[2], std::ios::binary | std::ios::trunc);
+  file << out.str();
+  if (!file.flush()) {
+    std::cerr << "Failed to write: " << argv[2] << "\n";
+    return 1;
+  }
+  std::cout << "Wrote " << argv[2] << "\n";
+  return 0;
+}
@@ -0,0 +1,56 @@
+// Converts a calibration JSON file (the test/calib_out.json layout) into
+// the binary format of calibration_binary.h, with the camera1 undistortion
+// table built once here instead of at every start.
+// Usage: roi_projector_calib_convert <calib.json> <calib.bin>
+//            [--no-lut] [--lut-stride N]
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "roi_projector.h"
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " <calib.json> <calib.bin> [--no-lut] [--lut-stride N]\n";
+    return 2;
+  }
+  roi_projector::UndistortLutOptions options;
+  for (int i = 3; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--no-lut") == 0) {
+      options.enabled = false;
+    } else if (std::strcmp(argv[i], "--lut-stride") == 0 && i + 1 < argc) {
+      options.stride = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "Unknown option: " << argv[i] << "\n";
+      return 2;
+    }
+  }
+
+  // Only kFast builds the table.
+  roi_projector::Projector projector;
+  projector.SetUndistortMode(roi_projector::UndistortMode::kFast);
+  if (!projector.LoadCalibration(argv[1], options)) {
+    std::cerr << "Failed to load calibration: " << argv[1] << "\n";
+    return 1;
+  }
+  if (!projector.SaveCalibrationBinary(argv[2])) {
+    std::cerr << "Failed to write: " << argv[2] << "\n";
+    return 1;
+  }
+  // Read back so a bad write is caught here rather than at startup.
+  roi_projector::Projector check;
+  if (!check.LoadCalibrationBinary(argv[2])) {
+    std::cerr << "Written file does not load: " << argv[2] << "\n";
+    return 1;
+  }
+  std::cout << "Wrote " << argv[2];
+  if (const roi_projector::UndistortLut* lut = check.undistort_lut()) {
+    std::cout << " with a " << lut->cols << "x" << lut->rows
+              << " camera1 table (stride " << lut->stride << ", "
+              << lut->SizeBytes() << " bytes)";
+  }
+  std::cout << "\n";
+  return 0;
+}
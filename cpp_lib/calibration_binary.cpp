@@ -0,0 +1,294 @@
+// Binary calibration files: checksum, writer and mmap loader.
+#include "calibration_binary.h"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "mapped_file.h"
+#include "roi_projector.h"
+
+namespace roi_projector {
+
+namespace {
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+constexpr bool kLittleEndianHost = true;
+#else
+constexpr bool kLittleEndianHost = false;
+#endif
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ull;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ull;
+
+uint64_t Rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+uint64_t Read64(const unsigned char* p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+uint32_t Read32(const unsigned char* p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+uint64_t Round(uint64_t acc, uint64_t input) {
+  acc += input * kPrime2;
+  return Rotl(acc, 31) * kPrime1;
+}
+
+uint64_t MergeRound(uint64_t acc, uint64_t value) {
+  acc ^= Round(0, value);
+  return acc * kPrime1 + kPrime4;
+}
+
+constexpr size_t kAlignment = 64;
+
+size_t AlignUp(size_t offset) {
+  return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Offset of the first checksummed byte.
+constexpr size_t kChecksumStart =
+    offsetof(CalibrationFileHeader, checksum) + sizeof(uint64_t);
+
+// Offsets, flags and table size agree with each other and with the file,
+// whose size and block bounds are already checked.
+bool CheckLayout(const CalibrationFileHeader& header,
+                 const CalibrationFileBlock& block, size_t file_bytes) {
+  if (header.block_offset % kAlignment != 0 ||
+      header.block_offset < sizeof(CalibrationFileHeader) ||
+      (header.flags & ~uint32_t{kCalibrationHasLut1}) != 0) {
+    return false;
+  }
+  if ((header.flags & kCalibrationHasLut1) == 0) {
+    return header.lut_offset == 0 && header.lut_bytes == 0;
+  }
+  if (block.lut_cols < 2 || block.lut_rows < 2 || block.lut_stride < 1) {
+    return false;
+  }
+  const uint64_t lut_bytes = static_cast<uint64_t>(block.lut_cols) *
+                             static_cast<uint64_t>(block.lut_rows) * 2 *
+                             sizeof(float);
+  return header.lut_bytes == lut_bytes &&
+         header.lut_offset % kAlignment == 0 &&
+         header.lut_offset >= header.block_offset + header.block_bytes &&
+         header.lut_offset <= file_bytes &&
+         lut_bytes <= file_bytes - header.lut_offset;
+}
+
+}  // namespace
+
+uint64_t CalibrationChecksum(const void* data, size_t size) noexcept {
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  const unsigned char* const end = p + size;
+  uint64_t h;
+  if (size >= 32) {
+    // Four independent lanes of 8 bytes each per 32-byte stripe.
+    uint64_t v1 = kPrime1 + kPrime2;
+    uint64_t v2 = kPrime2;
+    uint64_t v3 = 0;
+    uint64_t v4 = 0 - kPrime1;
+    const unsigned char* const limit = end - 32;
+    do {
+      v1 = Round(v1, Read64(p));
+      v2 = Round(v2, Read64(p + 8));
+      v3 = Round(v3, Read64(p + 16));
+      v4 = Round(v4, Read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+    h = MergeRound(h, v1);
+    h = MergeRound(h, v2);
+    h = MergeRound(h, v3);
+    h = MergeRound(h, v4);
+  } else {
+    h = kPrime5;
+  }
+  h += static_cast<uint64_t>(size);
+  for (; p + 8 <= end; p += 8) {
+    h ^= Round(0, Read64(p));
+    h = Rotl(h, 27) * kPrime1 + kPrime4;
+  }
+  if (p + 4 <= end) {
+    h ^= static_cast<uint64_t>(Read32(p)) * kPrime1;
+    h = Rotl(h, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    h ^= static_cast<uint64_t>(*p) * kPrime5;
+    h = Rotl(h, 11) * kPrime1;
+  }
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+bool Projector::SaveCalibrationBinary(const std::string& file_path) const {
+  if (!has_calibration_ || !kLittleEndianHost) {
+    return false;
+  }
+  CalibrationFileBlock block{};
+  for (size_t r = 0; r < 4; ++r) {
+    for (size_t c = 0; c < 4; ++c) {
+      block.extrinsic[r * 4 + c] = extrinsic_[r][c];
+    }
+  }
+  for (size_t r = 0; r < 3; ++r) {
+    for (size_t c = 0; c < 3; ++c) {
+      block.camera1[r * 3 + c] = camera1_[r][c];
+      block.camera2[r * 3 + c] = camera2_[r][c];
+    }
+  }
+  const CompiledCalibration& p = compiled_;
+  for (size_t i = 0; i < 5; ++i) {
+    block.dist1[i] = dist1_[i];
+    block.dist2[i] = dist2_[i];
+  }
+  block.inv_fx1 = p.inv_fx1;
+  block.inv_fy1 = p.inv_fy1;
+  block.cx1 = p.cx1;
+  block.cy1 = p.cy1;
+  for (size_t r = 0; r < 3; ++r) {
+    for (size_t c = 0; c < 4; ++c) {
+      block.rt[r * 4 + c] = p.rt[r][c];
+      block.k2rt[r * 4 + c] = p.k2rt[r][c];
+    }
+  }
+  block.fx2 = p.fx2;
+  block.fy2 = p.fy2;
+  block.cx2 = p.cx2;
+  block.cy2 = p.cy2;
+
+  CalibrationFileHeader header{};
+  std::memcpy(header.magic, kCalibrationMagic, sizeof(header.magic));
+  header.version = kCalibrationFormatVersion;
+  header.block_offset = AlignUp(sizeof(CalibrationFileHeader));
+  header.block_bytes = sizeof(CalibrationFileBlock);
+  size_t file_bytes = header.block_offset + header.block_bytes;
+  const UndistortLut* lut = lut1_.get();
+  if (lut != nullptr) {
+    header.flags |= kCalibrationHasLut1;
+    header.lut_offset = AlignUp(file_bytes);
+    header.lut_bytes = lut->SizeBytes();
+    file_bytes = header.lut_offset + header.lut_bytes;
+    block.lut_inv_stride = lut->inv_stride;
+    block.lut_max_residual = lut->max_residual;
+    block.lut_width = lut->width;
+    block.lut_height = lut->height;
+    block.lut_stride = lut->stride;
+    block.lut_cols = lut->cols;
+    block.lut_rows = lut->rows;
+  }
+  header.file_bytes = file_bytes;
+
+  std::vector<unsigned char> bytes(file_bytes, 0);
+  unsigned char* const out = bytes.data();
+  std::memcpy(out, &header, sizeof(header));
+  std::memcpy(out + header.block_offset, &block, sizeof(block));
+  if (lut != nullptr) {
+    std::memcpy(out + header.lut_offset, lut->data, header.lut_bytes);
+  }
+  header.checksum = CalibrationChecksum(bytes.data() + kChecksumStart,
+                                        file_bytes - kChecksumStart);
+  std::memcpy(bytes.data(), &header, sizeof(header));
+  return WriteFileAtomically(file_path, bytes.data(), bytes.size());
+}
+
+bool Projector::LoadCalibrationBinary(const std::string& file_path) {
+  if (!kLittleEndianHost) {
+    return false;
+  }
+  std::shared_ptr<const MappedFile> file = MappedFile::Open(file_path);
+  if (file == nullptr ||
+      file->size() < sizeof(CalibrationFileHeader) +
+                         sizeof(CalibrationFileBlock)) {
+    return false;
+  }
+  CalibrationFileHeader header;
+  std::memcpy(&header, file->data(), sizeof(header));
+  if (std::memcmp(header.magic, kCalibrationMagic, sizeof(header.magic)) !=
+          0 ||
+      header.version != kCalibrationFormatVersion) {
+    return false;
+  }
+  // Sizes come first so the block read below stays inside the file.
+  if (header.file_bytes != file->size() ||
+      header.block_bytes != sizeof(CalibrationFileBlock) ||
+      header.block_offset > file->size() - sizeof(CalibrationFileBlock)) {
+    return false;
+  }
+  CalibrationFileBlock block;
+  std::memcpy(&block, file->data() + header.block_offset, sizeof(block));
+  if (!CheckLayout(header, block, file->size()) ||
+      CalibrationChecksum(file->data() + kChecksumStart,
+                          file->size() - kChecksumStart) != header.checksum) {
+    return false;
+  }
+
+  std::shared_ptr<UndistortLut> lut;
+  if ((header.flags & kCalibrationHasLut1) != 0) {
+    // Used in place; the table keeps the mapping alive.
+    lut = std::make_shared<UndistortLut>();
+    lut->width = block.lut_width;
+    lut->height = block.lut_height;
+    lut->stride = block.lut_stride;
+    lut->cols = block.lut_cols;
+    lut->rows = block.lut_rows;
+    lut->inv_stride = block.lut_inv_stride;
+    lut->max_residual = block.lut_max_residual;
+    lut->data =
+        reinterpret_cast<const float*>(file->data() + header.lut_offset);
+    lut->mapping = file;
+  }
+
+  for (size_t r = 0; r < 4; ++r) {
+    for (size_t c = 0; c < 4; ++c) {
+      extrinsic_[r][c] = block.extrinsic[r * 4 + c];
+    }
+  }
+  for (size_t r = 0; r < 3; ++r) {
+    for (size_t c = 0; c < 3; ++c) {
+      camera1_[r][c] = block.camera1[r * 3 + c];
+      camera2_[r][c] = block.camera2[r * 3 + c];
+    }
+  }
+  CompiledCalibration& p = compiled_;
+  for (size_t i = 0; i < 5; ++i) {
+    dist1_[i] = block.dist1[i];
+    dist2_[i] = block.dist2[i];
+    p.dist1[i] = block.dist1[i];
+    p.dist2[i] = block.dist2[i];
+  }
+  p.inv_fx1 = block.inv_fx1;
+  p.inv_fy1 = block.inv_fy1;
+  p.cx1 = block.cx1;
+  p.cy1 = block.cy1;
+  for (size_t r = 0; r < 3; ++r) {
+    for (size_t c = 0; c < 4; ++c) {
+      p.rt[r][c] = block.rt[r * 4 + c];
+      p.k2rt[r][c] = block.k2rt[r * 4 + c];
+    }
+  }
+  p.fx2 = block.fx2;
+  p.fy2 = block.fy2;
+  p.cx2 = block.cx2;
+  p.cy2 = block.cy2;
+  p.has_dist1 = HasDistortion(dist1_);
+  p.has_dist2 = HasDistortion(dist2_);
+  lut1_ = std::move(lut);
+  has_calibration_ = true;
+  SetUndistortMode(undistort_mode_);
+  return true;
+}
+
+}  // namespace roi_projector
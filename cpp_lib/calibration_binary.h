@@ -0,0 +1,79 @@
+// Binary calibration file, loaded by Projector::LoadCalibrationBinary with
+// one mmap and no parsing, so restarting stations skip the JSON parse and
+// the undistortion table build.
+//
+// Layout, little-endian throughout, doubles in IEEE-754 binary64:
+//
+//   CalibrationFileHeader   64 bytes at offset 0
+//   CalibrationFileBlock    at block_offset (64-byte aligned)
+//   camera1 table           at lut_offset (64-byte aligned), if flagged:
+//                           lut_cols * lut_rows (x, y) float pairs, as
+//                           UndistortLut::data
+//
+// The checksum covers every byte after the checksum field, to the end of
+// the file. Written by Projector::SaveCalibrationBinary or by the
+// roi_projector_calib_convert tool from a calibration JSON file.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace roi_projector {
+
+constexpr char kCalibrationMagic[8] = {'R', 'O', 'I', 'C', 'A', 'L', 'B', '\0'};
+// Bumped on any layout change; other versions are rejected.
+constexpr uint32_t kCalibrationFormatVersion = 2;
+
+enum CalibrationFileFlags : uint32_t {
+  kCalibrationHasLut1 = 1u << 0,
+};
+
+struct CalibrationFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;          // CalibrationFileFlags
+  uint64_t checksum;       // CalibrationChecksum of the rest of the file
+  uint64_t file_bytes;     // size of the whole file
+  uint64_t block_offset;
+  uint64_t block_bytes;    // sizeof(CalibrationFileBlock)
+  uint64_t lut_offset;     // 0 without a table
+  uint64_t lut_bytes;
+};
+
+// The calibration as loaded from JSON, then the fused values of
+// CompiledCalibration so loading computes nothing.
+struct CalibrationFileBlock {
+  double extrinsic[16];  // 4x4, row-major
+  double camera1[9];     // 3x3, row-major
+  double camera2[9];
+  double dist1[5];       // k1,k2,p1,p2,k3
+  double dist2[5];
+  double inv_fx1;
+  double inv_fy1;
+  double cx1;
+  double cy1;
+  double rt[12];    // 3x4
+  double k2rt[12];  // 3x4
+  double fx2;
+  double fy2;
+  double cx2;
+  double cy2;
+  // camera1 table geometry, as UndistortLut; zero without a table.
+  double lut_inv_stride;
+  double lut_max_residual;
+  int32_t lut_width;
+  int32_t lut_height;
+  int32_t lut_stride;
+  int32_t lut_cols;
+  int32_t lut_rows;
+  int32_t reserved[3];
+};
+
+static_assert(sizeof(CalibrationFileHeader) == 64, "header layout");
+static_assert(sizeof(CalibrationFileBlock) % 8 == 0, "block layout");
+
+// 64-bit XXH64 hash (seed 0) of `size` bytes; about 10 GB/s, so checking a
+// file with a 1.2 MB table costs on the order of 100 us.
+uint64_t CalibrationChecksum(const void* data, size_t size) noexcept;
+
+}  // namespace roi_projector
@@ -0,0 +1,257 @@
+// Single-pass calibration JSON index.
+#include "calibration_json.h"
+
+#include <charconv>
+#include <cstring>
+
+#if !defined(__cpp_lib_to_chars)
+#include <cerrno>
+#include <clocale>
+#include <cstdlib>
+#include <string>
+#endif
+
+namespace roi_projector {
+
+namespace {
+
+// `text` is a number in JSON's grammar. Out-of-range values fail.
+bool ConvertNumber(const char* text, const char* end, double& out) {
+#if defined(__cpp_lib_to_chars)
+  const std::from_chars_result result = std::from_chars(text, end, out);
+  return result.ec == std::errc() && result.ptr == end;
+#else
+  // libstdc++ before GCC 11 (the aarch64 cross toolchain) has no
+  // floating-point from_chars; strtod_l in the C locale reads the same
+  // values from a terminated copy.
+  static const locale_t c_locale = newlocale(LC_ALL_MASK, "C", nullptr);
+  const std::string copy(text, end);
+  char* stop = nullptr;
+  errno = 0;
+  out = strtod_l(copy.c_str(), &stop, c_locale);
+  return stop == copy.c_str() + copy.size() && errno != ERANGE;
+#endif
+}
+
+// Where the numbers of the array being read go; `numeric` drops to false
+// at the first element that is not a number or an array.
+struct NumberSink {
+  std::vector<double>* values = nullptr;
+  bool numeric = true;
+};
+
+class JsonReader {
+ public:
+  explicit JsonReader(std::string_view text)
+      : p_(text.data()), end_(text.data() + text.size()) {}
+
+  // Next non-whitespace character, or '\0' at the end.
+  char Peek() {
+    while (p_ < end_ &&
+           (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) {
+      ++p_;
+    }
+    return p_ < end_ ? *p_ : '\0';
+  }
+
+  bool Consume(char c) {
+    if (Peek() != c) {
+      return false;
+    }
+    ++p_;
+    return true;
+  }
+
+  bool AtEnd() { return Peek() == '\0' && p_ == end_; }
+
+  // Contents between the quotes, escapes left as written.
+  bool String(std::string_view& out) {
+    if (!Consume('"')) {
+      return false;
+    }
+    const char* begin = p_;
+    for (;;) {
+      const void* quote =
+          std::memchr(p_, '"', static_cast<size_t>(end_ - p_));
+      if (quote == nullptr) {
+        return false;
+      }
+      p_ = static_cast<const char*>(quote);
+      // Escaped when preceded by an odd run of backslashes.
+      const char* run = p_;
+      while (run > begin && run[-1] == '\\') {
+        --run;
+      }
+      if ((p_ - run) % 2 == 0) {
+        break;
+      }
+      ++p_;
+    }
+    out = std::string_view(begin, static_cast<size_t>(p_ - begin));
+    ++p_;
+    return true;
+  }
+
+  // Any value. Numbers in arrays are appended to `sink` when given.
+  bool Value(int depth, NumberSink* sink) {
+    if (depth > kMaxCalibrationJsonDepth) {
+      return false;
+    }
+    const char c = Peek();
+    if (c == '[') {
+      ++p_;
+      if (Consume(']')) {
+        return true;
+      }
+      do {
+        if (!Value(depth + 1, sink)) {
+          return false;
+        }
+      } while (Consume(','));
+      return Consume(']');
+    }
+    if (sink != nullptr) {
+      sink->numeric = sink->numeric && (c == '-' || IsDigit(c));
+    }
+    if (c == '{') {
+      ++p_;
+      if (Consume('}')) {
+        return true;
+      }
+      do {
+        std::string_view key;
+        if (!String(key) || !Consume(':') || !Value(depth + 1, nullptr)) {
+          return false;
+        }
+      } while (Consume(','));
+      return Consume('}');
+    }
+    if (c == '"') {
+      std::string_view ignored;
+      return String(ignored);
+    }
+    if (c == 't') {
+      return Literal("true");
+    }
+    if (c == 'f') {
+      return Literal("false");
+    }
+    if (c == 'n') {
+      return Literal("null");
+    }
+    const char* begin = p_;
+    if (!SkipNumber()) {
+      return false;
+    }
+    // Only numbers that are kept are converted.
+    if (sink != nullptr && sink->numeric) {
+      double value = 0.0;
+      if (!ConvertNumber(begin, p_, value)) {
+        return false;
+      }
+      sink->values->push_back(value);
+    }
+    return true;
+  }
+
+ private:
+  static bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+  bool Literal(std::string_view word) {
+    if (static_cast<size_t>(end_ - p_) < word.size() ||
+        std::string_view(p_, word.size()) != word) {
+      return false;
+    }
+    p_ += word.size();
+    return true;
+  }
+
+  bool Digits() {
+    const char* begin = p_;
+    while (p_ < end_ && IsDigit(*p_)) {
+      ++p_;
+    }
+    return p_ != begin;
+  }
+
+  // Moves past a number in JSON's grammar, which is stricter than what
+  // from_chars takes ("inf", ".5", "1.", "01").
+  bool SkipNumber() {
+    if (p_ < end_ && *p_ == '-') {
+      ++p_;
+    }
+    if (p_ < end_ && *p_ == '0') {
+      ++p_;
+    } else if (!Digits()) {
+      return false;
+    }
+    if (p_ < end_ && *p_ == '.') {
+      ++p_;
+      if (!Digits()) {
+        return false;
+      }
+    }
+    if (p_ < end_ && (*p_ == 'e' || *p_ == 'E')) {
+      ++p_;
+      if (p_ < end_ && (*p_ == '+' || *p_ == '-')) {
+        ++p_;
+      }
+      return Digits();
+    }
+    return true;
+  }
+
+  const char* p_;
+  const char* end_;
+};
+
+}  // namespace
+
+bool CalibrationJson::Parse(std::string_view text) {
+  entries_.clear();
+  values_.clear();
+  JsonReader reader(text);
+  bool ok = reader.Consume('{');
+  if (ok && !reader.Consume('}')) {
+    do {
+      std::string_view key;
+      if (!reader.String(key) || !reader.Consume(':')) {
+        ok = false;
+        break;
+      }
+      const size_t offset = values_.size();
+      const bool array = reader.Peek() == '[';
+      NumberSink sink{&values_, true};
+      if (!reader.Value(1, array ? &sink : nullptr)) {
+        ok = false;
+        break;
+      }
+      if (array && sink.numeric) {
+        entries_.push_back({key, offset, values_.size() - offset});
+      } else {
+        values_.resize(offset);
+      }
+    } while (reader.Consume(','));
+    ok = ok && reader.Consume('}');
+  }
+  if (!ok || !reader.AtEnd()) {
+    entries_.clear();
+    values_.clear();
+    return false;
+  }
+  return true;
+}
+
+JsonNumbers CalibrationJson::Find(std::string_view key) const noexcept {
+  JsonNumbers numbers;
+  for (const Entry& entry : entries_) {
+    if (entry.key == key) {
+      numbers.values = values_.data() + entry.offset;
+      numbers.count = entry.count;
+      break;
+    }
+  }
+  return numbers;
+}
+
+}  // namespace roi_projector
@@ -0,0 +1,53 @@
+// Internal: single-pass index of a calibration JSON file, used by
+// Projector::LoadCalibration. Not installed.
+//
+// One sweep over the text checks that it is well-formed JSON and records,
+// for every top-level key whose value is an array of numbers (nested
+// arrays flattened row-major), where its numbers are. Keys nested in other
+// values or appearing inside strings are never matched. Numbers are read
+// with std::from_chars (strtod_l in the C locale on older libstdc++), so
+// parsing does not depend on the process locale.
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace roi_projector {
+
+// Values inside more than this many objects and arrays (the top-level
+// object included) are rejected rather than recursed into.
+constexpr int kMaxCalibrationJsonDepth = 64;
+
+struct JsonNumbers {
+  const double* values = nullptr;
+  size_t count = 0;
+};
+
+class CalibrationJson {
+ public:
+  // Indexes `text`, which must outlive the index (keys point into it).
+  // Returns false, leaving the index empty, unless `text` is one JSON
+  // object. Storage is reused across calls.
+  bool Parse(std::string_view text);
+
+  // Numbers of top-level `key` (compared as written, escapes included);
+  // empty when the key is missing or its value is not an array of numbers.
+  // The first of duplicate keys wins.
+  JsonNumbers Find(std::string_view key) const noexcept;
+
+  // Indexed keys.
+  size_t size() const noexcept { return entries_.size(); }
+
+ private:
+  struct Entry {
+    std::string_view key;
+    size_t offset = 0;  // into values_
+    size_t count = 0;
+  };
+
+  std::vector<Entry> entries_;
+  std::vector<double> values_;
+};
+
+}  // namespace roi_projector
@@ -0,0 +1,275 @@
+// Snapshot publication with epoch-based reclamation, and the inotify
+// calibration watcher.
+#include "calibration_reload.h"
+
+#include <filesystem>
+#include <utility>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace roi_projector {
+
+namespace {
+
+// Stripe of the calling thread, assigned round-robin on first use.
+int ThreadStripe() noexcept {
+  static std::atomic<uint32_t> next_stripe{0};
+  thread_local const int stripe = static_cast<int>(
+      next_stripe.fetch_add(1, std::memory_order_relaxed) %
+      kSnapshotReaderStripes);
+  return stripe;
+}
+
+}  // namespace
+
+SharedProjector::Snapshot::Snapshot(Snapshot&& other) noexcept
+    : projector_(std::exchange(other.projector_, nullptr)),
+      readers_(std::exchange(other.readers_, nullptr)) {}
+
+SharedProjector::Snapshot& SharedProjector::Snapshot::operator=(
+    Snapshot&& other) noexcept {
+  if (this != &other) {
+    Release();
+    projector_ = std::exchange(other.projector_, nullptr);
+    readers_ = std::exchange(other.readers_, nullptr);
+  }
+  return *this;
+}
+
+void SharedProjector::Snapshot::Release() noexcept {
+  if (readers_ != nullptr) {
+    // Release: everything read through projector_ happens before a
+    // publisher that sees the count drop frees it.
+    readers_->fetch_sub(1, std::memory_order_release);
+    readers_ = nullptr;
+  }
+  projector_ = nullptr;
+}
+
+SharedProjector::~SharedProjector() {
+  if (builder_.joinable()) {
+    builder_.join();
+  }
+  delete current_.load(std::memory_order_acquire);
+}
+
+SharedProjector::Snapshot SharedProjector::Acquire() const noexcept {
+  // The reader registers in the current epoch, then checks the epoch did
+  // not move in between: a registration that passes the check is ordered
+  // before any later publish's epoch flip, so that publish waits for it,
+  // and the projector loaded after it is at least as new as that epoch.
+  // Sequentially consistent throughout for that store-load ordering.
+  Snapshot snapshot;
+  ReaderStripe* const stripes[2] = {readers_[0], readers_[1]};
+  const int stripe = ThreadStripe();
+  for (;;) {
+    const uint64_t epoch = epoch_.load();
+    std::atomic<int64_t>& readers = stripes[epoch & 1][stripe].count;
+    readers.fetch_add(1);
+    if (epoch_.load() == epoch) {
+      snapshot.readers_ = &readers;
+      break;
+    }
+    // A publish flipped the epoch meanwhile; register again.
+    readers.fetch_sub(1, std::memory_order_relaxed);
+  }
+  snapshot.projector_ = current_.load();
+  return snapshot;
+}
+
+void SharedProjector::Publish(std::unique_ptr<const Projector> projector) {
+  if (projector == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(publish_mutex_);
+  PublishLocked(projector.release());
+}
+
+uint64_t SharedProjector::PublishLocked(const Projector* projector) {
+  const Projector* previous = current_.exchange(projector);
+  const uint64_t version =
+      version_.fetch_add(1, std::memory_order_release) + 1;
+  WaitForReaders();
+  delete previous;
+  return version;
+}
+
+void SharedProjector::PublishIf(const Projector* projector,
+                                uint64_t expected_version) {
+  std::lock_guard<std::mutex> lock(publish_mutex_);
+  if (version_.load(std::memory_order_relaxed) != expected_version) {
+    delete projector;
+    return;
+  }
+  PublishLocked(projector);
+}
+
+void SharedProjector::WaitForReaders() {
+  // Readers registering from here on use the other parity and load the
+  // new projector, so only this parity can still hold the previous one.
+  const uint64_t epoch = epoch_.fetch_add(1);
+  ReaderStripe* const stripes = readers_[epoch & 1];
+  for (int i = 0; i < kSnapshotReaderStripes; ++i) {
+    while (stripes[i].count.load() != 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+bool SharedProjector::Load(const std::string& file_path,
+                           const UndistortLutOptions& lut_options) {
+  std::lock_guard<std::mutex> lock(load_mutex_);
+  // A build still running for an older load would not be published.
+  if (builder_.joinable()) {
+    builder_.join();
+  }
+  auto projector = std::make_unique<Projector>();
+  {
+    const Snapshot current = Acquire();
+    if (current) {
+      projector->SetUndistortMode(current->undistort_mode());
+    }
+  }
+  bool build_later = false;
+  if (!projector->LoadCalibrationBinary(file_path)) {
+    if (!projector->LoadCalibration(file_path, lut_options)) {
+      return false;
+    }
+    // Only kFast builds a table (see UndistortMode).
+    build_later = lut_options.enabled && lut_options.build_in_background &&
+                  projector->undistort_mode() == UndistortMode::kFast &&
+                  projector->compiled_calibration().has_dist1 &&
+                  projector->undistort_lut() == nullptr;
+  }
+  if (!build_later) {
+    Publish(std::move(projector));
+    return true;
+  }
+  // The calibration is served without the table (per-point solve) while
+  // a copy gets one.
+  auto with_table = std::make_unique<Projector>(*projector);
+  uint64_t version;
+  {
+    std::lock_guard<std::mutex> publish_lock(publish_mutex_);
+    version = PublishLocked(projector.release());
+  }
+  builder_ = std::thread(
+      [this, lut_options, version](std::unique_ptr<Projector> next) {
+        next->RebuildUndistortLut(lut_options);
+        PublishIf(next.release(), version);
+      },
+      std::move(with_table));
+  return true;
+}
+
+#if defined(__linux__)
+
+bool CalibrationWatcher::Start(SharedProjector& target,
+                               const std::string& file_path,
+                               const UndistortLutOptions& lut_options,
+                               CalibrationReloadCallback callback,
+                               void* user) {
+  if (running()) {
+    return false;
+  }
+  // The directory is watched rather than the file, whose inode changes
+  // when a new version is renamed over it.
+  std::filesystem::path dir = std::filesystem::path(file_path).parent_path();
+  if (dir.empty()) {
+    dir = ".";
+  }
+  inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  stop_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (inotify_fd_ < 0 || stop_fd_ < 0 ||
+      ::inotify_add_watch(inotify_fd_, dir.c_str(),
+                          IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    Stop();
+    return false;
+  }
+  thread_ = std::thread(&CalibrationWatcher::Run, this, &target, file_path,
+                        lut_options, callback, user);
+  return true;
+}
+
+void CalibrationWatcher::Stop() {
+  if (thread_.joinable()) {
+    const uint64_t one = 1;
+    (void)!::write(stop_fd_, &one, sizeof(one));
+    thread_.join();
+  }
+  if (inotify_fd_ >= 0) {
+    ::close(inotify_fd_);
+    inotify_fd_ = -1;
+  }
+  if (stop_fd_ >= 0) {
+    ::close(stop_fd_);
+    stop_fd_ = -1;
+  }
+}
+
+void CalibrationWatcher::Run(SharedProjector* target, std::string file_path,
+                             UndistortLutOptions lut_options,
+                             CalibrationReloadCallback callback, void* user) {
+  // Changes arriving within this long of each other are one reload.
+  constexpr int kSettleMs = 20;
+  const std::string name =
+      std::filesystem::path(file_path).filename().string();
+  alignas(struct inotify_event) char buffer[4096];
+  bool pending = false;
+  for (;;) {
+    pollfd fds[2] = {{stop_fd_, POLLIN, 0}, {inotify_fd_, POLLIN, 0}};
+    const int ready = ::poll(fds, 2, pending ? kSettleMs : -1);
+    if (ready < 0) {
+      continue;  // EINTR
+    }
+    if ((fds[0].revents & POLLIN) != 0) {
+      return;
+    }
+    if (ready == 0) {
+      // Quiet for kSettleMs after a change: reload now.
+      pending = false;
+      const bool ok = target->Load(file_path, lut_options);
+      if (callback != nullptr) {
+        callback(file_path, ok, user);
+      }
+      continue;
+    }
+    ssize_t bytes;
+    while ((bytes = ::read(inotify_fd_, buffer, sizeof(buffer))) > 0) {
+      for (ssize_t offset = 0; offset < bytes;) {
+        const auto* event =
+            reinterpret_cast<const struct inotify_event*>(buffer + offset);
+        // A queue overflow may have dropped this file's events.
+        if ((event->mask & IN_Q_OVERFLOW) != 0 ||
+            (event->len > 0 && name == event->name)) {
+          pending = true;
+        }
+        offset += static_cast<ssize_t>(sizeof(struct inotify_event)) +
+                  static_cast<ssize_t>(event->len);
+      }
+    }
+  }
+}
+
+#else
+
+bool CalibrationWatcher::Start(SharedProjector&, const std::string&,
+                               const UndistortLutOptions&,
+                               CalibrationReloadCallback, void*) {
+  return false;
+}
+
+void CalibrationWatcher::Stop() {}
+
+void CalibrationWatcher::Run(SharedProjector*, std::string,
+                             UndistortLutOptions, CalibrationReloadCallback,
+                             void*) {}
+
+#endif
+
+}  // namespace roi_projector
@@ -0,0 +1,155 @@
+// Calibration hot reload while other threads project.
+//
+// A Projector is not synchronized: LoadCalibration rewrites it in place, so
+// loading into one that other threads are projecting through is a data
+// race. SharedProjector instead publishes immutable Projector snapshots.
+// Readers pin the current snapshot with a few atomic operations and never
+// wait or take a lock. A writer builds the next snapshot to the side
+// (parse, undistortion table, fused matrices), swaps it in with one atomic
+// store, and frees the previous one once the readers that pinned it are
+// done (epoch-based reclamation, as in userspace RCU).
+//
+// CalibrationWatcher reloads a calibration file on a background thread
+// whenever it is rewritten (inotify, Linux only).
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "roi_projector.h"
+
+namespace roi_projector {
+
+// Reader counters are striped by thread so concurrent readers rarely share
+// a cache line.
+constexpr int kSnapshotReaderStripes = 16;
+
+class SharedProjector {
+ public:
+  // Pins one published Projector until destroyed; every call through it
+  // sees the same calibration. Keep it for a frame or an ROI, not across
+  // waits: publishing waits for snapshots of the previous calibration.
+  class Snapshot {
+   public:
+    Snapshot() = default;
+    Snapshot(Snapshot&& other) noexcept;
+    Snapshot& operator=(Snapshot&& other) noexcept;
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+    ~Snapshot() { Release(); }
+
+    // Null before the first calibration is published.
+    const Projector* get() const noexcept { return projector_; }
+    const Projector* operator->() const noexcept { return projector_; }
+    const Projector& operator*() const noexcept { return *projector_; }
+    explicit operator bool() const noexcept { return projector_ != nullptr; }
+
+   private:
+    friend class SharedProjector;
+    void Release() noexcept;
+
+    const Projector* projector_ = nullptr;
+    std::atomic<int64_t>* readers_ = nullptr;
+  };
+
+  SharedProjector() = default;
+  // No snapshot may outlive the SharedProjector. Waits for a background
+  // table build.
+  ~SharedProjector();
+  SharedProjector(const SharedProjector&) = delete;
+  SharedProjector& operator=(const SharedProjector&) = delete;
+
+  // Lock-free; never blocks on a concurrent Publish.
+  Snapshot Acquire() const noexcept;
+
+  // Makes `projector` current. Returns once no snapshot of the previous
+  // calibration is left, which it then frees; call it off the projection
+  // threads. Publishes are serialized. A null `projector` is ignored.
+  void Publish(std::unique_ptr<const Projector> projector);
+
+  // Loads `file_path` into a new Projector, as a binary calibration file
+  // (calibration_binary.h) or else as JSON with `lut_options`, and
+  // publishes it with the current undistortion mode. Returns false,
+  // publishing nothing, if the file does not load.
+  //
+  // In kFast, with lut_options.build_in_background and the camera1 table
+  // not in the cache, the calibration is published without a table and a
+  // background thread builds (and caches) it, then publishes the
+  // calibration again with it, unless another calibration was published
+  // meanwhile.
+  bool Load(const std::string& file_path,
+            const UndistortLutOptions& lut_options = UndistortLutOptions());
+
+  // Successful publications so far.
+  uint64_t version() const noexcept {
+    return version_.load(std::memory_order_acquire);
+  }
+
+ private:
+  struct alignas(64) ReaderStripe {
+    std::atomic<int64_t> count{0};
+  };
+
+  // Makes `projector` current and frees the previous one; publish_mutex_
+  // must be held. Returns the new version.
+  uint64_t PublishLocked(const Projector* projector);
+  // Publishes `projector` if the version is still `expected_version`;
+  // otherwise frees it.
+  void PublishIf(const Projector* projector, uint64_t expected_version);
+  // Waits until no reader that may have seen the projector replaced by the
+  // caller is left.
+  void WaitForReaders();
+
+  std::atomic<const Projector*> current_{nullptr};
+  std::atomic<uint64_t> version_{0};
+  // Readers count themselves in the stripes of the epoch's parity; a
+  // publish moves new readers to the other parity and drains the old one.
+  std::atomic<uint64_t> epoch_{0};
+  mutable ReaderStripe readers_[2][kSnapshotReaderStripes];
+  std::mutex publish_mutex_;
+  std::mutex load_mutex_;  // serializes Load and guards builder_
+  std::thread builder_;    // background table build, if any
+};
+
+// Called on the watcher thread after each reload attempt.
+using CalibrationReloadCallback = void (*)(const std::string& file_path,
+                                           bool ok, void* user);
+
+class CalibrationWatcher {
+ public:
+  CalibrationWatcher() = default;
+  ~CalibrationWatcher() { Stop(); }
+  CalibrationWatcher(const CalibrationWatcher&) = delete;
+  CalibrationWatcher& operator=(const CalibrationWatcher&) = delete;
+
+  // Watches `file_path` and calls target.Load(file_path, lut_options) on a
+  // background thread each time the file is closed after writing or
+  // renamed into place (as SaveCalibrationBinary does). Bursts of changes
+  // are coalesced into one reload. The file is not loaded at start.
+  // Returns false if already running, if the file's directory cannot be
+  // watched, or on platforms without inotify. `target` must outlive the
+  // watcher.
+  bool Start(SharedProjector& target, const std::string& file_path,
+             const UndistortLutOptions& lut_options = UndistortLutOptions(),
+             CalibrationReloadCallback callback = nullptr,
+             void* user = nullptr);
+  // Stops and joins the thread, after any reload in progress.
+  void Stop();
+
+  bool running() const noexcept { return thread_.joinable(); }
+
+ private:
+  void Run(SharedProjector* target, std::string file_path,
+           UndistortLutOptions lut_options,
+           CalibrationReloadCallback callback, void* user);
+
+  std::thread thread_;
+  int inotify_fd_ = -1;
+  int stop_fd_ = -1;
+};
+
+}  // namespace roi_projector
@@ -0,0 +1,249 @@
+// Internal: batch quad-pair coverage kernels, vectorized across pairs with
+// the lane types of projection_kernel.h.
+//
+// Instead of Sutherland-Hodgman, whose vertex count varies per lane, the
+// intersection area of two convex quads comes from Green's theorem over its
+// boundary: every edge of each quad is clipped (Cyrus-Beck) to the other
+// quad's four half-planes, and each surviving piece contributes
+// cross(P0, P1) / 2 = (t1 - t0) * cross(A, D) / 2. That is fixed work per
+// lane with no masking of vertex lists. Pairs the kernel cannot score
+// exactly this way (non-convex quads, an ROI wound the other way) are
+// flagged for the scalar path.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "projection_kernel.h"
+
+namespace roi_projector {
+namespace detail {
+
+// Pairs in struct-of-arrays form: corner k of pair i is
+// (roi_u[k][i], roi_v[k][i]) and (bar_u[k][i], bar_v[k][i]).
+struct QuadPairBlock {
+  static constexpr size_t kSize = 64;  // multiple of every lane width
+  double roi_u[4][kSize];
+  double roi_v[4][kSize];
+  double bar_u[4][kSize];
+  double bar_v[4][kSize];
+};
+
+// Writes coverage[i] for i < count and sets fallback[i] to 1 for pairs that
+// must be rescored by CoverageRoi (coverage[i] is then unspecified).
+using CoverageBatchFn = void (*)(const QuadPairBlock& block, size_t count,
+                                 double* coverage, uint8_t* fallback) noexcept;
+
+void CoverageBatchScalar(const QuadPairBlock& block, size_t count,
+                         double* coverage, uint8_t* fallback) noexcept;
+#if defined(__aarch64__)
+void CoverageBatchNeon(const QuadPairBlock& block, size_t count,
+                       double* coverage, uint8_t* fallback) noexcept;
+#endif
+#if defined(ROI_PROJECTOR_HAVE_X86_KERNELS)
+void CoverageBatchAvx2(const QuadPairBlock& block, size_t count,
+                       double* coverage, uint8_t* fallback) noexcept;
+void CoverageBatchAvx512(const QuadPairBlock& block, size_t count,
+                         double* coverage, uint8_t* fallback) noexcept;
+#endif
+
+// Coverage kernel of the active KernelIsa.
+CoverageBatchFn ActiveCoverageBatch() noexcept;
+
+template <class V>
+inline V Max(V a, V b) {
+  return V::Select(V::Greater(a, b), a, b);
+}
+
+template <class V>
+inline V Min(V a, V b) {
+  return V::Select(V::Less(a, b), a, b);
+}
+
+template <class V>
+inline V Cross(V au, V av, V bu, V bv) {
+  return au * bv - av * bu;
+}
+
+// Clips A + t * D, t in [t0, t1], to the half-plane where the signed
+// distance is >= 0, given the distances at t = 0 (da) and t = 1 (db).
+// Lanes entirely outside end up with t1 < t0.
+template <class V>
+inline void ClipToHalfPlane(V da, V db, V& t0, V& t1) {
+  const V zero = V::Set(0.0);
+  // Only read where exactly one end is outside, so da != db; where both are
+  // outside and equal it is -inf, which empties the interval.
+  const V t = da / (da - db);
+  t0 = V::Select(V::Less(da, zero), Max(t0, t), t0);
+  t1 = V::Select(V::Less(db, zero), Min(t1, t), t1);
+}
+
+// Signed distances of the corners of quad P to the four edge lines of quad
+// Q, positive inside Q: dist[k][j] = sign_q * cross(Q[j+1] - Q[j],
+// P[k] - Q[j]).
+template <class V>
+inline void CornerDistances(const V* pu, const V* pv, const V* qu,
+                            const V* qv, V sign_q, V dist[4][4]) {
+  for (size_t j = 0; j < 4; ++j) {
+    const size_t j1 = (j + 1) & 3u;
+    const V eu = sign_q * (qu[j1] - qu[j]);
+    const V ev = sign_q * (qv[j1] - qv[j]);
+    for (size_t k = 0; k < 4; ++k) {
+      dist[k][j] = Cross(eu, ev, pu[k] - qu[j], pv[k] - qv[j]);
+    }
+  }
+}
+
+// Green's theorem contribution (twice the signed area) of edge k of quad P,
+// from P[k] to P[k+1], clipped to convex quad Q given the corner distances
+// of CornerDistances. When `skip_coincident` is set, pieces lying exactly
+// on an edge of Q running the same way are dropped so a shared boundary is
+// only counted once (by Q's edge); (du_q[j], dv_q[j]) is edge j of Q in
+// P's orientation.
+template <class V>
+inline V ClippedEdgeArea(const V* pu, const V* pv, size_t k,
+                         const V dist[4][4], const V* du_q, const V* dv_q,
+                         bool skip_coincident) {
+  const V zero = V::Set(0.0);
+  const size_t k1 = (k + 1) & 3u;
+  const V du = pu[k1] - pu[k];
+  const V dv = pv[k1] - pv[k];
+  V t0 = zero;
+  V t1 = V::Set(1.0);
+  for (size_t j = 0; j < 4; ++j) {
+    const V da = dist[k][j];
+    const V db = dist[k1][j];
+    // Most pairs lie well inside or outside most half-planes; skip the
+    // divide when no lane has an end outside.
+    if (V::Bits(V::Or(V::Less(da, zero), V::Less(db, zero))) != 0) {
+      ClipToHalfPlane(da, db, t0, t1);
+    }
+    if (skip_coincident) {
+      const auto coincident =
+          V::And(V::And(V::Equal(da, zero), V::Equal(db, zero)),
+                 V::Greater(du * du_q[j] + dv * dv_q[j], zero));
+      t1 = V::Select(coincident, V::Set(-1.0), t1);
+    }
+  }
+  return Max(t1 - t0, zero) * Cross(pu[k], pv[k], du, dv);
+}
+
+// Twice the signed area (shoelace) and a convexity mask: every turn has the
+// sign of the area (collinear corners allowed).
+template <class V>
+inline V QuadDoubleArea(const V* u, const V* v, typename V::Mask& convex) {
+  const V zero = V::Set(0.0);
+  V area2 = zero;
+  for (size_t k = 0; k < 4; ++k) {
+    area2 = area2 + Cross(u[k], v[k], u[(k + 1) & 3u], v[(k + 1) & 3u]);
+  }
+  typename V::Mask pos = V::All();
+  typename V::Mask neg = V::All();
+  for (size_t k = 0; k < 4; ++k) {
+    const size_t k1 = (k + 1) & 3u;
+    const size_t k2 = (k + 2) & 3u;
+    const V turn = Cross(u[k1] - u[k], v[k1] - v[k], u[k2] - u[k1],
+                         v[k2] - v[k1]);
+    const typename V::Mask flat = V::Equal(turn, zero);
+    pos = V::And(pos, V::Or(V::Greater(turn, zero), flat));
+    neg = V::And(neg, V::Or(V::Less(turn, zero), flat));
+  }
+  convex = V::Or(V::And(pos, V::Greater(area2, zero)),
+                 V::And(neg, V::Less(area2, zero)));
+  return area2;
+}
+
+// Scores one group of V::kWidth pairs starting at index `i` of `block`.
+template <class V>
+inline void CoverageGroup(const QuadPairBlock& block, size_t i,
+                          double* coverage, uint8_t* fallback) {
+  const V zero = V::Set(0.0);
+  const V one = V::Set(1.0);
+  // Coordinates relative to the ROI's first corner keep the Green's
+  // theorem terms small.
+  const V origin_u = V::Load(block.roi_u[0] + i);
+  const V origin_v = V::Load(block.roi_v[0] + i);
+  V ru[4], rv[4], bu[4], bv[4];
+  typename V::Mask finite = V::All();
+  for (size_t k = 0; k < 4; ++k) {
+    ru[k] = V::Load(block.roi_u[k] + i) - origin_u;
+    rv[k] = V::Load(block.roi_v[k] + i) - origin_v;
+    bu[k] = V::Load(block.bar_u[k] + i) - origin_u;
+    bv[k] = V::Load(block.bar_v[k] + i) - origin_v;
+    finite = V::And(finite, V::And(V::And(V::IsFinite(ru[k]),
+                                          V::IsFinite(rv[k])),
+                                   V::And(V::IsFinite(bu[k]),
+                                          V::IsFinite(bv[k]))));
+  }
+
+  typename V::Mask roi_convex;
+  typename V::Mask bar_convex;
+  const V roi_area2 = QuadDoubleArea(ru, rv, roi_convex);
+  const V bar_area2 = QuadDoubleArea(bu, bv, bar_convex);
+  const V abs_bar_area2 = Max(bar_area2, zero - bar_area2);
+  const V abs_roi_area2 = Max(roi_area2, zero - roi_area2);
+  // Same degenerate cut as CoverageRoi: area < 1e-9 scores 0. Comparing
+  // against the cut (rather than >=) also rejects NaN areas.
+  const V min_area2 = V::Set(2e-9);
+  const typename V::Mask scorable = V::And(
+      finite, V::And(V::Or(V::Greater(abs_roi_area2, min_area2),
+                           V::Equal(abs_roi_area2, min_area2)),
+                     V::Or(V::Greater(abs_bar_area2, min_area2),
+                           V::Equal(abs_bar_area2, min_area2))));
+  // An ROI wound clockwise covers nothing in CoverageRoi; leave that and
+  // non-convex quads to it.
+  const typename V::Mask exact =
+      V::And(V::And(roi_convex, bar_convex), V::Greater(roi_area2, zero));
+
+  // Barcode half-planes must be positive inside whatever its winding, and
+  // its edges are integrated in the ROI's (positive) orientation.
+  const V bar_sign = V::Select(V::Less(bar_area2, zero), V::Set(-1.0), one);
+  V bar_dist[4][4];  // barcode corners to ROI edges
+  V roi_dist[4][4];  // ROI corners to barcode edges
+  CornerDistances(bu, bv, ru, rv, one, bar_dist);
+  CornerDistances(ru, rv, bu, bv, bar_sign, roi_dist);
+  V bar_du[4], bar_dv[4];
+  for (size_t j = 0; j < 4; ++j) {
+    bar_du[j] = bar_sign * (bu[(j + 1) & 3u] - bu[j]);
+    bar_dv[j] = bar_sign * (bv[(j + 1) & 3u] - bv[j]);
+  }
+  V area2 = zero;
+  for (size_t k = 0; k < 4; ++k) {
+    area2 = area2 + bar_sign * ClippedEdgeArea(bu, bv, k, bar_dist, bar_du,
+                                               bar_dv, false);
+    area2 = area2 +
+            ClippedEdgeArea(ru, rv, k, roi_dist, bar_du, bar_dv, true);
+  }
+  area2 = Max(area2, zero - area2);
+  const V score = V::Select(scorable, Min(area2 / abs_bar_area2, one), zero);
+  score.Store(coverage);
+
+  // Degenerate or non-finite pairs score 0 like the scalar path; the rest
+  // need convex quads and a positively wound ROI.
+  const unsigned scorable_bits = V::Bits(scorable);
+  const unsigned exact_bits = V::Bits(exact);
+  for (size_t lane = 0; lane < V::kWidth; ++lane) {
+    const bool needs_scalar = ((scorable_bits >> lane) & 1u) != 0 &&
+                              ((exact_bits >> lane) & 1u) == 0;
+    fallback[lane] = needs_scalar ? 1 : 0;
+  }
+}
+
+// Runs CoverageGroup over the first `count` pairs of `block`; the lanes of
+// the last group past `count` read the block's padding and are discarded.
+template <class V>
+void CoverageBatch(const QuadPairBlock& block, size_t count, double* coverage,
+                   uint8_t* fallback) noexcept {
+  double lane_coverage[QuadPairBlock::kSize];
+  uint8_t lane_fallback[QuadPairBlock::kSize];
+  for (size_t i = 0; i < count; i += V::kWidth) {
+    CoverageGroup<V>(block, i, lane_coverage + i, lane_fallback + i);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    coverage[i] = lane_coverage[i];
+    fallback[i] = lane_fallback[i];
+  }
+}
+
+}  // namespace detail
+}  // namespace roi_projector
@@ -0,0 +1,268 @@
+// 深度图的积分图（深度和、深度平方和、有效像素数），按行分带多线程构建。
+#include "depth_integral.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace roi_projector {
+
+namespace {
+
+// 带内的局部积分：每行前缀和加上带内上一行，带的第一行不加。
+// 行 y 的结果写在表的第 y + 1 行。
+void SumBand(const DepthImageView& image, int row_begin, int row_end,
+             double* sum, double* sum_sq, uint32_t* count) noexcept {
+  const size_t stride = static_cast<size_t>(image.width) + 1;
+  for (int y = row_begin; y < row_end; ++y) {
+    const float* src = image.Row(y);
+    const size_t out = static_cast<size_t>(y + 1) * stride;
+    const bool above = y > row_begin;
+    double row_sum = 0.0;
+    double row_sum_sq = 0.0;
+    uint32_t row_count = 0;
+    sum[out] = 0.0;
+    sum_sq[out] = 0.0;
+    count[out] = 0;
+    for (int x = 0; x < image.width; ++x) {
+      const float d = src[x];
+      if (IsValidDepth(d)) {
+        row_sum += d;
+        row_sum_sq += static_cast<double>(d) * d;
+        ++row_count;
+      }
+      const size_t i = out + static_cast<size_t>(x) + 1;
+      sum[i] = row_sum + (above ? sum[i - stride] : 0.0);
+      sum_sq[i] = row_sum_sq + (above ? sum_sq[i - stride] : 0.0);
+      count[i] = row_count + (above ? count[i - stride] : 0);
+    }
+  }
+}
+
+// 把上一带最后一行的全局结果加到 [row_begin, row_end) 行上
+void AddCarry(size_t stride, size_t carry_row, int row_begin, int row_end,
+              double* sum, double* sum_sq, uint32_t* count) noexcept {
+  const double* carry_sum = sum + carry_row * stride;
+  const double* carry_sum_sq = sum_sq + carry_row * stride;
+  const uint32_t* carry_count = count + carry_row * stride;
+  for (int y = row_begin; y < row_end; ++y) {
+    const size_t out = static_cast<size_t>(y + 1) * stride;
+    for (size_t x = 0; x < stride; ++x) {
+      sum[out + x] += carry_sum[x];
+      sum_sq[out + x] += carry_sum_sq[x];
+      count[out + x] += carry_count[x];
+    }
+  }
+}
+
+}  // namespace
+
+// 常驻工作线程：第 i 个线程（从 1 起）执行每个任务的第 i 带。
+// 线程只在 Reserve 中启动，Run 本身不分配内存。
+class DepthIntegral::WorkerPool {
+ public:
+  WorkerPool() = default;
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  // 保证至少有 count 个工作线程，返回实际线程数。
+  // 启动失败（资源不足）时保留已启动的线程，调用方按实际数目分带。
+  size_t Reserve(size_t count) {
+    try {
+      workers_.reserve(count);
+      while (workers_.size() < count) {
+        // 已 reserve，emplace_back 只可能在创建线程时失败，此时不留下元素
+        workers_.emplace_back(&WorkerPool::Loop, this,
+                              static_cast<int>(workers_.size()) + 1,
+                              generation_);
+      }
+    } catch (const std::exception&) {
+    }
+    return workers_.size();
+  }
+
+  // 对 [0, bands) 执行 fn(band)：当前线程执行第 0 带，工作线程执行其余各带，
+  // 全部完成后返回。bands 不得超过工作线程数 + 1，fn 不得抛出异常。
+  template <typename Fn>
+  void Run(int bands, Fn& fn) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = [](void* context, int band) {
+        (*static_cast<Fn*>(context))(band);
+      };
+      context_ = &fn;
+      bands_ = bands;
+      pending_ = bands - 1;
+      ++generation_;
+    }
+    wake_.notify_all();
+    fn(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+  }
+
+ private:
+  // 线程启动时的 generation 之前的任务已经完成，不再执行
+  void Loop(int band, uint64_t seen) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+      if (band >= bands_) {
+        continue;
+      }
+      void (*task)(void*, int) = task_;
+      void* context = context_;
+      lock.unlock();
+      task(context, band);
+      lock.lock();
+      if (--pending_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  void (*task_)(void*, int) = nullptr;
+  void* context_ = nullptr;
+  int bands_ = 0;
+  int pending_ = 0;
+  uint64_t generation_ = 0;
+  bool stop_ = false;
+};
+
+DepthIntegral::DepthIntegral() = default;
+DepthIntegral::~DepthIntegral() = default;
+DepthIntegral::DepthIntegral(DepthIntegral&&) noexcept = default;
+DepthIntegral& DepthIntegral::operator=(DepthIntegral&&) noexcept = default;
+
+bool DepthIntegral::Build(const DepthImageView& image, int threads) {
+  if (!image.valid()) {
+    sum_.clear();
+    sum_sq_.clear();
+    count_.clear();
+    width_ = 0;
+    height_ = 0;
+    return false;
+  }
+  width_ = image.width;
+  height_ = image.height;
+  const size_t stride = static_cast<size_t>(width_) + 1;
+  const size_t size = stride * (static_cast<size_t>(height_) + 1);
+  // resize 不缩小容量，同样大小的帧不会重新分配
+  sum_.resize(size);
+  sum_sq_.resize(size);
+  count_.resize(size);
+  std::fill(sum_.begin(), sum_.begin() + stride, 0.0);
+  std::fill(sum_sq_.begin(), sum_sq_.begin() + stride, 0.0);
+  std::fill(count_.begin(), count_.begin() + stride, 0u);
+
+  if (threads <= 0) {
+    threads = static_cast<int>(std::thread::hardware_concurrency());
+  }
+  // 每带至少 64 行，唤醒线程的开销才划算
+  int bands = std::max(1, std::min(threads, height_ / 64));
+  if (bands > 1) {
+    if (pool_ == nullptr) {
+      pool_ = std::make_unique<WorkerPool>();
+    }
+    const size_t workers = pool_->Reserve(static_cast<size_t>(bands - 1));
+    bands = std::min(bands, static_cast<int>(workers) + 1);
+  }
+  // 只有一带时不经过线程池
+  auto for_each_band = [&](auto fn) {
+    if (bands == 1) {
+      fn(0);
+    } else {
+      pool_->Run(bands, fn);
+    }
+  };
+  auto band_begin = [&](int band) {
+    return static_cast<int>(static_cast<long>(height_) * band / bands);
+  };
+  double* sum = sum_.data();
+  double* sum_sq = sum_sq_.data();
+  uint32_t* count = count_.data();
+
+  // 第一遍：各带独立计算局部积分
+  for_each_band([&](int band) {
+    SumBand(image, band_begin(band), band_begin(band + 1), sum, sum_sq,
+            count);
+  });
+  if (bands == 1) {
+    return true;
+  }
+  // 第二遍：依次修正各带最后一行，得到各带的全局结果
+  for (int band = 1; band < bands; ++band) {
+    const int last = band_begin(band + 1) - 1;
+    AddCarry(stride, static_cast<size_t>(band_begin(band)), last, last + 1,
+             sum, sum_sq, count);
+  }
+  // 第三遍：各带其余行加上上一带最后一行
+  for_each_band([&](int band) {
+    if (band > 0) {
+      AddCarry(stride, static_cast<size_t>(band_begin(band)),
+               band_begin(band), band_begin(band + 1) - 1, sum, sum_sq,
+               count);
+    }
+  });
+  return true;
+}
+
+DepthRectStats DepthIntegral::Stats(int x0, int y0, int x1,
+                                    int y1) const noexcept {
+  DepthRectStats stats;
+  x0 = std::max(x0, 0);
+  y0 = std::max(y0, 0);
+  x1 = std::min(x1, width_);
+  y1 = std::min(y1, height_);
+  if (x0 >= x1 || y0 >= y1) {
+    return stats;
+  }
+  const size_t stride = static_cast<size_t>(width_) + 1;
+  const size_t a = static_cast<size_t>(y0) * stride + static_cast<size_t>(x0);
+  const size_t b = static_cast<size_t>(y0) * stride + static_cast<size_t>(x1);
+  const size_t c = static_cast<size_t>(y1) * stride + static_cast<size_t>(x0);
+  const size_t d = static_cast<size_t>(y1) * stride + static_cast<size_t>(x1);
+  stats.pixels = static_cast<size_t>(x1 - x0) * static_cast<size_t>(y1 - y0);
+  stats.valid = count_[d] - count_[b] - count_[c] + count_[a];
+  stats.valid_ratio =
+      static_cast<double>(stats.valid) / static_cast<double>(stats.pixels);
+  if (stats.valid == 0) {
+    return stats;
+  }
+  const double n = static_cast<double>(stats.valid);
+  stats.mean = (sum_[d] - sum_[b] - sum_[c] + sum_[a]) / n;
+  const double mean_sq =
+      (sum_sq_[d] - sum_sq_[b] - sum_sq_[c] + sum_sq_[a]) / n;
+  // 大数相减的舍入误差可能让方差略小于 0
+  stats.variance = std::max(0.0, mean_sq - stats.mean * stats.mean);
+  return stats;
+}
+
+DepthRectStats DepthIntegral::BoundingBoxStats(
+    const std::array<Point2D, 4>& roi) const noexcept {
+  const PixelBox box = RoiPixelBox(roi, width_, height_);
+  return Stats(box.x0, box.y0, box.x1, box.y1);
+}
+
+}  // namespace roi_projector
@@ -0,0 +1,67 @@
+// Summed-area tables over a depth frame, so depth statistics of any pixel
+// rectangle cost four lookups however many ROIs are sampled per frame.
+//
+// Built once per frame from a DepthImageView (see depth_sampler.h); holes
+// (depths outside [kMinValidDepth, kMaxValidDepth], NaN) add nothing to the
+// sums and are not counted.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "depth_sampler.h"
+
+namespace roi_projector {
+
+// Depth statistics of the valid pixels in a rectangle.
+struct DepthRectStats {
+  size_t pixels = 0;  // pixels in the rectangle after clipping to the frame
+  size_t valid = 0;   // of which hold a valid depth
+  double mean = 0.0;  // millimetres; 0 without valid pixels
+  double variance = 0.0;
+  double valid_ratio = 0.0;  // valid / pixels; 0 for an empty rectangle
+};
+
+class DepthIntegral {
+ public:
+  DepthIntegral();
+  ~DepthIntegral();
+  DepthIntegral(DepthIntegral&&) noexcept;
+  DepthIntegral& operator=(DepthIntegral&&) noexcept;
+
+  // Builds the tables for `image`, splitting its rows into bands summed on
+  // `threads` threads (0: one per hardware thread): the calling thread and
+  // workers owned by this object, started by the first Build that needs
+  // them and joined on destruction. The tables are reused too, so a frame
+  // of the same size on no more threads than before allocates nothing.
+  // Bands that find no worker (one failed to start) run on the threads
+  // there are, down to the caller alone. Returns false, leaving no tables,
+  // for an empty or malformed view.
+  bool Build(const DepthImageView& image, int threads = 0);
+
+  // Statistics of pixels [x0, x1) x [y0, y1), clipped to the frame.
+  DepthRectStats Stats(int x0, int y0, int x1, int y1) const noexcept;
+  // Statistics of the pixels whose centres lie in the bounding box of
+  // `roi` (camera1 pixels, centred on integer coordinates).
+  DepthRectStats BoundingBoxStats(
+      const std::array<Point2D, 4>& roi) const noexcept;
+
+  int width() const noexcept { return width_; }
+  int height() const noexcept { return height_; }
+
+ private:
+  // Row-major (width + 1) x (height + 1); entry (x, y) sums pixels
+  // [0, x) x [0, y).
+  std::vector<double> sum_;
+  std::vector<double> sum_sq_;
+  std::vector<uint32_t> count_;
+  int width_ = 0;
+  int height_ = 0;
+  class WorkerPool;
+  std::unique_ptr<WorkerPool> pool_;
+};
+
+}  // namespace roi_projector
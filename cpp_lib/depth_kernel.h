@@ -0,0 +1,49 @@
+// Internal: row kernels that build the min/max depth pyramid of
+// depth_pyramid.h. Not installed.
+//
+// Holes become +inf in the min plane and -inf in the max plane, so they
+// drop out of every min and max and coarser levels need no validity test.
+// Min and max of floats are exact, so every ISA gives bit-identical levels.
+#pragma once
+
+#include <cstddef>
+#include <limits>
+
+#include "depth_sampler.h"
+
+namespace roi_projector {
+namespace detail {
+
+inline float MinKey(float depth) noexcept {
+  return IsValidDepth(depth) ? depth : std::numeric_limits<float>::infinity();
+}
+inline float MaxKey(float depth) noexcept {
+  return IsValidDepth(depth) ? depth : -std::numeric_limits<float>::infinity();
+}
+
+struct DepthPyramidKernels {
+  // Halves a pair of depth rows into the first level: out_min[i] is the min
+  // of the valid depths of row_a and row_b at 2i and 2i + 1 (+inf without
+  // any), out_max[i] their max (-inf without any), for i < count.
+  void (*reduce_depth)(const float* row_a, const float* row_b, size_t count,
+                       float* out_min, float* out_max) noexcept;
+  // Halves a row pair: out_min[i] is the min of min_a and min_b at 2i and
+  // 2i + 1, out_max[i] the max of max_a and max_b there, for i < count.
+  void (*reduce_rows)(const float* min_a, const float* min_b,
+                      const float* max_a, const float* max_b, size_t count,
+                      float* out_min, float* out_max) noexcept;
+};
+
+extern const DepthPyramidKernels kDepthPyramidScalar;
+#if defined(__aarch64__)
+extern const DepthPyramidKernels kDepthPyramidNeon;
+#endif
+#if defined(ROI_PROJECTOR_HAVE_X86_KERNELS)
+extern const DepthPyramidKernels kDepthPyramidAvx2;
+#endif
+
+// Kernels of the active KernelIsa; AVX-512 hosts use the AVX2 ones.
+const DepthPyramidKernels& ActiveDepthPyramidKernels() noexcept;
+
+}  // namespace detail
+}  // namespace roi_projector
@@ -0,0 +1,158 @@
+// 深度图的最小/最大值金字塔与保守的深度范围查询。
+#include "depth_pyramid.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "depth_kernel.h"
+
+namespace roi_projector {
+
+bool DepthPyramid::Build(const DepthImageView& image) {
+  level_count_ = 0;
+  levels_ = {};
+  width_ = 0;
+  height_ = 0;
+  if (!image.valid()) {
+    return false;
+  }
+  width_ = image.width;
+  height_ = image.height;
+  // 从半分辨率开始逐级减半（向上取整）直到 1x1，先算出所有级别在 arena
+  // 中的位置
+  size_t total = 0;
+  int w = (width_ + 1) / 2;
+  int h = (height_ + 1) / 2;
+  while (level_count_ < kMaxDepthPyramidLevels) {
+    Level& level = levels_[static_cast<size_t>(level_count_++)];
+    level.offset = total;
+    level.width = w;
+    level.height = h;
+    total += 2 * static_cast<size_t>(w) * static_cast<size_t>(h);
+    if (w == 1 && h == 1) {
+      break;
+    }
+    w = (w + 1) / 2;
+    h = (h + 1) / 2;
+  }
+  // resize 不缩小容量，同样大小的帧不会重新分配
+  arena_.resize(total);
+
+  const detail::DepthPyramidKernels& kernels =
+      detail::ActiveDepthPyramidKernels();
+  const Level& base = levels_[0];
+  const size_t plane = static_cast<size_t>(base.width) * base.height;
+  const size_t pairs = static_cast<size_t>(width_ / 2);
+  for (int y = 0; y < base.height; ++y) {
+    // 与 ReduceRow 相同：奇数高度的最后一行与自身配对，奇数宽度的最后一列
+    // 单独处理
+    const float* a = image.Row(2 * y);
+    const float* b = 2 * y + 1 < height_ ? image.Row(2 * y + 1) : a;
+    float* out_min = arena_.data() + base.offset +
+                     static_cast<size_t>(y) * base.width;
+    float* out_max = out_min + plane;
+    kernels.reduce_depth(a, b, pairs, out_min, out_max);
+    if (width_ % 2 != 0) {
+      const int last = width_ - 1;
+      out_min[pairs] =
+          std::min(detail::MinKey(a[last]), detail::MinKey(b[last]));
+      out_max[pairs] =
+          std::max(detail::MaxKey(a[last]), detail::MaxKey(b[last]));
+    }
+    // 一行凑齐一对（或是奇数高度的最后一行）就立刻归约到上一级，逐级向上；
+    // 刚写的行还在缓存里，整个金字塔只需扫一遍内存
+    int level = 0;
+    int level_row = y;
+    while (level + 1 < level_count_ &&
+           (level_row % 2 == 1 ||
+            level_row + 1 == levels_[static_cast<size_t>(level)].height)) {
+      ++level;
+      level_row /= 2;
+      ReduceRow(kernels, level, level_row);
+    }
+  }
+  return true;
+}
+
+void DepthPyramid::ReduceRow(const detail::DepthPyramidKernels& kernels,
+                             int level, int y) noexcept {
+  const Level& in = levels_[static_cast<size_t>(level - 1)];
+  const Level& out = levels_[static_cast<size_t>(level)];
+  const size_t in_plane = static_cast<size_t>(in.width) * in.height;
+  const size_t out_plane = static_cast<size_t>(out.width) * out.height;
+  const float* in_min = arena_.data() + in.offset;
+  const float* in_max = in_min + in_plane;
+  float* out_min = arena_.data() + out.offset;
+  float* out_max = out_min + out_plane;
+  // 奇数高度的最后一行与自身配对，奇数宽度的最后一列单独处理
+  const size_t pairs = static_cast<size_t>(in.width / 2);
+  const size_t a = static_cast<size_t>(2 * y) * in.width;
+  const size_t b =
+      2 * y + 1 < in.height ? a + static_cast<size_t>(in.width) : a;
+  const size_t o = static_cast<size_t>(y) * out.width;
+  kernels.reduce_rows(in_min + a, in_min + b, in_max + a, in_max + b, pairs,
+                      out_min + o, out_max + o);
+  if (in.width % 2 != 0) {
+    const size_t last = static_cast<size_t>(in.width) - 1;
+    out_min[o + pairs] = std::min(in_min[a + last], in_min[b + last]);
+    out_max[o + pairs] = std::max(in_max[a + last], in_max[b + last]);
+  }
+}
+
+DepthBounds DepthPyramid::Range(int x0, int y0, int x1,
+                                int y1) const noexcept {
+  DepthBounds bounds;
+  if (level_count_ == 0) {
+    return bounds;
+  }
+  x0 = std::max(x0, 0);
+  y0 = std::max(y0, 0);
+  x1 = std::min(x1, width_);
+  y1 = std::min(y1, height_);
+  if (x0 >= x1 || y0 >= y1) {
+    return bounds;
+  }
+  // 最细的一级：覆盖矩形的格子每个方向不超过 kDepthPyramidQueryCells 个；
+  // 顶层只有一个格子，总能满足
+  int l = 0;
+  int cx0 = x0 >> 1;
+  int cy0 = y0 >> 1;
+  int cx1 = (x1 - 1) >> 1;
+  int cy1 = (y1 - 1) >> 1;
+  while (l + 1 < level_count_ && (cx1 - cx0 >= kDepthPyramidQueryCells ||
+                                  cy1 - cy0 >= kDepthPyramidQueryCells)) {
+    ++l;
+    cx0 >>= 1;
+    cy0 >>= 1;
+    cx1 >>= 1;
+    cy1 >>= 1;
+  }
+  const Level& level = levels_[static_cast<size_t>(l)];
+  const size_t plane = static_cast<size_t>(level.width) * level.height;
+  const float* min_plane = arena_.data() + level.offset;
+  const float* max_plane = min_plane + plane;
+  float lo = std::numeric_limits<float>::infinity();
+  float hi = -std::numeric_limits<float>::infinity();
+  for (int y = cy0; y <= cy1; ++y) {
+    const size_t row = static_cast<size_t>(y) * level.width;
+    for (int x = cx0; x <= cx1; ++x) {
+      lo = std::min(lo, min_plane[row + static_cast<size_t>(x)]);
+      hi = std::max(hi, max_plane[row + static_cast<size_t>(x)]);
+    }
+  }
+  // 全是空洞时 lo 仍为 +inf
+  if (lo <= hi) {
+    bounds.ok = true;
+    bounds.z_min = lo;
+    bounds.z_max = hi;
+  }
+  return bounds;
+}
+
+DepthBounds DepthPyramid::RoiRange(
+    const std::array<Point2D, 4>& roi) const noexcept {
+  const PixelBox box = RoiPixelBox(roi, width_, height_);
+  return Range(box.x0, box.y0, box.x1, box.y1);
+}
+
+}  // namespace roi_projector
@@ -0,0 +1,81 @@
+// Min/max depth pyramid over a depth frame, giving conservative depth
+// bounds of an ROI (e.g. z_min / z_max for Projector::ProjectRoiEnvelope)
+// without scanning its pixels.
+//
+// Level 0 has a cell per 2x2 pixels and every further level halves the
+// size again, each cell holding the min and max of the valid depths below
+// it; holes (see depth_sampler.h) are ignored. Starting at half resolution
+// keeps the pyramid at a sixth of the frame's size in floats, and since
+// the build streams through memory that makes it faster than storing a
+// full-resolution level.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "depth_sampler.h"
+
+namespace roi_projector {
+
+namespace detail {
+struct DepthPyramidKernels;
+}  // namespace detail
+
+// Enough levels for any frame whose sides fit in an int.
+constexpr int kMaxDepthPyramidLevels = 32;
+
+// Cells read per axis by a query, at the finest level where that many
+// cover the queried rectangle.
+constexpr int kDepthPyramidQueryCells = 8;
+
+struct DepthBounds {
+  bool ok = false;  // false when no valid depth was found
+  double z_min = 0.0;
+  double z_max = 0.0;
+};
+
+class DepthPyramid {
+ public:
+  // Builds the levels for `image` with the active KernelIsa's row kernels.
+  // All levels live in one arena that only grows, so frames of the same
+  // size do not allocate. Returns false, leaving no levels, for an empty or
+  // malformed view.
+  bool Build(const DepthImageView& image);
+
+  // Bounds holding every valid depth in pixels [x0, x1) x [y0, y1),
+  // clipped to the frame. Conservative: the cells read cover the rectangle
+  // and may extend less than one cell (at least two pixels) past each side
+  // of it, at the finest level (found in O(log n)) where at most
+  // kDepthPyramidQueryCells of them span each axis.
+  DepthBounds Range(int x0, int y0, int x1, int y1) const noexcept;
+  // Range over the pixels whose centres lie in the bounding box of `roi`
+  // (camera1 pixels), so it also bounds the quad itself.
+  DepthBounds RoiRange(const std::array<Point2D, 4>& roi) const noexcept;
+
+  int levels() const noexcept { return level_count_; }
+  // Size of the frame, in pixels.
+  int width() const noexcept { return width_; }
+  int height() const noexcept { return height_; }
+
+ private:
+  // The level's min plane starts at `offset` in the arena, its max plane
+  // width * height floats later.
+  struct Level {
+    size_t offset = 0;
+    int width = 0;
+    int height = 0;
+  };
+
+  // Fills row y of `level` (>= 1) from its two source rows.
+  void ReduceRow(const detail::DepthPyramidKernels& kernels, int level,
+                 int y) noexcept;
+
+  std::vector<float> arena_;
+  std::array<Level, kMaxDepthPyramidLevels> levels_{};
+  int level_count_ = 0;
+  int width_ = 0;
+  int height_ = 0;
+};
+
+}  // namespace roi_projector
@@ -0,0 +1,246 @@
+// 从 camera1 深度图中稳健地读取 ROI 角点深度。
+#include "depth_sampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+
+#if !defined(ROI_PROJECTOR_DISABLE_SIMD)
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ROI_PROJECTOR_DEPTH_SSE2 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define ROI_PROJECTOR_DEPTH_NEON 1
+#endif
+#endif
+
+namespace roi_projector {
+
+namespace {
+
+constexpr int kMaxWindowSide = 2 * kMaxDepthWindowRadius + 1;
+
+// 像素坐标限制在 ±2^30 内，避免取整溢出与距离平方溢出为无穷大
+double ClampCoordinate(double x) noexcept {
+  constexpr double kLimit = 1 << 30;
+  return std::min(kLimit, std::max(-kLimit, x));
+}
+
+// 像素坐标四舍五入到整数
+int RoundToInt(double x) noexcept {
+  return static_cast<int>(std::floor(ClampCoordinate(x) + 0.5));
+}
+
+// 把一行中的有效深度依次写入 out，返回写入个数。out 至少留 count 个位置。
+// 每次取 4 个像素用 SIMD 比较得到有效位，全部有效时整块写入，
+// 否则按位无分支压缩。
+size_t AppendValid(const float* row, size_t count, float* out) noexcept {
+  size_t n = 0;
+  size_t i = 0;
+#if defined(ROI_PROJECTOR_DEPTH_SSE2) || defined(ROI_PROJECTOR_DEPTH_NEON)
+#if defined(ROI_PROJECTOR_DEPTH_SSE2)
+  const __m128 lo = _mm_set1_ps(kMinValidDepth);
+  const __m128 hi = _mm_set1_ps(kMaxValidDepth);
+#else
+  const float32x4_t lo = vdupq_n_f32(kMinValidDepth);
+  const float32x4_t hi = vdupq_n_f32(kMaxValidDepth);
+  const uint32_t kLaneBits[4] = {1, 2, 4, 8};
+  const uint32x4_t lane_bits = vld1q_u32(kLaneBits);
+#endif
+  for (; i + 4 <= count; i += 4) {
+#if defined(ROI_PROJECTOR_DEPTH_SSE2)
+    const __m128 d = _mm_loadu_ps(row + i);
+    const unsigned mask = static_cast<unsigned>(_mm_movemask_ps(
+        _mm_and_ps(_mm_cmpge_ps(d, lo), _mm_cmple_ps(d, hi))));
+    if (mask == 0xF) {
+      _mm_storeu_ps(out + n, d);
+      n += 4;
+      continue;
+    }
+#else
+    const float32x4_t d = vld1q_f32(row + i);
+    const uint32x4_t valid = vandq_u32(vcgeq_f32(d, lo), vcleq_f32(d, hi));
+    const unsigned mask = vaddvq_u32(vandq_u32(valid, lane_bits));
+    if (mask == 0xF) {
+      vst1q_f32(out + n, d);
+      n += 4;
+      continue;
+    }
+#endif
+    for (unsigned k = 0; k < 4; ++k) {
+      out[n] = row[i + k];
+      n += (mask >> k) & 1u;
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    out[n] = row[i];
+    n += IsValidDepth(row[i]) ? 1 : 0;
+  }
+  return n;
+}
+
+// 以 (cx, cy) 为中心按切比雪夫距离逐圈向外找有效像素；
+// 找到的第一圈里取离 (u, v) 欧氏距离最近的一个。
+// 圈的坐标用 64 位计算：中心可在 ±2^30，半径可达图像尺寸加上这段距离。
+bool NearestValid(const DepthImageView& image, double u, double v, int cx,
+                  int cy, int max_radius, float& depth) noexcept {
+  const int64_t width = image.width;
+  const int64_t height = image.height;
+  u = ClampCoordinate(u);
+  v = ClampCoordinate(v);
+  double best = std::numeric_limits<double>::infinity();
+  auto consider = [&](int64_t x, int64_t y) {
+    if (x < 0 || x >= width || y < 0 || y >= height) {
+      return;
+    }
+    const float d = image.Row(static_cast<int>(y))[x];
+    if (!IsValidDepth(d)) {
+      return;
+    }
+    const double du = static_cast<double>(x) - u;
+    const double dv = static_cast<double>(y) - v;
+    const double dist2 = du * du + dv * dv;
+    if (dist2 < best) {
+      best = dist2;
+      depth = d;
+    }
+  };
+  // 中心到图像的切比雪夫距离以内的圈整圈在图像外（中心在图像外时），直接跳过
+  const int64_t first_ring =
+      std::max({int64_t{0}, -int64_t{cx}, cx - (width - 1), -int64_t{cy},
+                cy - (height - 1)});
+  for (int64_t r = first_ring; r <= max_radius; ++r) {
+    // 每圈只遍历落在图像内的部分，大半径的圈也只花 O(width + height)
+    const int64_t x_begin = std::max<int64_t>(cx - r, 0);
+    const int64_t x_end = std::min<int64_t>(cx + r, width - 1);
+    for (int64_t x = x_begin; x <= x_end; ++x) {
+      consider(x, cy - r);
+      if (r > 0) {
+        consider(x, cy + r);
+      }
+    }
+    const int64_t y_begin = std::max<int64_t>(cy - r + 1, 0);
+    const int64_t y_end = std::min<int64_t>(cy + r - 1, height - 1);
+    for (int64_t y = y_begin; y <= y_end; ++y) {
+      consider(cx - r, y);
+      consider(cx + r, y);
+    }
+    if (best < std::numeric_limits<double>::infinity()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+PixelBox RoiPixelBox(const std::array<Point2D, 4>& roi, int width,
+                     int height) noexcept {
+  double min_u = roi[0].u;
+  double max_u = roi[0].u;
+  double min_v = roi[0].v;
+  double max_v = roi[0].v;
+  for (const Point2D& p : roi) {
+    min_u = std::min(min_u, p.u);
+    max_u = std::max(max_u, p.u);
+    min_v = std::min(min_v, p.v);
+    max_v = std::max(max_v, p.v);
+  }
+  PixelBox box;
+  if (!std::isfinite(min_u) || !std::isfinite(max_u) ||
+      !std::isfinite(min_v) || !std::isfinite(max_v)) {
+    return box;
+  }
+  // 中心落在 [min, max] 内的像素；先限制到图像范围，避免转换溢出
+  auto clamp = [](double x, int size) {
+    return std::min(std::max(x, -1.0), static_cast<double>(size));
+  };
+  box.x0 = std::max(0, static_cast<int>(std::ceil(clamp(min_u, width))));
+  box.x1 = std::min(width,
+                    static_cast<int>(std::floor(clamp(max_u, width))) + 1);
+  box.y0 = std::max(0, static_cast<int>(std::ceil(clamp(min_v, height))));
+  box.y1 = std::min(height,
+                    static_cast<int>(std::floor(clamp(max_v, height))) + 1);
+  return box;
+}
+
+DepthSample SampleDepth(const DepthImageView& image, double u, double v,
+                        const DepthSampleOptions& options) noexcept {
+  DepthSample sample;
+  if (!image.valid() || !std::isfinite(u) || !std::isfinite(v)) {
+    return sample;
+  }
+  const int cx = RoundToInt(u);
+  const int cy = RoundToInt(v);
+  const int radius =
+      std::min(std::max(options.window_radius, 0), kMaxDepthWindowRadius);
+
+  // 窗口裁剪到图像内，逐行收集有效深度
+  float values[kMaxWindowSide * kMaxWindowSide];
+  size_t count = 0;
+  const int x0 = std::max(0, cx - radius);
+  const int x1 = std::min(image.width - 1, cx + radius);
+  const int y0 = std::max(0, cy - radius);
+  const int y1 = std::min(image.height - 1, cy + radius);
+  if (x0 <= x1) {
+    for (int y = y0; y <= y1; ++y) {
+      count += AppendValid(image.Row(y) + x0,
+                           static_cast<size_t>(x1 - x0 + 1), values + count);
+    }
+  }
+  sample.valid_pixels = static_cast<int>(count);
+
+  if (count > 0 && sample.valid_pixels >= options.min_valid) {
+    double p = options.percentile;
+    p = p >= 0.0 ? std::min(p, 1.0) : 0.0;  // NaN 视为 0
+    const size_t k =
+        static_cast<size_t>(p * static_cast<double>(count - 1) + 0.5);
+    std::nth_element(values, values + k, values + count);
+    sample.depth = values[k];
+    sample.source = DepthSource::kWindow;
+    return sample;
+  }
+
+  // 半径超过中心到最远像素的切比雪夫距离后，外圈已不含任何像素
+  const int64_t farthest = std::max(
+      {std::abs(int64_t{cx}), std::abs(cx - int64_t{image.width - 1}),
+       std::abs(int64_t{cy}), std::abs(cy - int64_t{image.height - 1})});
+  const int fallback_radius = static_cast<int>(
+      std::min<int64_t>(options.fallback_radius, farthest));
+  float nearest = 0.0f;
+  if (options.fallback_radius > 0 &&
+      NearestValid(image, u, v, cx, cy, fallback_radius, nearest)) {
+    sample.depth = nearest;
+    sample.source = DepthSource::kNearest;
+  }
+  return sample;
+}
+
+DepthRoiResult ProjectRoiFromDepth(const Projector& projector,
+                                   const DepthImageView& image,
+                                   const std::array<Point2D, 4>& corners_uv,
+                                   const DepthSampleOptions& options) noexcept {
+  DepthRoiResult result;
+  std::array<Point3D, 4> corners{};
+  for (size_t i = 0; i < 4; ++i) {
+    result.depths[i] =
+        SampleDepth(image, corners_uv[i].u, corners_uv[i].v, options);
+    corners[i] = {corners_uv[i].u, corners_uv[i].v, result.depths[i].depth};
+  }
+  // 所有角点都先采样，便于调用方查看每个角点的深度来源
+  for (size_t i = 0; i < 4; ++i) {
+    if (result.depths[i].source == DepthSource::kNone) {
+      result.corners.status = ProjectStatus::kInvalidDepth;
+      result.corners.failed_corner = static_cast<int>(i);
+      return result;
+    }
+  }
+  result.corners = projector.ProjectCorners(corners);
+  return result;
+}
+
+}  // namespace roi_projector
@@ -0,0 +1,113 @@
+// Robust ROI corner depths read straight from a camera1 depth frame, so the
+// depth passed to projection no longer comes from one pixel that may sit
+// in a hole.
+//
+// The frame is the row-major float32 depth map (millimetres) returned by
+// EpicEyeCamera.capture_depth, viewed in place. Pixels outside
+// [kMinValidDepth, kMaxValidDepth], and NaN, are holes, as in
+// epicraw_parser. Pixel (x, y) is centred on integer coordinates, as the
+// corners passed to ProjectCorners.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "roi_projector.h"
+
+namespace roi_projector {
+
+constexpr float kMinValidDepth = 0.1f;
+constexpr float kMaxValidDepth = 6000.0f;
+
+// False for holes, including NaN.
+inline bool IsValidDepth(float depth) noexcept {
+  return depth >= kMinValidDepth && depth <= kMaxValidDepth;
+}
+
+// Upper bound on DepthSampleOptions::window_radius.
+constexpr int kMaxDepthWindowRadius = 15;
+
+// Non-owning view of a depth frame; the caller keeps it alive.
+struct DepthImageView {
+  const float* data = nullptr;
+  int width = 0;
+  int height = 0;
+  // Distance between rows in floats; 0 means width (tightly packed).
+  size_t row_stride = 0;
+
+  // Non-empty, with rows at least `width` floats apart.
+  bool valid() const noexcept {
+    return data != nullptr && width > 0 && height > 0 &&
+           (row_stride == 0 || row_stride >= static_cast<size_t>(width));
+  }
+  const float* Row(int y) const noexcept {
+    return data + static_cast<size_t>(y) *
+                      (row_stride != 0 ? row_stride
+                                       : static_cast<size_t>(width));
+  }
+};
+
+// Pixels [x0, x1) x [y0, y1) of a frame.
+struct PixelBox {
+  int x0 = 0;
+  int y0 = 0;
+  int x1 = 0;
+  int y1 = 0;
+
+  bool empty() const noexcept { return x0 >= x1 || y0 >= y1; }
+};
+
+// Pixels of a width x height frame whose centres lie in the bounding box
+// of `roi`; empty for non-finite corners.
+PixelBox RoiPixelBox(const std::array<Point2D, 4>& roi, int width,
+                     int height) noexcept;
+
+struct DepthSampleOptions {
+  // Square window of (2r + 1)^2 pixels around the point, clipped to the
+  // frame. Clamped to [0, kMaxDepthWindowRadius].
+  int window_radius = 2;
+  // Percentile of the window's valid depths, in [0, 1]; 0.5 is the median.
+  double percentile = 0.5;
+  // Fewer valid pixels than this in the window falls back to the nearest
+  // valid pixel.
+  int min_valid = 3;
+  // How far (in pixels, Chebyshev distance) the fallback searches; 0 turns
+  // it off. Clamped to the distance of the frame's farthest pixel, so any
+  // radius costs at most one pass over the frame.
+  int fallback_radius = 30;
+};
+
+enum class DepthSource : uint8_t {
+  kNone,     // no valid depth found
+  kWindow,   // percentile of the window
+  kNearest,  // nearest valid pixel
+};
+
+struct DepthSample {
+  double depth = 0.0;  // millimetres; 0 when source is kNone
+  DepthSource source = DepthSource::kNone;
+  int valid_pixels = 0;  // valid pixels in the window
+};
+
+// Depth at camera1 pixel (u, v): the configured percentile of the valid
+// pixels in the window or, with too few of them, the valid pixel nearest
+// to (u, v) within fallback_radius (ties go to the smallest Euclidean
+// distance). Does not allocate.
+DepthSample SampleDepth(const DepthImageView& image, double u, double v,
+                        const DepthSampleOptions& options) noexcept;
+
+struct DepthRoiResult {
+  CornersResult corners;  // failed_corner is also set for missing depth
+  std::array<DepthSample, 4> depths{};
+};
+
+// Samples the depth at each ROI corner and projects the corners at those
+// depths, in one call. A corner without a valid depth fails with
+// kInvalidDepth. Does not allocate.
+DepthRoiResult ProjectRoiFromDepth(const Projector& projector,
+                                   const DepthImageView& image,
+                                   const std::array<Point2D, 4>& corners_uv,
+                                   const DepthSampleOptions& options) noexcept;
+
+}  // namespace roi_projector
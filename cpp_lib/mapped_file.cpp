@@ -0,0 +1,74 @@
+// Read-only file mappings and atomic file replacement.
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+namespace roi_projector {
+
+std::shared_ptr<const MappedFile> MappedFile::Open(const std::string& path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  void* addr = MAP_FAILED;
+  if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+    int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+    // Callers checksum every page anyway.
+    flags |= MAP_POPULATE;
+#endif
+    addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, flags,
+                  fd, 0);
+  }
+  ::close(fd);  // the mapping stays valid
+  if (addr == MAP_FAILED) {
+    return nullptr;
+  }
+  return std::shared_ptr<const MappedFile>(
+      new MappedFile(addr, static_cast<size_t>(st.st_size)));
+}
+
+MappedFile::~MappedFile() { ::munmap(addr_, size_); }
+
+bool WriteFileAtomically(const std::string& path, const void* data,
+                         size_t size) {
+  // mkstemp picks a name no other writer, in this process or another, is
+  // using, so concurrent writers of the same file never share a temporary.
+  std::string tmp_path = path + ".tmp.XXXXXX";
+  const int fd = ::mkstemp(tmp_path.data());
+  if (fd < 0) {
+    return false;
+  }
+  // mkstemp creates the file 0600; the files replaced here are read by
+  // other users of the station as well.
+  bool ok = ::fchmod(fd, 0644) == 0;
+  const char* bytes = static_cast<const char*>(data);
+  size_t written = 0;
+  while (ok && written < size) {
+    const ssize_t n = ::write(fd, bytes + written, size - written);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    ok = n > 0;
+    written += ok ? static_cast<size_t>(n) : 0;
+  }
+  // On disk before the rename makes it visible, so a crash cannot leave
+  // `path` naming a file whose data never reached the disk.
+  ok = ok && ::fsync(fd) == 0;
+  ok = ::close(fd) == 0 && ok;
+  if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace roi_projector
@@ -0,0 +1,42 @@
+// Internal: read-only mapping of a whole file, shared by the binary
+// calibration loader and the undistortion table cache. Not installed.
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace roi_projector {
+
+// Unmapped with the last reference. The file must be replaced by renaming
+// a new one over it, never rewritten in place, while mapped.
+class MappedFile {
+ public:
+  // Null for a missing, empty or unmappable file.
+  static std::shared_ptr<const MappedFile> Open(const std::string& path);
+
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const unsigned char* data() const noexcept {
+    return static_cast<const unsigned char*>(addr_);
+  }
+  size_t size() const noexcept { return size_; }
+
+ private:
+  MappedFile(void* addr, size_t size) : addr_(addr), size_(size) {}
+
+  void* addr_;
+  size_t size_;
+};
+
+// Writes `size` bytes to `path` through a uniquely named temporary file
+// (`path`.tmp.XXXXXX), synced to disk and then renamed into place, so a
+// process mapping the old file never sees a partly written one and
+// concurrent writers never interleave. Returns false, leaving `path` as it
+// was, on any error.
+bool WriteFileAtomically(const std::string& path, const void* data,
+                         size_t size);
+
+}  // namespace roi_projector
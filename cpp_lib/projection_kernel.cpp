@@ -0,0 +1,218 @@
+// Scalar projection, coverage and depth pyramid kernels and kernel
+// selection.
+#include "projection_kernel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+#include "coverage_kernel.h"
+#include "depth_kernel.h"
+#include "depth_sampler.h"
+
+namespace roi_projector {
+namespace detail {
+
+size_t ProjectBatchScalar(const CompiledCalibration& params,
+                          const double* u, const double* v, const double* z,
+                          size_t count, double* out_u, double* out_v,
+                          ProjectStatus* status, uint8_t* iterations) noexcept {
+  return ProjectBatch<ScalarF64>(params, u, v, z, count, out_u, out_v, status,
+                                 iterations);
+}
+
+void CoverageBatchScalar(const QuadPairBlock& block, size_t count,
+                         double* coverage, uint8_t* fallback) noexcept {
+  CoverageBatch<ScalarF64>(block, count, coverage, fallback);
+}
+
+namespace {
+
+void ReduceDepthScalar(const float* row_a, const float* row_b, size_t count,
+                       float* out_min, float* out_max) noexcept {
+  for (size_t i = 0; i < count; ++i) {
+    const size_t j = 2 * i;
+    out_min[i] = std::min(std::min(MinKey(row_a[j]), MinKey(row_a[j + 1])),
+                          std::min(MinKey(row_b[j]), MinKey(row_b[j + 1])));
+    out_max[i] = std::max(std::max(MaxKey(row_a[j]), MaxKey(row_a[j + 1])),
+                          std::max(MaxKey(row_b[j]), MaxKey(row_b[j + 1])));
+  }
+}
+
+void ReduceDepthRowsScalar(const float* min_a, const float* min_b,
+                           const float* max_a, const float* max_b,
+                           size_t count, float* out_min,
+                           float* out_max) noexcept {
+  for (size_t i = 0; i < count; ++i) {
+    out_min[i] = std::min(std::min(min_a[2 * i], min_a[2 * i + 1]),
+                          std::min(min_b[2 * i], min_b[2 * i + 1]));
+    out_max[i] = std::max(std::max(max_a[2 * i], max_a[2 * i + 1]),
+                          std::max(max_b[2 * i], max_b[2 * i + 1]));
+  }
+}
+
+}  // namespace
+
+const DepthPyramidKernels kDepthPyramidScalar = {&ReduceDepthScalar,
+                                                 &ReduceDepthRowsScalar};
+
+namespace {
+
+ProjectBatchFn KernelFor(KernelIsa isa) {
+  switch (isa) {
+    case KernelIsa::kScalar:
+      return &ProjectBatchScalar;
+    case KernelIsa::kNeon:
+#if defined(__aarch64__) && !defined(ROI_PROJECTOR_DISABLE_SIMD)
+      return &ProjectBatchNeon;
+#else
+      return nullptr;
+#endif
+    case KernelIsa::kAvx2:
+#if defined(ROI_PROJECTOR_HAVE_X86_KERNELS)
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") ? &ProjectBatchAvx2 : nullptr;
+#else
+      return nullptr;
+#endif
+    case KernelIsa::kAvx512:
+#if defined(ROI_PROJECTOR_HAVE_X86_KERNELS)
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx512f") ? &ProjectBatchAvx512
+                                               : nullptr;
+#else
+      return nullptr;
+#endif
+  }
+  return nullptr;
+}
+
+// Coverage kernel built for the same ISA; only meaningful once KernelFor
+// has confirmed the ISA is supported.
+CoverageBatchFn CoverageKernelFor(KernelIsa isa) {
+  switch (isa) {
+    case KernelIsa::kScalar:
+      return &CoverageBatchScalar;
+    case KernelIsa::kNeon:
+#if defined(__aarch64__) && !defined(ROI_PROJECTOR_DISABLE_SIMD)
+      return &CoverageBatchNeon;
+#else
+      return nullptr;
+#endif
+    case KernelIsa::kAvx2:
+#if defined(ROI_PROJECTOR_HAVE_X86_KERNELS)
+      return &CoverageBatchAvx2;
+#else
+      return nullptr;
+#endif
+    case KernelIsa::kAvx512:
+#if defined(ROI_PROJECTOR_HAVE_X86_KERNELS)
+      return &CoverageBatchAvx512;
+#else
+      return nullptr;
+#endif
+  }
+  return nullptr;
+}
+
+// Depth pyramid kernels for the same ISA. They need no more than AVX2, so
+// AVX-512 hosts share those.
+const DepthPyramidKernels* DepthPyramidKernelsFor(KernelIsa isa) {
+  switch (isa) {
+    case KernelIsa::kScalar:
+      return &kDepthPyramidScalar;
+    case KernelIsa::kNeon:
+#if defined(__aarch64__) && !defined(ROI_PROJECTOR_DISABLE_SIMD)
+      return &kDepthPyramidNeon;
+#else
+      return nullptr;
+#endif
+    case KernelIsa::kAvx2:
+    case KernelIsa::kAvx512:
+#if defined(ROI_PROJECTOR_HAVE_X86_KERNELS)
+      return &kDepthPyramidAvx2;
+#else
+      return nullptr;
+#endif
+  }
+  return nullptr;
+}
+
+// Widest kernel the build and the CPU both support, checked once at load.
+KernelIsa BestKernelIsa() {
+  const KernelIsa kPreference[] = {KernelIsa::kAvx512, KernelIsa::kAvx2,
+                                   KernelIsa::kNeon};
+  for (KernelIsa isa : kPreference) {
+    if (KernelFor(isa) != nullptr) {
+      return isa;
+    }
+  }
+  return KernelIsa::kScalar;
+}
+
+struct KernelState {
+  std::atomic<KernelIsa> isa{BestKernelIsa()};
+  std::atomic<ProjectBatchFn> fn{KernelFor(BestKernelIsa())};
+  std::atomic<CoverageBatchFn> coverage_fn{CoverageKernelFor(BestKernelIsa())};
+  std::atomic<const DepthPyramidKernels*> depth_pyramid{
+      DepthPyramidKernelsFor(BestKernelIsa())};
+};
+
+KernelState& State() {
+  static KernelState state;
+  return state;
+}
+
+}  // namespace
+
+ProjectBatchFn ActiveProjectBatch() noexcept {
+  return State().fn.load(std::memory_order_relaxed);
+}
+
+CoverageBatchFn ActiveCoverageBatch() noexcept {
+  return State().coverage_fn.load(std::memory_order_relaxed);
+}
+
+const DepthPyramidKernels& ActiveDepthPyramidKernels() noexcept {
+  return *State().depth_pyramid.load(std::memory_order_relaxed);
+}
+
+}  // namespace detail
+
+bool IsKernelIsaSupported(KernelIsa isa) {
+  return detail::KernelFor(isa) != nullptr;
+}
+
+KernelIsa ActiveKernelIsa() {
+  return detail::State().isa.load(std::memory_order_relaxed);
+}
+
+bool SetKernelIsa(KernelIsa isa) {
+  const detail::ProjectBatchFn fn = detail::KernelFor(isa);
+  if (fn == nullptr) {
+    return false;
+  }
+  detail::State().fn.store(fn, std::memory_order_relaxed);
+  detail::State().coverage_fn.store(detail::CoverageKernelFor(isa),
+                                    std::memory_order_relaxed);
+  detail::State().depth_pyramid.store(detail::DepthPyramidKernelsFor(isa),
+                                      std::memory_order_relaxed);
+  detail::State().isa.store(isa, std::memory_order_relaxed);
+  return true;
+}
+
+const char* KernelIsaName(KernelIsa isa) {
+  switch (isa) {
+    case KernelIsa::kScalar:
+      return "scalar";
+    case KernelIsa::kNeon:
+      return "neon";
+    case KernelIsa::kAvx2:
+      return "avx2";
+    case KernelIsa::kAvx512:
+      return "avx512";
+  }
+  return "unknown";
+}
+
+}  // namespace roi_projector
@@ -0,0 +1,390 @@
+// Projection math shared by Projector and the batch kernels.
+// Internal header, not installed.
+//
+// The pipeline (undistort -> extrinsic -> distort -> intrinsics) is written
+// once as templates over a lane type `V`. Each ISA translation unit supplies
+// its own `V` wrapper (kept in an unnamed namespace so template instances
+// compiled with ISA flags stay local to that unit); ScalarF64 below is the
+// one-lane fallback. For the same reason the templates call no inline
+// function shared with the baseline units, such as std::isfinite: one left
+// out of line, as at -O0, is emitted as a weak symbol compiled with ISA
+// flags, and the linker may keep that copy for every caller. Helpers they
+// need are templates on `V` as well.
+//
+// Every lane type evaluates the same operations in the same order without
+// fused multiply-add, so SIMD results match the scalar path to within
+// kKernelTolerancePx (in practice they are bit-identical).
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "roi_projector.h"
+#include "undistort_lut.h"
+
+namespace roi_projector {
+namespace detail {
+
+// Maximum difference, in camera2 pixels, allowed between a SIMD kernel and
+// the scalar path for the same input.
+constexpr double kKernelTolerancePx = 1e-9;
+
+using ProjectBatchFn = size_t (*)(const CompiledCalibration& params,
+                                  const double* u, const double* v,
+                                  const double* z, size_t count, double* out_u,
+                                  double* out_v, ProjectStatus* status,
+                                  uint8_t* iterations) noexcept;
+
+size_t ProjectBatchScalar(const CompiledCalibration& params,
+                          const double* u, const double* v, const double* z,
+                          size_t count, double* out_u, double* out_v,
+                          ProjectStatus* status, uint8_t* iterations) noexcept;
+#if defined(__aarch64__)
+size_t ProjectBatchNeon(const CompiledCalibration& params,
+                        const double* u, const double* v, const double* z,
+                        size_t count, double* out_u, double* out_v,
+                        ProjectStatus* status, uint8_t* iterations) noexcept;
+#endif
+#if defined(ROI_PROJECTOR_HAVE_X86_KERNELS)
+size_t ProjectBatchAvx2(const CompiledCalibration& params,
+                        const double* u, const double* v, const double* z,
+                        size_t count, double* out_u, double* out_v,
+                        ProjectStatus* status, uint8_t* iterations) noexcept;
+size_t ProjectBatchAvx512(const CompiledCalibration& params,
+                          const double* u, const double* v, const double* z,
+                          size_t count, double* out_u, double* out_v,
+                          ProjectStatus* status, uint8_t* iterations) noexcept;
+#endif
+
+// Kernel selected by SetKernelIsa (or automatically at load time).
+ProjectBatchFn ActiveProjectBatch() noexcept;
+
+// One-lane "vector" of doubles.
+struct ScalarF64 {
+  using Mask = bool;
+  static constexpr size_t kWidth = 1;
+
+  double v;
+
+  static ScalarF64 Load(const double* p) { return {*p}; }
+  static ScalarF64 Set(double x) { return {x}; }
+  void Store(double* p) const { *p = v; }
+
+  friend ScalarF64 operator+(ScalarF64 a, ScalarF64 b) { return {a.v + b.v}; }
+  friend ScalarF64 operator-(ScalarF64 a, ScalarF64 b) { return {a.v - b.v}; }
+  friend ScalarF64 operator*(ScalarF64 a, ScalarF64 b) { return {a.v * b.v}; }
+  friend ScalarF64 operator/(ScalarF64 a, ScalarF64 b) { return {a.v / b.v}; }
+
+  static Mask Greater(ScalarF64 a, ScalarF64 b) { return a.v > b.v; }
+  static Mask Less(ScalarF64 a, ScalarF64 b) { return a.v < b.v; }
+  static Mask Equal(ScalarF64 a, ScalarF64 b) { return a.v == b.v; }
+  static Mask All() { return true; }
+  static Mask IsFinite(ScalarF64 a) { return std::isfinite(a.v); }
+  static Mask And(Mask a, Mask b) { return a && b; }
+  static Mask Or(Mask a, Mask b) { return a || b; }
+  static ScalarF64 Select(Mask m, ScalarF64 a, ScalarF64 b) {
+    return m ? a : b;
+  }
+  static unsigned Bits(Mask m) { return m ? 1u : 0u; }
+};
+
+template <class V>
+inline void DistortNormalized(V x, V y, const double* dist, V& xd, V& yd) {
+  const V k1 = V::Set(dist[0]);
+  const V k2 = V::Set(dist[1]);
+  const V p1 = V::Set(dist[2]);
+  const V p2 = V::Set(dist[3]);
+  const V k3 = V::Set(dist[4]);
+  const V one = V::Set(1.0);
+  const V two = V::Set(2.0);
+
+  const V r2 = x * x + y * y;
+  const V radial = one + k1 * r2 + k2 * r2 * r2 + k3 * r2 * r2 * r2;
+  const V x_t = two * p1 * x * y + p2 * (r2 + two * x * x);
+  const V y_t = p1 * (r2 + two * y * y) + two * p2 * x * y;
+
+  xd = x * radial + x_t;
+  yd = y * radial + y_t;
+}
+
+// Newton-Raphson inverse of DistortNormalized using its analytic Jacobian.
+// A lane stops updating once |D(x) - xd| < tolerance, after at most
+// max_iterations steps. Returns the lanes that converged; if `iterations`
+// is non-null, the step count of each lane is added to it.
+template <class V>
+inline typename V::Mask UndistortNormalized(V xd, V yd, const double* dist,
+                                            int max_iterations,
+                                            double tolerance, V& xu, V& yu,
+                                            uint8_t* iterations) noexcept {
+  constexpr unsigned kAllLanes = (1u << V::kWidth) - 1u;
+  const V k1 = V::Set(dist[0]);
+  const V k2 = V::Set(dist[1]);
+  const V p1 = V::Set(dist[2]);
+  const V p2 = V::Set(dist[3]);
+  const V k3 = V::Set(dist[4]);
+  const V one = V::Set(1.0);
+  const V two = V::Set(2.0);
+  const V three = V::Set(3.0);
+  const V six = V::Set(6.0);
+  const V tolerance2 = V::Set(tolerance * tolerance);
+
+  V x = xd;
+  V y = yd;
+  typename V::Mask converged;
+  for (int step = 0;; ++step) {
+    const V r2 = x * x + y * y;
+    const V radial = one + k1 * r2 + k2 * r2 * r2 + k3 * r2 * r2 * r2;
+    const V x_t = two * p1 * x * y + p2 * (r2 + two * x * x);
+    const V y_t = p1 * (r2 + two * y * y) + two * p2 * x * y;
+    const V res_x = x * radial + x_t - xd;
+    const V res_y = y * radial + y_t - yd;
+    converged = V::Less(res_x * res_x + res_y * res_y, tolerance2);
+    const unsigned done = V::Bits(converged);
+    if (done == kAllLanes || step == max_iterations) {
+      break;
+    }
+    if (iterations != nullptr) {
+      for (size_t lane = 0; lane < V::kWidth; ++lane) {
+        iterations[lane] += ((done >> lane) & 1u) == 0 ? 1 : 0;
+      }
+    }
+
+    // d(radial)/d(r2), then the 2x2 Jacobian [a b; b d] of the distortion.
+    const V d_radial = k1 + two * k2 * r2 + three * k3 * r2 * r2;
+    const V a = radial + two * x * x * d_radial + two * p1 * y + six * p2 * x;
+    const V b = two * x * y * d_radial + two * p1 * x + two * p2 * y;
+    const V d = radial + two * y * y * d_radial + six * p1 * y + two * p2 * x;
+    const V det = a * d - b * b;
+    const V step_x = (d * res_x - b * res_y) / det;
+    const V step_y = (a * res_y - b * res_x) / det;
+    x = V::Select(converged, x, x - step_x);
+    y = V::Select(converged, y, y - step_y);
+  }
+  xu = x;
+  yu = y;
+  return converged;
+}
+
+// Undistorts camera1 pixel (u, v) with normalized coordinates (xd, yd),
+// fetching from the table where possible. Lanes that fall outside it are
+// solved directly, so each lane gets the same answer whatever group it is
+// processed in. Returns the lanes with a usable result.
+template <class V>
+inline typename V::Mask UndistortWithLut(const CompiledCalibration& p, V u,
+                                         V v, V xd, V yd, V& xu, V& yu,
+                                         uint8_t* iterations) noexcept {
+  double us[V::kWidth];
+  double vs[V::kWidth];
+  double xs[V::kWidth];
+  double ys[V::kWidth];
+  u.Store(us);
+  v.Store(vs);
+  bool all_hit = true;
+  bool hit[V::kWidth];
+  for (size_t lane = 0; lane < V::kWidth; ++lane) {
+    hit[lane] =
+        p.lut1->SampleFor<V>(us[lane], vs[lane], xs[lane], ys[lane]);
+    all_hit = all_hit && hit[lane];
+  }
+  if (all_hit) {
+    xu = V::Load(xs);
+    yu = V::Load(ys);
+    return V::All();
+  }
+
+  V sx = xd;
+  V sy = yd;
+  uint8_t solve_iterations[V::kWidth] = {};
+  const unsigned solved = V::Bits(UndistortNormalized(
+      xd, yd, p.dist1, p.undistort_max_iterations, p.undistort_tolerance, sx,
+      sy, solve_iterations));
+  double solved_x[V::kWidth];
+  double solved_y[V::kWidth];
+  double usable[V::kWidth];
+  sx.Store(solved_x);
+  sy.Store(solved_y);
+  for (size_t lane = 0; lane < V::kWidth; ++lane) {
+    usable[lane] = 1.0;
+    if (!hit[lane]) {
+      xs[lane] = solved_x[lane];
+      ys[lane] = solved_y[lane];
+      usable[lane] = ((solved >> lane) & 1u) != 0 ? 1.0 : 0.0;
+      if (iterations != nullptr) {
+        iterations[lane] += solve_iterations[lane];
+      }
+    }
+  }
+  xu = V::Load(xs);
+  yu = V::Load(ys);
+  return V::Greater(V::Load(usable), V::Set(0.5));
+}
+
+// Per-lane outcome of ProjectLanes, from first to last stage.
+template <class V>
+struct LaneStatus {
+  typename V::Mask depth_ok;      // input depth positive and finite
+  typename V::Mask undistort_ok;  // camera1 undistortion converged
+  typename V::Mask ok;            // final coordinates usable
+};
+
+// Projects one group of lanes. `iterations` (V::kWidth entries, may be
+// null) receives the undistortion step count per lane.
+template <class V>
+inline void ProjectLanes(const CompiledCalibration& p, V u, V v, V depth,
+                         V& out_u, V& out_v, LaneStatus<V>& status,
+                         uint8_t* iterations) noexcept {
+  const V zero = V::Set(0.0);
+
+  V x_norm = (u - V::Set(p.cx1)) * V::Set(p.inv_fx1);
+  V y_norm = (v - V::Set(p.cy1)) * V::Set(p.inv_fy1);
+  status.undistort_ok = V::All();
+  if (p.lut1 != nullptr) {
+    status.undistort_ok = UndistortWithLut(p, u, v, x_norm, y_norm, x_norm,
+                                           y_norm, iterations);
+  } else if (p.has_dist1) {
+    status.undistort_ok = UndistortNormalized(
+        x_norm, y_norm, p.dist1, p.undistort_max_iterations,
+        p.undistort_tolerance, x_norm, y_norm, iterations);
+  }
+
+  const V x = x_norm * depth;
+  const V y = y_norm * depth;
+  const V z = depth;
+
+  V z2;
+  if (p.has_dist2) {
+    const auto& e = p.rt;
+    const V x2 = V::Set(e[0][0]) * x + V::Set(e[0][1]) * y +
+                 V::Set(e[0][2]) * z + V::Set(e[0][3]);
+    const V y2 = V::Set(e[1][0]) * x + V::Set(e[1][1]) * y +
+                 V::Set(e[1][2]) * z + V::Set(e[1][3]);
+    z2 = V::Set(e[2][0]) * x + V::Set(e[2][1]) * y + V::Set(e[2][2]) * z +
+         V::Set(e[2][3]);
+    V x2_norm = x2 / z2;
+    V y2_norm = y2 / z2;
+    DistortNormalized(x2_norm, y2_norm, p.dist2, x2_norm, y2_norm);
+    out_u = V::Set(p.fx2) * x2_norm + V::Set(p.cx2);
+    out_v = V::Set(p.fy2) * y2_norm + V::Set(p.cy2);
+  } else {
+    // Pinhole camera2: K2 is already folded into k2rt.
+    const auto& e = p.k2rt;
+    const V pu = V::Set(e[0][0]) * x + V::Set(e[0][1]) * y +
+                 V::Set(e[0][2]) * z + V::Set(e[0][3]);
+    const V pv = V::Set(e[1][0]) * x + V::Set(e[1][1]) * y +
+                 V::Set(e[1][2]) * z + V::Set(e[1][3]);
+    z2 = V::Set(e[2][0]) * x + V::Set(e[2][1]) * y + V::Set(e[2][2]) * z +
+         V::Set(e[2][3]);
+    out_u = pu / z2;
+    out_v = pv / z2;
+  }
+
+  status.depth_ok = V::And(V::Greater(depth, zero), V::IsFinite(depth));
+  status.ok = V::And(status.depth_ok, status.undistort_ok);
+  status.ok =
+      V::And(status.ok, V::And(V::Greater(z2, zero), V::IsFinite(z2)));
+  status.ok = V::And(status.ok,
+                     V::And(V::IsFinite(out_u), V::IsFinite(out_v)));
+}
+
+// Maps lane `lane` of a LaneStatus<V> (as bit masks) to a ProjectStatus.
+template <class V>
+inline ProjectStatus LaneProjectStatus(unsigned ok_bits, unsigned depth_bits,
+                                       unsigned undistort_bits, size_t lane) {
+  if (((ok_bits >> lane) & 1u) != 0) {
+    return ProjectStatus::kOk;
+  }
+  if (((depth_bits >> lane) & 1u) == 0) {
+    return ProjectStatus::kInvalidDepth;
+  }
+  if (((undistort_bits >> lane) & 1u) == 0) {
+    return ProjectStatus::kUndistortDiverged;
+  }
+  return ProjectStatus::kProjectionFailed;
+}
+
+// Projects `lanes` (<= V::kWidth) points starting at index 0 of each array
+// and returns how many succeeded.
+template <class V>
+inline size_t ProjectGroup(const CompiledCalibration& params,
+                           const double* u, const double* v, const double* z,
+                           double* out_u, double* out_v, ProjectStatus* status,
+                           uint8_t* iterations, size_t lanes) {
+  // A constant, so quiet_NaN() is not called.
+  constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+  const V nan = V::Set(kNaN);
+  V ou = nan;
+  V ov = nan;
+  LaneStatus<V> lane_status;
+  uint8_t lane_iterations[V::kWidth] = {};
+  ProjectLanes(params, V::Load(u), V::Load(v), V::Load(z), ou, ov,
+               lane_status, lane_iterations);
+
+  double store_u[V::kWidth];
+  double store_v[V::kWidth];
+  double* dst_u = (lanes == V::kWidth) ? out_u : store_u;
+  double* dst_v = (lanes == V::kWidth) ? out_v : store_v;
+  V::Select(lane_status.ok, ou, nan).Store(dst_u);
+  V::Select(lane_status.ok, ov, nan).Store(dst_v);
+
+  const unsigned ok_bits = V::Bits(lane_status.ok);
+  const unsigned depth_bits = V::Bits(lane_status.depth_ok);
+  const unsigned undistort_bits = V::Bits(lane_status.undistort_ok);
+  size_t ok_count = 0;
+  for (size_t lane = 0; lane < lanes; ++lane) {
+    ok_count += ((ok_bits >> lane) & 1u) != 0 ? 1 : 0;
+    if (lanes != V::kWidth) {
+      out_u[lane] = store_u[lane];
+      out_v[lane] = store_v[lane];
+    }
+    if (status != nullptr) {
+      status[lane] =
+          LaneProjectStatus<V>(ok_bits, depth_bits, undistort_bits, lane);
+    }
+    if (iterations != nullptr) {
+      iterations[lane] = lane_iterations[lane];
+    }
+  }
+  return ok_count;
+}
+
+// Runs ProjectLanes over `count` points, `V::kWidth` at a time. The tail is
+// padded to a full group rather than handed to ScalarF64 so that ISA-specific
+// translation units never emit scalar template code compiled with their
+// target flags. Returns the number of successful points.
+template <class V>
+size_t ProjectBatch(const CompiledCalibration& params, const double* u,
+                    const double* v, const double* z, size_t count,
+                    double* out_u, double* out_v, ProjectStatus* status,
+                    uint8_t* iterations) noexcept {
+  constexpr size_t kWidth = V::kWidth;
+  size_t ok_count = 0;
+  size_t i = 0;
+  for (; i + kWidth <= count; i += kWidth) {
+    ok_count += ProjectGroup<V>(
+        params, u + i, v + i, z + i, out_u + i, out_v + i,
+        status != nullptr ? status + i : nullptr,
+        iterations != nullptr ? iterations + i : nullptr, kWidth);
+  }
+  if (i < count) {
+    double pad_u[kWidth];
+    double pad_v[kWidth];
+    double pad_z[kWidth];
+    const size_t lanes = count - i;
+    for (size_t lane = 0; lane < kWidth; ++lane) {
+      const bool live = lane < lanes;
+      pad_u[lane] = live ? u[i + lane] : params.cx1;
+      pad_v[lane] = live ? v[i + lane] : params.cy1;
+      pad_z[lane] = live ? z[i + lane] : 1.0;
+    }
+    ok_count += ProjectGroup<V>(
+        params, pad_u, pad_v, pad_z, out_u + i, out_v + i,
+        status != nullptr ? status + i : nullptr,
+        iterations != nullptr ? iterations + i : nullptr, lanes);
+  }
+  return ok_count;
+}
+
+}  // namespace detail
+}  // namespace roi_projector
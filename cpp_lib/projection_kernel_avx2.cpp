@@ -0,0 +1,202 @@
+// AVX2 projection and coverage kernels, four double lanes per instruction,
+// and depth pyramid kernels, eight float lanes (x86-64).
+// Built with -mavx2 and only called when CPUID reports AVX2.
+#include "projection_kernel.h"
+
+#include <immintrin.h>
+
+#include <limits>
+
+#include "coverage_kernel.h"
+#include "depth_kernel.h"
+#include "depth_sampler.h"
+
+namespace roi_projector {
+namespace detail {
+
+namespace {
+
+struct Avx2F64x4 {
+  using Mask = __m256d;
+  static constexpr size_t kWidth = 4;
+
+  __m256d v;
+
+  static Avx2F64x4 Load(const double* p) { return {_mm256_loadu_pd(p)}; }
+  static Avx2F64x4 Set(double x) { return {_mm256_set1_pd(x)}; }
+  void Store(double* p) const { _mm256_storeu_pd(p, v); }
+
+  friend Avx2F64x4 operator+(Avx2F64x4 a, Avx2F64x4 b) {
+    return {_mm256_add_pd(a.v, b.v)};
+  }
+  friend Avx2F64x4 operator-(Avx2F64x4 a, Avx2F64x4 b) {
+    return {_mm256_sub_pd(a.v, b.v)};
+  }
+  friend Avx2F64x4 operator*(Avx2F64x4 a, Avx2F64x4 b) {
+    return {_mm256_mul_pd(a.v, b.v)};
+  }
+  friend Avx2F64x4 operator/(Avx2F64x4 a, Avx2F64x4 b) {
+    return {_mm256_div_pd(a.v, b.v)};
+  }
+
+  static Mask Greater(Avx2F64x4 a, Avx2F64x4 b) {
+    return _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ);
+  }
+  static Mask Less(Avx2F64x4 a, Avx2F64x4 b) {
+    return _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ);
+  }
+  static Mask Equal(Avx2F64x4 a, Avx2F64x4 b) {
+    return _mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ);
+  }
+  static Mask All() { return _mm256_castsi256_pd(_mm256_set1_epi64x(-1)); }
+  // x - x is 0 for finite x and NaN for inf/NaN.
+  static Mask IsFinite(Avx2F64x4 a) {
+    return _mm256_cmp_pd(_mm256_sub_pd(a.v, a.v), _mm256_setzero_pd(),
+                         _CMP_EQ_OQ);
+  }
+  static Mask And(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+  static Mask Or(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+  static Avx2F64x4 Select(Mask m, Avx2F64x4 a, Avx2F64x4 b) {
+    return {_mm256_blendv_pd(b.v, a.v, m)};
+  }
+  static unsigned Bits(Mask m) {
+    return static_cast<unsigned>(_mm256_movemask_pd(m));
+  }
+};
+
+}  // namespace
+
+size_t ProjectBatchAvx2(const CompiledCalibration& params,
+                        const double* u, const double* v, const double* z,
+                        size_t count, double* out_u, double* out_v,
+                        ProjectStatus* status, uint8_t* iterations) noexcept {
+  return ProjectBatch<Avx2F64x4>(params, u, v, z, count, out_u, out_v, status,
+                                 iterations);
+}
+
+void CoverageBatchAvx2(const QuadPairBlock& block, size_t count,
+                       double* coverage, uint8_t* fallback) noexcept {
+  CoverageBatch<Avx2F64x4>(block, count, coverage, fallback);
+}
+
+namespace {
+
+// The scalar tails use these, with internal linkage, rather than MinKey,
+// MaxKey or std::min: a shared inline function left out of line here would
+// be emitted compiled with -mavx2 (see projection_kernel.h).
+constexpr float kInf = std::numeric_limits<float>::infinity();
+
+// std::min and std::max of (a, b) and (c, d), then of the two.
+float TailMin(float a, float b, float c, float d) {
+  const float ab = b < a ? b : a;
+  const float cd = d < c ? d : c;
+  return cd < ab ? cd : ab;
+}
+float TailMax(float a, float b, float c, float d) {
+  const float ab = a < b ? b : a;
+  const float cd = c < d ? d : c;
+  return ab < cd ? cd : ab;
+}
+
+// MinKey and MaxKey (depth_kernel.h).
+float TailMinKey(float depth) {
+  return depth >= kMinValidDepth && depth <= kMaxValidDepth ? depth : kInf;
+}
+float TailMaxKey(float depth) {
+  return depth >= kMinValidDepth && depth <= kMaxValidDepth ? depth : -kInf;
+}
+
+// Pairs lanes (0, 1), (2, 3), ... of a followed by b: even and odd lanes
+// are gathered per 128-bit half, so the 64-bit chunks of the result come
+// out as 0, 2, 1, 3 and are put back in order.
+__m256 PairwiseMin(__m256 a, __m256 b) {
+  const __m256 m =
+      _mm256_min_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+                    _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+  return _mm256_castpd_ps(
+      _mm256_permute4x64_pd(_mm256_castps_pd(m), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+__m256 PairwiseMax(__m256 a, __m256 b) {
+  const __m256 m =
+      _mm256_max_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+                    _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+  return _mm256_castpd_ps(
+      _mm256_permute4x64_pd(_mm256_castps_pd(m), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+void ReduceDepthAvx2(const float* row_a, const float* row_b, size_t count,
+                     float* out_min, float* out_max) noexcept {
+  const __m256 lo = _mm256_set1_ps(kMinValidDepth);
+  const __m256 hi = _mm256_set1_ps(kMaxValidDepth);
+  const __m256 pos_inf = _mm256_set1_ps(kInf);
+  const __m256 neg_inf = _mm256_set1_ps(-kInf);
+  // Ordered compares are false for NaN, so NaN counts as a hole.
+  auto valid = [&](__m256 d) {
+    return _mm256_and_ps(_mm256_cmp_ps(d, lo, _CMP_GE_OQ),
+                         _mm256_cmp_ps(d, hi, _CMP_LE_OQ));
+  };
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const size_t j = 2 * i;
+    const __m256 a0 = _mm256_loadu_ps(row_a + j);
+    const __m256 a1 = _mm256_loadu_ps(row_a + j + 8);
+    const __m256 b0 = _mm256_loadu_ps(row_b + j);
+    const __m256 b1 = _mm256_loadu_ps(row_b + j + 8);
+    const __m256 va0 = valid(a0);
+    const __m256 va1 = valid(a1);
+    const __m256 vb0 = valid(b0);
+    const __m256 vb1 = valid(b1);
+    const __m256 lo0 = _mm256_min_ps(_mm256_blendv_ps(pos_inf, a0, va0),
+                                     _mm256_blendv_ps(pos_inf, b0, vb0));
+    const __m256 lo1 = _mm256_min_ps(_mm256_blendv_ps(pos_inf, a1, va1),
+                                     _mm256_blendv_ps(pos_inf, b1, vb1));
+    const __m256 hi0 = _mm256_max_ps(_mm256_blendv_ps(neg_inf, a0, va0),
+                                     _mm256_blendv_ps(neg_inf, b0, vb0));
+    const __m256 hi1 = _mm256_max_ps(_mm256_blendv_ps(neg_inf, a1, va1),
+                                     _mm256_blendv_ps(neg_inf, b1, vb1));
+    _mm256_storeu_ps(out_min + i, PairwiseMin(lo0, lo1));
+    _mm256_storeu_ps(out_max + i, PairwiseMax(hi0, hi1));
+  }
+  for (; i < count; ++i) {
+    const size_t j = 2 * i;
+    out_min[i] = TailMin(TailMinKey(row_a[j]), TailMinKey(row_a[j + 1]),
+                         TailMinKey(row_b[j]), TailMinKey(row_b[j + 1]));
+    out_max[i] = TailMax(TailMaxKey(row_a[j]), TailMaxKey(row_a[j + 1]),
+                         TailMaxKey(row_b[j]), TailMaxKey(row_b[j + 1]));
+  }
+}
+
+void ReduceDepthRowsAvx2(const float* min_a, const float* min_b,
+                         const float* max_a, const float* max_b,
+                         size_t count, float* out_min,
+                         float* out_max) noexcept {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const size_t j = 2 * i;
+    const __m256 lo0 = _mm256_min_ps(_mm256_loadu_ps(min_a + j),
+                                     _mm256_loadu_ps(min_b + j));
+    const __m256 lo1 = _mm256_min_ps(_mm256_loadu_ps(min_a + j + 8),
+                                     _mm256_loadu_ps(min_b + j + 8));
+    const __m256 hi0 = _mm256_max_ps(_mm256_loadu_ps(max_a + j),
+                                     _mm256_loadu_ps(max_b + j));
+    const __m256 hi1 = _mm256_max_ps(_mm256_loadu_ps(max_a + j + 8),
+                                     _mm256_loadu_ps(max_b + j + 8));
+    _mm256_storeu_ps(out_min + i, PairwiseMin(lo0, lo1));
+    _mm256_storeu_ps(out_max + i, PairwiseMax(hi0, hi1));
+  }
+  for (; i < count; ++i) {
+    out_min[i] = TailMin(min_a[2 * i], min_a[2 * i + 1], min_b[2 * i],
+                         min_b[2 * i + 1]);
+    out_max[i] = TailMax(max_a[2 * i], max_a[2 * i + 1], max_b[2 * i],
+                         max_b[2 * i + 1]);
+  }
+}
+
+}  // namespace
+
+const DepthPyramidKernels kDepthPyramidAvx2 = {&ReduceDepthAvx2,
+                                               &ReduceDepthRowsAvx2};
+
+}  // namespace detail
+}  // namespace roi_projector
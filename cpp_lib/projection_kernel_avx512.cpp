@@ -0,0 +1,77 @@
+// AVX-512 projection and coverage kernels: eight double lanes per
+// instruction (x86-64).
+// Built with -mavx512f and only called when CPUID reports AVX-512F.
+#include "projection_kernel.h"
+
+#include <immintrin.h>
+
+#include "coverage_kernel.h"
+
+namespace roi_projector {
+namespace detail {
+
+namespace {
+
+struct Avx512F64x8 {
+  using Mask = __mmask8;
+  static constexpr size_t kWidth = 8;
+
+  __m512d v;
+
+  static Avx512F64x8 Load(const double* p) { return {_mm512_loadu_pd(p)}; }
+  static Avx512F64x8 Set(double x) { return {_mm512_set1_pd(x)}; }
+  void Store(double* p) const { _mm512_storeu_pd(p, v); }
+
+  friend Avx512F64x8 operator+(Avx512F64x8 a, Avx512F64x8 b) {
+    return {_mm512_add_pd(a.v, b.v)};
+  }
+  friend Avx512F64x8 operator-(Avx512F64x8 a, Avx512F64x8 b) {
+    return {_mm512_sub_pd(a.v, b.v)};
+  }
+  friend Avx512F64x8 operator*(Avx512F64x8 a, Avx512F64x8 b) {
+    return {_mm512_mul_pd(a.v, b.v)};
+  }
+  friend Avx512F64x8 operator/(Avx512F64x8 a, Avx512F64x8 b) {
+    return {_mm512_div_pd(a.v, b.v)};
+  }
+
+  static Mask Greater(Avx512F64x8 a, Avx512F64x8 b) {
+    return _mm512_cmp_pd_mask(a.v, b.v, _CMP_GT_OQ);
+  }
+  static Mask Less(Avx512F64x8 a, Avx512F64x8 b) {
+    return _mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ);
+  }
+  static Mask Equal(Avx512F64x8 a, Avx512F64x8 b) {
+    return _mm512_cmp_pd_mask(a.v, b.v, _CMP_EQ_OQ);
+  }
+  static Mask All() { return static_cast<Mask>(0xFF); }
+  // x - x is 0 for finite x and NaN for inf/NaN.
+  static Mask IsFinite(Avx512F64x8 a) {
+    return _mm512_cmp_pd_mask(_mm512_sub_pd(a.v, a.v), _mm512_setzero_pd(),
+                              _CMP_EQ_OQ);
+  }
+  static Mask And(Mask a, Mask b) { return static_cast<Mask>(a & b); }
+  static Mask Or(Mask a, Mask b) { return static_cast<Mask>(a | b); }
+  static Avx512F64x8 Select(Mask m, Avx512F64x8 a, Avx512F64x8 b) {
+    return {_mm512_mask_blend_pd(m, b.v, a.v)};
+  }
+  static unsigned Bits(Mask m) { return static_cast<unsigned>(m); }
+};
+
+}  // namespace
+
+size_t ProjectBatchAvx512(const CompiledCalibration& params,
+                          const double* u, const double* v, const double* z,
+                          size_t count, double* out_u, double* out_v,
+                          ProjectStatus* status, uint8_t* iterations) noexcept {
+  return ProjectBatch<Avx512F64x8>(params, u, v, z, count, out_u, out_v,
+                                   status, iterations);
+}
+
+void CoverageBatchAvx512(const QuadPairBlock& block, size_t count,
+                         double* coverage, uint8_t* fallback) noexcept {
+  CoverageBatch<Avx512F64x8>(block, count, coverage, fallback);
+}
+
+}  // namespace detail
+}  // namespace roi_projector
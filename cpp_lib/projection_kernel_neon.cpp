@@ -0,0 +1,181 @@
+// NEON projection and coverage kernels, two double lanes per instruction,
+// and depth pyramid kernels, four float lanes (aarch64).
+#include "projection_kernel.h"
+
+#include "coverage_kernel.h"
+#include "depth_kernel.h"
+#include "depth_sampler.h"
+
+#if defined(__aarch64__) && !defined(ROI_PROJECTOR_DISABLE_SIMD)
+
+#include <arm_neon.h>
+
+#include <limits>
+
+namespace roi_projector {
+namespace detail {
+
+namespace {
+
+struct NeonF64x2 {
+  using Mask = uint64x2_t;
+  static constexpr size_t kWidth = 2;
+
+  float64x2_t v;
+
+  static NeonF64x2 Load(const double* p) { return {vld1q_f64(p)}; }
+  static NeonF64x2 Set(double x) { return {vdupq_n_f64(x)}; }
+  void Store(double* p) const { vst1q_f64(p, v); }
+
+  friend NeonF64x2 operator+(NeonF64x2 a, NeonF64x2 b) {
+    return {vaddq_f64(a.v, b.v)};
+  }
+  friend NeonF64x2 operator-(NeonF64x2 a, NeonF64x2 b) {
+    return {vsubq_f64(a.v, b.v)};
+  }
+  friend NeonF64x2 operator*(NeonF64x2 a, NeonF64x2 b) {
+    return {vmulq_f64(a.v, b.v)};
+  }
+  friend NeonF64x2 operator/(NeonF64x2 a, NeonF64x2 b) {
+    return {vdivq_f64(a.v, b.v)};
+  }
+
+  static Mask Greater(NeonF64x2 a, NeonF64x2 b) { return vcgtq_f64(a.v, b.v); }
+  static Mask Less(NeonF64x2 a, NeonF64x2 b) { return vcltq_f64(a.v, b.v); }
+  static Mask Equal(NeonF64x2 a, NeonF64x2 b) { return vceqq_f64(a.v, b.v); }
+  static Mask All() { return vdupq_n_u64(~uint64_t{0}); }
+  // x - x is 0 for finite x and NaN for inf/NaN.
+  static Mask IsFinite(NeonF64x2 a) {
+    return vceqq_f64(vsubq_f64(a.v, a.v), vdupq_n_f64(0.0));
+  }
+  static Mask And(Mask a, Mask b) { return vandq_u64(a, b); }
+  static Mask Or(Mask a, Mask b) { return vorrq_u64(a, b); }
+  static NeonF64x2 Select(Mask m, NeonF64x2 a, NeonF64x2 b) {
+    return {vbslq_f64(m, a.v, b.v)};
+  }
+  static unsigned Bits(Mask m) {
+    return static_cast<unsigned>((vgetq_lane_u64(m, 0) & 1u) |
+                                 ((vgetq_lane_u64(m, 1) & 1u) << 1));
+  }
+};
+
+}  // namespace
+
+size_t ProjectBatchNeon(const CompiledCalibration& params,
+                        const double* u, const double* v, const double* z,
+                        size_t count, double* out_u, double* out_v,
+                        ProjectStatus* status, uint8_t* iterations) noexcept {
+  return ProjectBatch<NeonF64x2>(params, u, v, z, count, out_u, out_v, status,
+                                 iterations);
+}
+
+void CoverageBatchNeon(const QuadPairBlock& block, size_t count,
+                       double* coverage, uint8_t* fallback) noexcept {
+  CoverageBatch<NeonF64x2>(block, count, coverage, fallback);
+}
+
+namespace {
+
+// The scalar tails use these, with internal linkage, rather than MinKey,
+// MaxKey or std::min, so no shared inline function is compiled in an ISA
+// unit (see projection_kernel.h).
+constexpr float kInf = std::numeric_limits<float>::infinity();
+
+// std::min and std::max of (a, b) and (c, d), then of the two.
+float TailMin(float a, float b, float c, float d) {
+  const float ab = b < a ? b : a;
+  const float cd = d < c ? d : c;
+  return cd < ab ? cd : ab;
+}
+float TailMax(float a, float b, float c, float d) {
+  const float ab = a < b ? b : a;
+  const float cd = c < d ? d : c;
+  return ab < cd ? cd : ab;
+}
+
+// MinKey and MaxKey (depth_kernel.h).
+float TailMinKey(float depth) {
+  return depth >= kMinValidDepth && depth <= kMaxValidDepth ? depth : kInf;
+}
+float TailMaxKey(float depth) {
+  return depth >= kMinValidDepth && depth <= kMaxValidDepth ? depth : -kInf;
+}
+
+void ReduceDepthNeon(const float* row_a, const float* row_b, size_t count,
+                     float* out_min, float* out_max) noexcept {
+  const float32x4_t lo = vdupq_n_f32(kMinValidDepth);
+  const float32x4_t hi = vdupq_n_f32(kMaxValidDepth);
+  const float32x4_t pos_inf = vdupq_n_f32(kInf);
+  const float32x4_t neg_inf = vdupq_n_f32(-kInf);
+  // Compares are false for NaN, so NaN counts as a hole.
+  auto valid = [&](float32x4_t d) {
+    return vandq_u32(vcgeq_f32(d, lo), vcleq_f32(d, hi));
+  };
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const size_t j = 2 * i;
+    const float32x4_t a0 = vld1q_f32(row_a + j);
+    const float32x4_t a1 = vld1q_f32(row_a + j + 4);
+    const float32x4_t b0 = vld1q_f32(row_b + j);
+    const float32x4_t b1 = vld1q_f32(row_b + j + 4);
+    const uint32x4_t va0 = valid(a0);
+    const uint32x4_t va1 = valid(a1);
+    const uint32x4_t vb0 = valid(b0);
+    const uint32x4_t vb1 = valid(b1);
+    const float32x4_t lo0 = vminq_f32(vbslq_f32(va0, a0, pos_inf),
+                                      vbslq_f32(vb0, b0, pos_inf));
+    const float32x4_t lo1 = vminq_f32(vbslq_f32(va1, a1, pos_inf),
+                                      vbslq_f32(vb1, b1, pos_inf));
+    const float32x4_t hi0 = vmaxq_f32(vbslq_f32(va0, a0, neg_inf),
+                                      vbslq_f32(vb0, b0, neg_inf));
+    const float32x4_t hi1 = vmaxq_f32(vbslq_f32(va1, a1, neg_inf),
+                                      vbslq_f32(vb1, b1, neg_inf));
+    // Pairwise min/max of adjacent lanes, the first vector's pairs first.
+    vst1q_f32(out_min + i, vpminq_f32(lo0, lo1));
+    vst1q_f32(out_max + i, vpmaxq_f32(hi0, hi1));
+  }
+  for (; i < count; ++i) {
+    const size_t j = 2 * i;
+    out_min[i] = TailMin(TailMinKey(row_a[j]), TailMinKey(row_a[j + 1]),
+                         TailMinKey(row_b[j]), TailMinKey(row_b[j + 1]));
+    out_max[i] = TailMax(TailMaxKey(row_a[j]), TailMaxKey(row_a[j + 1]),
+                         TailMaxKey(row_b[j]), TailMaxKey(row_b[j + 1]));
+  }
+}
+
+void ReduceDepthRowsNeon(const float* min_a, const float* min_b,
+                         const float* max_a, const float* max_b,
+                         size_t count, float* out_min,
+                         float* out_max) noexcept {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const size_t j = 2 * i;
+    const float32x4_t lo0 =
+        vminq_f32(vld1q_f32(min_a + j), vld1q_f32(min_b + j));
+    const float32x4_t lo1 =
+        vminq_f32(vld1q_f32(min_a + j + 4), vld1q_f32(min_b + j + 4));
+    const float32x4_t hi0 =
+        vmaxq_f32(vld1q_f32(max_a + j), vld1q_f32(max_b + j));
+    const float32x4_t hi1 =
+        vmaxq_f32(vld1q_f32(max_a + j + 4), vld1q_f32(max_b + j + 4));
+    // Pairwise min/max of adjacent lanes, the first vector's pairs first.
+    vst1q_f32(out_min + i, vpminq_f32(lo0, lo1));
+    vst1q_f32(out_max + i, vpmaxq_f32(hi0, hi1));
+  }
+  for (; i < count; ++i) {
+    out_min[i] = TailMin(min_a[2 * i], min_a[2 * i + 1], min_b[2 * i],
+                         min_b[2 * i + 1]);
+    out_max[i] = TailMax(max_a[2 * i], max_a[2 * i + 1], max_b[2 * i],
+                         max_b[2 * i + 1]);
+  }
+}
+
+}  // namespace
+
+const DepthPyramidKernels kDepthPyramidNeon = {&ReduceDepthNeon,
+                                               &ReduceDepthRowsNeon};
+
+}  // namespace detail
+}  // namespace roi_projector
+
+#endif  // __aarch64__
@@ -0,0 +1,196 @@
+// 基于均匀网格的多 ROI × 多码区匹配。
+#include "roi_assigner.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace roi_projector {
+
+namespace {
+
+// 每个方向最多的网格数，防止离群的码区把网格撑得过大
+constexpr int kMaxGridDim = 256;
+
+bool IsFinite(const Quad& quad) {
+  for (const auto& pt : quad) {
+    if (!std::isfinite(pt.u) || !std::isfinite(pt.v)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+RoiAssigner::RoiAssigner(const RoiAssignerOptions& options)
+    : options_(options) {}
+
+bool RoiAssigner::CellRange(const Box& box, int& c0, int& r0, int& c1,
+                            int& r1) const {
+  if (cols_ == 0) {
+    return false;
+  }
+  const double gu0 = (box.min_u - origin_u_) * inv_cell_;
+  const double gv0 = (box.min_v - origin_v_) * inv_cell_;
+  const double gu1 = (box.max_u - origin_u_) * inv_cell_;
+  const double gv1 = (box.max_v - origin_v_) * inv_cell_;
+  if (gu1 < 0.0 || gv1 < 0.0 || gu0 >= cols_ || gv0 >= rows_) {
+    return false;
+  }
+  // 先在 double 中夹到网格内再取整：远处的角点（如 1e13）直接转 int 是未定义行为
+  c0 = static_cast<int>(std::clamp(gu0, 0.0, static_cast<double>(cols_ - 1)));
+  r0 = static_cast<int>(std::clamp(gv0, 0.0, static_cast<double>(rows_ - 1)));
+  c1 = static_cast<int>(std::clamp(gu1, 0.0, static_cast<double>(cols_ - 1)));
+  r1 = static_cast<int>(std::clamp(gv1, 0.0, static_cast<double>(rows_ - 1)));
+  return true;
+}
+
+void RoiAssigner::BuildGrid(const Quad* barcodes, size_t barcode_count) {
+  boxes_.resize(barcode_count);
+  valid_.resize(barcode_count);
+  Box bounds{0.0, 0.0, 0.0, 0.0};
+  double extent_sum = 0.0;
+  size_t valid_count = 0;
+  for (size_t i = 0; i < barcode_count; ++i) {
+    const Quad& q = barcodes[i];
+    valid_[i] = IsFinite(q) ? 1 : 0;
+    if (valid_[i] == 0) {
+      continue;
+    }
+    Box& b = boxes_[i];
+    b.min_u = std::min({q[0].u, q[1].u, q[2].u, q[3].u});
+    b.max_u = std::max({q[0].u, q[1].u, q[2].u, q[3].u});
+    b.min_v = std::min({q[0].v, q[1].v, q[2].v, q[3].v});
+    b.max_v = std::max({q[0].v, q[1].v, q[2].v, q[3].v});
+    if (valid_count == 0) {
+      bounds = b;
+    } else {
+      bounds.min_u = std::min(bounds.min_u, b.min_u);
+      bounds.min_v = std::min(bounds.min_v, b.min_v);
+      bounds.max_u = std::max(bounds.max_u, b.max_u);
+      bounds.max_v = std::max(bounds.max_v, b.max_v);
+    }
+    extent_sum += std::max(b.max_u - b.min_u, b.max_v - b.min_v);
+    ++valid_count;
+  }
+  cols_ = 0;
+  rows_ = 0;
+  if (valid_count == 0) {
+    return;
+  }
+
+  // 网格边长默认取码区平均尺寸的两倍，使大多数码区只落在 1~4 个格子里
+  const double width = bounds.max_u - bounds.min_u;
+  const double height = bounds.max_v - bounds.min_v;
+  double cell = options_.cell_size > 0.0
+                    ? options_.cell_size
+                    : 2.0 * extent_sum / static_cast<double>(valid_count);
+  cell = std::max({cell, width / (kMaxGridDim - 1),
+                   height / (kMaxGridDim - 1), 1e-6});
+  origin_u_ = bounds.min_u;
+  origin_v_ = bounds.min_v;
+  inv_cell_ = 1.0 / cell;
+  cols_ = std::min(kMaxGridDim, static_cast<int>(width * inv_cell_) + 1);
+  rows_ = std::min(kMaxGridDim, static_cast<int>(height * inv_cell_) + 1);
+
+  // 计数排序构建 CSR：先统计每格码区数，再前缀和，最后填充
+  const size_t cells = static_cast<size_t>(cols_) * rows_;
+  cell_start_.assign(cells + 1, 0);
+  int c0 = 0, r0 = 0, c1 = 0, r1 = 0;
+  for (size_t i = 0; i < barcode_count; ++i) {
+    if (valid_[i] == 0 || !CellRange(boxes_[i], c0, r0, c1, r1)) {
+      continue;
+    }
+    for (int r = r0; r <= r1; ++r) {
+      for (int c = c0; c <= c1; ++c) {
+        ++cell_start_[static_cast<size_t>(r) * cols_ + c + 1];
+      }
+    }
+  }
+  for (size_t c = 0; c < cells; ++c) {
+    cell_start_[c + 1] += cell_start_[c];
+  }
+  cell_items_.resize(cell_start_[cells]);
+  cell_fill_.assign(cell_start_.begin(), cell_start_.end() - 1);
+  for (size_t i = 0; i < barcode_count; ++i) {
+    if (valid_[i] == 0 || !CellRange(boxes_[i], c0, r0, c1, r1)) {
+      continue;
+    }
+    for (int r = r0; r <= r1; ++r) {
+      for (int c = c0; c <= c1; ++c) {
+        cell_items_[cell_fill_[static_cast<size_t>(r) * cols_ + c]++] =
+            static_cast<uint32_t>(i);
+      }
+    }
+  }
+}
+
+void RoiAssigner::Assign(const Quad* rois, size_t roi_count,
+                         const Quad* barcodes, size_t barcode_count,
+                         RoiAssignment& result) {
+  result.roi_for_barcode.assign(barcode_count, -1);
+  result.coverage.assign(barcode_count, 0.0);
+  result.unmatched_barcodes.clear();
+  result.unmatched_rois.clear();
+  last_candidate_count_ = 0;
+
+  BuildGrid(barcodes, barcode_count);
+  // 一个码区可能登记在多个格子里，用查询序号去重
+  stamp_.assign(barcode_count, 0);
+  query_ = 0;
+
+  int c0 = 0, r0 = 0, c1 = 0, r1 = 0;
+  for (size_t i = 0; i < roi_count; ++i) {
+    const CoverageRoi roi(rois[i]);
+    if (!roi.valid()) {
+      continue;
+    }
+    const Quad& q = rois[i];
+    const Box box{std::min({q[0].u, q[1].u, q[2].u, q[3].u}),
+                  std::min({q[0].v, q[1].v, q[2].v, q[3].v}),
+                  std::max({q[0].u, q[1].u, q[2].u, q[3].u}),
+                  std::max({q[0].v, q[1].v, q[2].v, q[3].v})};
+    if (!CellRange(box, c0, r0, c1, r1)) {
+      continue;
+    }
+    ++query_;
+    for (int r = r0; r <= r1; ++r) {
+      const size_t row = static_cast<size_t>(r) * cols_;
+      for (uint32_t k = cell_start_[row + c0]; k < cell_start_[row + c1 + 1];
+           ++k) {
+        const uint32_t b = cell_items_[k];
+        if (stamp_[b] == query_) {
+          continue;
+        }
+        stamp_[b] = query_;
+        const Box& bb = boxes_[b];
+        if (bb.max_u < box.min_u || bb.min_u > box.max_u ||
+            bb.max_v < box.min_v || bb.min_v > box.max_v) {
+          continue;
+        }
+        ++last_candidate_count_;
+        const double coverage = roi.Coverage(barcodes[b]);
+        if (coverage > options_.threshold && coverage > result.coverage[b]) {
+          result.roi_for_barcode[b] = static_cast<int>(i);
+          result.coverage[b] = coverage;
+        }
+      }
+    }
+  }
+
+  roi_matched_.assign(roi_count, 0);
+  for (size_t b = 0; b < barcode_count; ++b) {
+    if (result.roi_for_barcode[b] < 0) {
+      result.unmatched_barcodes.push_back(b);
+    } else {
+      roi_matched_[static_cast<size_t>(result.roi_for_barcode[b])] = 1;
+    }
+  }
+  for (size_t i = 0; i < roi_count; ++i) {
+    if (roi_matched_[i] == 0) {
+      result.unmatched_rois.push_back(i);
+    }
+  }
+}
+
+}  // namespace roi_projector
@@ -0,0 +1,75 @@
+// Assignment of barcode detections to projected ROIs in camera2 pixels.
+// Barcodes are bucketed into a uniform grid so each ROI is only scored
+// against the barcodes whose bounding boxes overlap its own.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "roi_coverage.h"
+
+namespace roi_projector {
+
+struct RoiAssignerOptions {
+  // A barcode is assigned to the ROI covering it most, if that coverage is
+  // strictly greater than this.
+  double threshold = kDefaultCoverageThreshold;
+  // Grid cell edge in pixels; 0 uses twice the mean barcode extent.
+  double cell_size = 0.0;
+};
+
+struct RoiAssignment {
+  // Per barcode: index of the best ROI, or -1 if none passes.
+  std::vector<int> roi_for_barcode;
+  // Per barcode: coverage by that ROI, 0 when unmatched.
+  std::vector<double> coverage;
+  std::vector<size_t> unmatched_barcodes;
+  // ROIs that are the best match of no barcode.
+  std::vector<size_t> unmatched_rois;
+};
+
+// Keeps its grid and scratch buffers between calls; after the first few
+// frames Assign only allocates when the input grows. Not thread-safe; use
+// one assigner per thread.
+class RoiAssigner {
+ public:
+  explicit RoiAssigner(const RoiAssignerOptions& options = {});
+
+  // Fills `result` (its vectors are reused). Ties go to the lower ROI
+  // index. Barcodes with non-finite corners are always unmatched.
+  void Assign(const Quad* rois, size_t roi_count, const Quad* barcodes,
+              size_t barcode_count, RoiAssignment& result);
+
+  // Candidate pairs scored by the last Assign, for tuning cell_size.
+  size_t last_candidate_count() const { return last_candidate_count_; }
+
+ private:
+  struct Box {
+    double min_u;
+    double min_v;
+    double max_u;
+    double max_v;
+  };
+
+  void BuildGrid(const Quad* barcodes, size_t barcode_count);
+  bool CellRange(const Box& box, int& c0, int& r0, int& c1, int& r1) const;
+
+  RoiAssignerOptions options_;
+  std::vector<Box> boxes_;            // per barcode
+  std::vector<uint8_t> valid_;        // per barcode: finite corners
+  std::vector<uint32_t> stamp_;       // per barcode: last ROI query seen
+  std::vector<uint32_t> cell_start_;  // CSR offsets, cols * rows + 1
+  std::vector<uint32_t> cell_items_;  // barcode indices
+  std::vector<uint32_t> cell_fill_;   // scratch write cursors
+  std::vector<uint8_t> roi_matched_;
+  double origin_u_ = 0.0;
+  double origin_v_ = 0.0;
+  double inv_cell_ = 1.0;
+  int cols_ = 0;
+  int rows_ = 0;
+  uint32_t query_ = 0;
+  size_t last_candidate_count_ = 0;
+};
+
+}  // namespace roi_projector
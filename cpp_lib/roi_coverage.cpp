@@ -0,0 +1,384 @@
+// ROI 与码区四边形的覆盖率计算。
+#include "roi_coverage.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+#include "coverage_kernel.h"
+#include "roi_trace.h"
+#include "static_polygon.h"
+
+namespace roi_projector {
+
+namespace {
+
+constexpr double kMinArea = 1e-9;
+
+// 凸四边形被四条边裁剪时每条边最多增加一个顶点（不超过 8 个）。
+// 输入可能是非凸或自交的四边形：每轮裁剪 k 个顶点最多变为 floor(1.5k) 个，
+// 4 -> 6 -> 9 -> 13 -> 19，按该上界分配以保证任意输入都不越界。
+using ClipPolygon = StaticPolygon<19>;
+
+// 鞋带公式求有向面积的两倍，接受 std::array 或 StaticPolygon
+template <class Polygon>
+double ComputeSignedDoubleArea(const Polygon& polygon) noexcept {
+  if (polygon.size() < 3) {
+    return 0.0;
+  }
+  double area = 0.0;
+  for (size_t i = 0; i < polygon.size(); ++i) {
+    const size_t j = (i + 1) % polygon.size();
+    area += polygon[i].u * polygon[j].v;
+    area -= polygon[j].u * polygon[i].v;
+  }
+  return area;
+}
+
+// 计算多边形面积（使用鞋带公式）
+template <class Polygon>
+double ComputePolygonArea(const Polygon& polygon) noexcept {
+  return std::fabs(ComputeSignedDoubleArea(polygon)) / 2.0;
+}
+
+// 每个转角的叉积都与有向面积同号（允许共线）即为凸四边形
+bool IsConvexQuad(const Quad& quad, double signed_area) noexcept {
+  for (size_t i = 0; i < 4; ++i) {
+    const Point2D& a = quad[i];
+    const Point2D& b = quad[(i + 1) % 4];
+    const Point2D& c = quad[(i + 2) % 4];
+    const double turn =
+        (b.u - a.u) * (c.v - b.v) - (b.v - a.v) * (c.u - b.u);
+    if (turn * signed_area < 0.0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// 分层计数：每个线程一组计数器，只由所属线程写入（relaxed 读加一再写，
+// 无需原子读改写指令）。各组挂在全局链表上，线程退出时把计数并入
+// retired 后摘除；Reset 只记录基线，不改写其他线程的计数器。
+struct TierCounters {
+  TierCounters();
+  ~TierCounters();
+
+  std::atomic<uint64_t> calls[kCoverageTierCount] = {};
+  TierCounters* next = nullptr;
+};
+
+struct TierRegistry {
+  std::mutex mutex;  // 保护以下全部成员
+  TierCounters* head = nullptr;
+  uint64_t retired[kCoverageTierCount] = {};
+  uint64_t baseline[kCoverageTierCount] = {};
+};
+
+// 永不析构，线程在静态析构阶段退出时仍可注销
+TierRegistry& Registry() {
+  static TierRegistry* registry = new TierRegistry;
+  return *registry;
+}
+
+TierCounters::TierCounters() {
+  TierRegistry& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  next = registry.head;
+  registry.head = this;
+}
+
+TierCounters::~TierCounters() {
+  TierRegistry& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (size_t i = 0; i < kCoverageTierCount; ++i) {
+    registry.retired[i] += calls[i].load(std::memory_order_relaxed);
+  }
+  for (TierCounters** link = &registry.head; *link != nullptr;
+       link = &(*link)->next) {
+    if (*link == this) {
+      *link = next;
+      break;
+    }
+  }
+}
+
+// 热路径只读一个平凡初始化的线程局部指针（无初始化检查）；
+// 首次计数时才构造并注册本线程的计数器。
+thread_local TierCounters* t_tier_counters = nullptr;
+
+TierCounters* RegisterTierCounters() noexcept {
+  thread_local TierCounters counters;
+  t_tier_counters = &counters;
+  return &counters;
+}
+
+void CountTier(CoverageTier tier) noexcept {
+  TierCounters* counters = t_tier_counters;
+  if (counters == nullptr) {
+    counters = RegisterTierCounters();
+  }
+  std::atomic<uint64_t>& calls = counters->calls[static_cast<size_t>(tier)];
+  calls.store(calls.load(std::memory_order_relaxed) + 1,
+              std::memory_order_relaxed);
+}
+
+// 调用方需持有 registry.mutex
+void SumTiers(const TierRegistry& registry, uint64_t* total) {
+  for (size_t i = 0; i < kCoverageTierCount; ++i) {
+    total[i] = registry.retired[i];
+  }
+  for (const TierCounters* c = registry.head; c != nullptr; c = c->next) {
+    for (size_t i = 0; i < kCoverageTierCount; ++i) {
+      total[i] += c->calls[i].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool IsFiniteQuad(const Quad& quad) noexcept {
+  for (const auto& pt : quad) {
+    if (!std::isfinite(pt.u) || !std::isfinite(pt.v)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+CoverageRoi::CoverageRoi(const Quad& roi) noexcept {
+  if (!IsFiniteQuad(roi)) {
+    return;
+  }
+  const double signed_area = ComputeSignedDoubleArea(roi);
+  area_ = std::fabs(signed_area) / 2.0;
+  if (area_ < kMinArea) {
+    return;
+  }
+  corners_ = roi;
+  inward_ = signed_area > 0.0;
+  for (size_t i = 0; i < roi.size(); ++i) {
+    const Point2D& a = roi[i];
+    const Point2D& b = roi[(i + 1) % roi.size()];
+    const double du = b.u - a.u;
+    const double dv = b.v - a.v;
+    // cross(b - a, p - a) = du * (p.v - a.v) - dv * (p.u - a.u)，
+    // 除以边长得到到边所在直线的有向距离；零长度边对所有点都为 0（内部）。
+    const double length = std::sqrt(du * du + dv * dv);
+    const double scale = length > 0.0 ? 1.0 / length : 0.0;
+    edges_[i].nu = -dv * scale;
+    edges_[i].nv = du * scale;
+    edges_[i].c = (dv * a.u - du * a.v) * scale;
+  }
+  min_u_ = std::min({roi[0].u, roi[1].u, roi[2].u, roi[3].u});
+  max_u_ = std::max({roi[0].u, roi[1].u, roi[2].u, roi[3].u});
+  min_v_ = std::min({roi[0].v, roi[1].v, roi[2].v, roi[3].v});
+  max_v_ = std::max({roi[0].v, roi[1].v, roi[2].v, roi[3].v});
+  valid_ = true;
+}
+
+double CoverageRoi::Coverage(const Quad& barcode) const noexcept {
+  if (!valid_ || !IsFiniteQuad(barcode)) {
+    CountTier(CoverageTier::kInvalid);
+    return 0.0;
+  }
+  const double barcode_signed_area = ComputeSignedDoubleArea(barcode);
+  const double area_barcode = std::fabs(barcode_signed_area) / 2.0;
+  if (area_barcode < kMinArea) {
+    CountTier(CoverageTier::kInvalid);
+    return 0.0;
+  }
+
+  // 包围盒不相交时交集必为空
+  const double min_u = std::min({barcode[0].u, barcode[1].u, barcode[2].u,
+                                 barcode[3].u});
+  const double max_u = std::max({barcode[0].u, barcode[1].u, barcode[2].u,
+                                 barcode[3].u});
+  const double min_v = std::min({barcode[0].v, barcode[1].v, barcode[2].v,
+                                 barcode[3].v});
+  const double max_v = std::max({barcode[0].v, barcode[1].v, barcode[2].v,
+                                 barcode[3].v});
+  if (max_u < min_u_ || min_u > max_u_ || max_v < min_v_ || min_v > max_v_) {
+    CountTier(CoverageTier::kBoundingBox);
+    return 0.0;
+  }
+
+  // 码区四个角点到 ROI 各边的有向距离：全部 >= 0 时裁剪不会改变码区，
+  // 覆盖率为 1；某条边使四个角点都 < 0 时裁剪结果为空。
+  // 用严格不等号：零长度边对所有点距离为 0，不能当作分离边。
+  bool contained = true;
+  for (const HalfPlane& h : edges_) {
+    bool separated = true;
+    for (const Point2D& p : barcode) {
+      const double dist = h.nu * p.u + h.nv * p.v + h.c;
+      contained = contained && dist >= 0.0;
+      separated = separated && dist < 0.0;
+    }
+    if (separated) {
+      CountTier(CoverageTier::kSeparated);
+      return 0.0;
+    }
+  }
+  if (contained) {
+    CountTier(CoverageTier::kContained);
+    return 1.0;
+  }
+
+  // 分离轴的另一半：两者都是凸四边形时，ROI 四个角点都严格在码区某条边的
+  // 外侧则交集为空。码区的内侧由其有向面积的符号决定。ROI 的凸性只在
+  // 这里用到，不在构造时计算，以免拖慢只构造一次就查询的 IsRoiInsideQuad。
+  if (inward_ && IsConvexQuad(barcode, barcode_signed_area) &&
+      IsConvexQuad(corners_, 1.0)) {
+    for (size_t i = 0; i < 4; ++i) {
+      const Point2D& a = barcode[i];
+      const Point2D& b = barcode[(i + 1) % 4];
+      bool separated = true;
+      for (const Point2D& p : corners_) {
+        const double cross =
+            (b.u - a.u) * (p.v - a.v) - (b.v - a.v) * (p.u - a.u);
+        separated = separated && cross * barcode_signed_area < 0.0;
+      }
+      if (separated) {
+        CountTier(CoverageTier::kSeparated);
+        return 0.0;
+      }
+    }
+  }
+  CountTier(CoverageTier::kClipped);
+
+  // Sutherland-Hodgman：依次用 ROI 的每个半平面裁剪码区，
+  // 交点按两端有向距离线性插值：t = d_prev / (d_prev - d_curr)。
+  // 两个栈上缓冲区交替使用，不分配堆内存。
+  ClipPolygon buffers[2] = {ClipPolygon(barcode), ClipPolygon()};
+  ClipPolygon* result = &buffers[0];
+  ClipPolygon* next = &buffers[1];
+  for (size_t i = 0; i < 4; ++i) {
+    const HalfPlane& h = edges_[i];
+    next->clear();
+    const Point2D* prev = &result->back();
+    double prev_dist = h.nu * prev->u + h.nv * prev->v + h.c;
+    for (const Point2D& curr : *result) {
+      const double curr_dist = h.nu * curr.u + h.nv * curr.v + h.c;
+      const bool prev_inside = prev_dist >= 0.0;
+      const bool curr_inside = curr_dist >= 0.0;
+      if (prev_inside != curr_inside) {
+        // 从外部进入或从内部出去，添加交点
+        const double t = prev_dist / (prev_dist - curr_dist);
+        next->push_back({prev->u + t * (curr.u - prev->u),
+                         prev->v + t * (curr.v - prev->v)});
+      }
+      if (curr_inside) {
+        next->push_back(curr);
+      }
+      prev = &curr;
+      prev_dist = curr_dist;
+    }
+    if (next->empty()) {
+      ROI_TRACE(kClipEmpty, static_cast<double>(i));
+      return 0.0;
+    }
+    std::swap(result, next);
+  }
+
+  const double intersection_area = ComputePolygonArea(*result);
+  ROI_TRACE(kIntersection, area_, area_barcode,
+            static_cast<double>(result->size()), intersection_area);
+  // 覆盖率定义：码区有多少在 ROI 里面 = 交集面积 / 码区面积
+  return std::min(1.0, intersection_area / area_barcode);
+}
+
+size_t ScoreBarcodes(const Quad& roi, const Quad* barcodes, size_t count,
+                     double threshold, double* coverage,
+                     bool* pass) noexcept {
+  const CoverageRoi prepared(roi);
+  size_t pass_count = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const double score = prepared.Coverage(barcodes[i]);
+    const bool ok = score > threshold;
+    ROI_TRACE(kCoverage, score, threshold, ok ? 1.0 : 0.0);
+    if (coverage != nullptr) {
+      coverage[i] = score;
+    }
+    if (pass != nullptr) {
+      pass[i] = ok;
+    }
+    pass_count += ok ? 1 : 0;
+  }
+  return pass_count;
+}
+
+void ComputePairCoverage(const Quad* rois, const Quad* barcodes, size_t count,
+                         double* coverage) noexcept {
+  using detail::QuadPairBlock;
+  const detail::CoverageBatchFn kernel = detail::ActiveCoverageBatch();
+  // 最后一组中超出 n 的通道读取的是 0 或上一块的旧数据，结果被丢弃。
+  QuadPairBlock block = {};
+  uint8_t fallback[QuadPairBlock::kSize];
+  for (size_t begin = 0; begin < count; begin += QuadPairBlock::kSize) {
+    const size_t n = std::min(QuadPairBlock::kSize, count - begin);
+    // AoS -> SoA 转置
+    for (size_t i = 0; i < n; ++i) {
+      const Quad& roi = rois[begin + i];
+      const Quad& barcode = barcodes[begin + i];
+      for (size_t k = 0; k < 4; ++k) {
+        block.roi_u[k][i] = roi[k].u;
+        block.roi_v[k][i] = roi[k].v;
+        block.bar_u[k][i] = barcode[k].u;
+        block.bar_v[k][i] = barcode[k].v;
+      }
+    }
+    kernel(block, n, coverage + begin, fallback);
+    for (size_t i = 0; i < n; ++i) {
+      if (fallback[i] != 0) {
+        coverage[begin + i] =
+            CoverageRoi(rois[begin + i]).Coverage(barcodes[begin + i]);
+      }
+    }
+  }
+}
+
+CoverageTierStats GetCoverageTierStats() noexcept {
+  TierRegistry& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  uint64_t total[kCoverageTierCount];
+  SumTiers(registry, total);
+  CoverageTierStats stats;
+  for (size_t i = 0; i < kCoverageTierCount; ++i) {
+    stats.calls[i] = total[i] - registry.baseline[i];
+  }
+  return stats;
+}
+
+void ResetCoverageTierStats() noexcept {
+  TierRegistry& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  SumTiers(registry, registry.baseline);
+}
+
+const char* CoverageTierName(CoverageTier tier) noexcept {
+  switch (tier) {
+    case CoverageTier::kInvalid:
+      return "invalid";
+    case CoverageTier::kBoundingBox:
+      return "bounding_box";
+    case CoverageTier::kContained:
+      return "contained";
+    case CoverageTier::kSeparated:
+      return "separated";
+    case CoverageTier::kClipped:
+      return "clipped";
+  }
+  return "unknown";
+}
+
+bool IsRoiInsideQuad(const Quad& quad, const Quad& barcode) noexcept {
+  const double coverage = CoverageRoi(quad).Coverage(barcode);
+  const bool inside = coverage > kDefaultCoverageThreshold;
+  ROI_TRACE(kCoverage, coverage, kDefaultCoverageThreshold,
+            inside ? 1.0 : 0.0);
+  return inside;
+}
+
+}  // namespace roi_projector
@@ -0,0 +1,94 @@
+// Coverage of barcode quads by a projected ROI quad.
+// Coverage is the fraction of a barcode's area that lies inside the ROI
+// (area(barcode ∩ roi) / area(barcode)), in [0, 1].
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "roi_projector.h"
+
+namespace roi_projector {
+
+using Quad = std::array<Point2D, 4>;
+
+// Threshold used by IsRoiInsideQuad: a barcode passes when its coverage is
+// strictly greater.
+constexpr double kDefaultCoverageThreshold = 0.8;
+
+// The check that decided a CoverageRoi::Coverage call, cheapest first.
+enum class CoverageTier : uint8_t {
+  kInvalid,      // non-finite or degenerate ROI or barcode: 0
+  kBoundingBox,  // bounding boxes disjoint: 0
+  kContained,    // every barcode corner inside every ROI edge: 1
+  kSeparated,    // an edge of either quad separates them: 0
+  kClipped,      // exact polygon clipping
+};
+constexpr size_t kCoverageTierCount = 5;
+
+// Calls per tier since the last ResetCoverageTierStats, summed over all
+// threads; index with static_cast<size_t>(CoverageTier).
+struct CoverageTierStats {
+  uint64_t calls[kCoverageTierCount] = {};
+};
+
+// Counting is a relaxed per-thread increment, so it stays on in production.
+// Reads are not synchronized with concurrent Coverage calls and may miss
+// the last few of them.
+CoverageTierStats GetCoverageTierStats() noexcept;
+void ResetCoverageTierStats() noexcept;
+const char* CoverageTierName(CoverageTier tier) noexcept;
+
+// ROI quad prepared for repeated coverage queries: its four clip half-planes
+// in signed-distance form and its bounding box are computed once.
+//
+// A point p is inside edge (a, b) when cross(b - a, p - a) >= 0, as in
+// IsRoiInsideQuad; an ROI wound the other way covers nothing. Non-finite or
+// degenerate (area < 1e-9) ROIs and barcodes score 0.
+//
+// Coverage only clips when the cheaper tiers of CoverageTier cannot decide;
+// the separating-edge test against barcode edges needs both quads convex.
+class CoverageRoi {
+ public:
+  explicit CoverageRoi(const Quad& roi) noexcept;
+
+  double Coverage(const Quad& barcode) const noexcept;
+
+  bool valid() const noexcept { return valid_; }
+
+ private:
+  // Signed distance to the edge line, positive inside: nu*u + nv*v + c.
+  struct HalfPlane {
+    double nu = 0.0;
+    double nv = 0.0;
+    double c = 0.0;
+  };
+
+  HalfPlane edges_[4];
+  Quad corners_{};
+  double area_ = 0.0;
+  double min_u_ = 0.0;
+  double min_v_ = 0.0;
+  double max_u_ = 0.0;
+  double max_v_ = 0.0;
+  bool valid_ = false;
+  bool inward_ = false;  // wound so its interior is inside every edge
+};
+
+// Scores `count` barcodes against one ROI. coverage[i] receives the
+// coverage of barcodes[i] and pass[i] whether it exceeds `threshold`;
+// either output may be null. Returns the number of barcodes that pass.
+size_t ScoreBarcodes(const Quad& roi, const Quad* barcodes, size_t count,
+                     double threshold, double* coverage,
+                     bool* pass) noexcept;
+
+// Scores `count` independent pairs: coverage[i] = coverage of barcodes[i] by
+// rois[i], as CoverageRoi(rois[i]).Coverage(barcodes[i]) to 1e-9 relative.
+// Convex pairs are clipped across SIMD lanes with the active KernelIsa;
+// pairs with a non-convex quad or a clockwise-wound ROI go through
+// CoverageRoi. Meant for bulk scoring such as replaying recorded frames.
+void ComputePairCoverage(const Quad* rois, const Quad* barcodes, size_t count,
+                         double* coverage) noexcept;
+
+}  // namespace roi_projector
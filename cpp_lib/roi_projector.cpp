@@ -1,248 +1,211 @@
 // Simple ROI projector library.
 #include "roi_projector.h"
 
-#include <cctype>
+#include <algorithm>
 #include <cmath>
-#include <cstdlib>
 #include <fstream>
-#include <iostream>
-#include <sstream>
+#include <limits>
+#include <string_view>
+#include <utility>
+
+#include "calibration_json.h"
+#include "projection_kernel.h"
 
 namespace roi_projector {
 
 namespace {
 
+// Whole file in one read into a string sized up front.
 std::string ReadAllText(const std::string& path) {
-  std::ifstream in(path, std::ios::in | std::ios::binary);
+  std::ifstream in(path, std::ios::in | std::ios::binary | std::ios::ate);
   if (!in) {
     return std::string();
   }
-  std::ostringstream ss;
-  ss << in.rdbuf();
-  return ss.str();
-}
-
-bool IsPointInConvexQuad(const std::array<roi_projector::Point2D, 4>& quad,
-                         const roi_projector::Point2D& p) {
-  constexpr double kEps = 1e-9;
-  int sign = 0;
-  for (size_t i = 0; i < quad.size(); ++i) {
-    const auto& a = quad[i];
-    const auto& b = quad[(i + 1) % quad.size()];
-    const double cross = (b.u - a.u) * (p.v - a.v) - (b.v - a.v) * (p.u - a.u);
-    if (std::fabs(cross) <= kEps) {
-      continue;
-    }
-    const int current_sign = (cross > 0.0) ? 1 : -1;
-    if (sign == 0) {
-      sign = current_sign;
-    } else if (sign != current_sign) {
-      return false;
-    }
+  const std::streamoff size = in.tellg();
+  if (size <= 0) {
+    return std::string();
+  }
+  std::string text(static_cast<size_t>(size), '\0');
+  in.seekg(0);
+  if (!in.read(&text[0], size)) {
+    return std::string();
   }
-  return sign != 0;
+  return text;
 }
 
-// 计算多边形面积（使用鞋带公式）
-double ComputePolygonArea(const std::vector<roi_projector::Point2D>& polygon) {
-  if (polygon.size() < 3) {
-    return 0.0;
+// The first R * C numbers of `key`, row-major. Extra numbers are ignored,
+// so distortion models with more than five coefficients keep the first
+// five.
+template <size_t R, size_t C>
+bool CopyMatrix(const CalibrationJson& json, std::string_view key,
+                std::array<std::array<double, C>, R>& out) {
+  const JsonNumbers numbers = json.Find(key);
+  if (numbers.count < R * C) {
+    return false;
   }
-  double area = 0.0;
-  for (size_t i = 0; i < polygon.size(); ++i) {
-    const size_t j = (i + 1) % polygon.size();
-    area += polygon[i].u * polygon[j].v;
-    area -= polygon[j].u * polygon[i].v;
+  for (size_t r = 0; r < R; ++r) {
+    for (size_t c = 0; c < C; ++c) {
+      out[r][c] = numbers.values[r * C + c];
+    }
   }
-  return std::fabs(area) / 2.0;
-}
-
-// 计算线段与半平面的交点
-roi_projector::Point2D ComputeLineIntersection(
-    const roi_projector::Point2D& p1, const roi_projector::Point2D& p2,
-    const roi_projector::Point2D& clip_p1, const roi_projector::Point2D& clip_p2) {
-  const double dx1 = p2.u - p1.u;
-  const double dy1 = p2.v - p1.v;
-  const double dx2 = clip_p2.u - clip_p1.u;
-  const double dy2 = clip_p2.v - clip_p1.v;
-  
-  const double denom = dx1 * dy2 - dy1 * dx2;
-  if (std::fabs(denom) < 1e-9) {
-    // 平行线，返回中点
-    return {(p1.u + p2.u) / 2.0, (p1.v + p2.v) / 2.0};
-  }
-  
-  const double t = ((p1.u - clip_p1.u) * dy2 - (p1.v - clip_p1.v) * dx2) / denom;
-  return {p1.u + t * dx1, p1.v + t * dy1};
-}
-
-// 判断点是否在半平面内（相对于裁剪边）
-bool IsPointInsideHalfPlane(const roi_projector::Point2D& p,
-                            const roi_projector::Point2D& clip_p1,
-                            const roi_projector::Point2D& clip_p2) {
-  const double cross = (clip_p2.u - clip_p1.u) * (p.v - clip_p1.v) -
-                       (clip_p2.v - clip_p1.v) * (p.u - clip_p1.u);
-  return cross >= 0.0;  // 顺时针方向，点在左侧或线上
+  return true;
 }
 
-// 使用 Sutherland-Hodgman 算法计算两个凸多边形的交集
-// 返回 poly1 在 poly2 内部的部分（即 poly1 ∩ poly2）
-std::vector<roi_projector::Point2D> ComputeConvexPolygonIntersection(
-    const std::array<roi_projector::Point2D, 4>& poly1,
-    const std::array<roi_projector::Point2D, 4>& poly2) {
-  std::vector<roi_projector::Point2D> result;
-  // 将 poly1 转换为 vector
-  for (const auto& pt : poly1) {
-    result.push_back(pt);
-  }
-  
-  // 使用 poly2 的每条边作为裁剪边来裁剪 poly1
-  for (size_t i = 0; i < poly2.size(); ++i) {
-    const auto& clip_p1 = poly2[i];
-    const auto& clip_p2 = poly2[(i + 1) % poly2.size()];
-    
-    std::vector<roi_projector::Point2D> new_result;
-    if (result.empty()) {
-      break;
-    }
-    
-    // 处理闭合循环：从最后一个点开始，遍历到第一个点
-    const roi_projector::Point2D* prev = &result.back();
-    bool prev_inside = IsPointInsideHalfPlane(*prev, clip_p1, clip_p2);
-    
-    for (size_t j = 0; j < result.size(); ++j) {
-      const auto& curr = result[j];
-      bool curr_inside = IsPointInsideHalfPlane(curr, clip_p1, clip_p2);
-      
-      if (curr_inside) {
-        if (!prev_inside) {
-          // 从外部进入，添加交点
-          roi_projector::Point2D intersection = ComputeLineIntersection(*prev, curr, clip_p1, clip_p2);
-          new_result.push_back(intersection);
-        }
-        new_result.push_back(curr);
-      } else if (prev_inside) {
-        // 从内部出去，添加交点
-        roi_projector::Point2D intersection = ComputeLineIntersection(*prev, curr, clip_p1, clip_p2);
-        new_result.push_back(intersection);
-      }
-      
-      prev = &curr;
-      prev_inside = curr_inside;
-    }
-    
-    // 如果结果为空，说明没有交集
-    if (new_result.empty()) {
-      std::cout << "[IOU Debug] Clip edge " << i << " resulted in empty intersection" << std::endl << std::flush;
-      return std::vector<roi_projector::Point2D>();
-    }
-    
-    result = std::move(new_result);
+// Distortion is optional: a missing or short array means none.
+std::array<double, 5> Distortion5(const CalibrationJson& json,
+                                  std::string_view key) {
+  std::array<std::array<double, 5>, 1> dist{};
+  if (!CopyMatrix(json, key, dist)) {
+    dist[0].fill(0.0);
   }
-  
-  return result;
+  return dist[0];
 }
 
-// 计算两个四边形的 IOU（内部实现）
-double ComputeIOUImpl(const std::array<roi_projector::Point2D, 4>& quad,
-                      const std::array<roi_projector::Point2D, 4>& barcode) {
-  // 检查点是否有效
-  for (const auto& pt : quad) {
-    if (!std::isfinite(pt.u) || !std::isfinite(pt.v)) {
-      return 0.0;
-    }
-  }
-  for (const auto& pt : barcode) {
-    if (!std::isfinite(pt.u) || !std::isfinite(pt.v)) {
-      return 0.0;
+// Index of the sample to report when `count` samples, `samples` per edge,
+// did not all project: the first failing corner, since a bad corner also
+// spoils the samples interpolated towards it, else the first failure.
+size_t FirstFailedSample(const ProjectStatus* status, size_t count,
+                         size_t samples) noexcept {
+  size_t failed = count;
+  for (size_t i = 0; i < count; ++i) {
+    if (status[i] != ProjectStatus::kOk &&
+        (failed == count || (i % samples == 0 && failed % samples != 0))) {
+      failed = i;
     }
   }
-  
-  // 计算两个四边形的面积
-  std::vector<roi_projector::Point2D> quad_vec(quad.begin(), quad.end());
-  std::vector<roi_projector::Point2D> barcode_vec(barcode.begin(), barcode.end());
-  
-  const double area_quad = ComputePolygonArea(quad_vec);
-  const double area_barcode = ComputePolygonArea(barcode_vec);
-  
-  if (area_quad < 1e-9 || area_barcode < 1e-9) {
-    return 0.0;
-  }
-  
-  // 计算交集面积
-  // ComputeConvexPolygonIntersection(subject, clip) 返回 subject 在 clip 内部的部分
-  // 所以 ComputeConvexPolygonIntersection(barcode, quad) 返回 barcode 在 quad 内的部分
-  // 这就是我们需要的交集：barcode ∩ quad
-  const auto intersection = ComputeConvexPolygonIntersection(barcode, quad);
-  
-  // 调试输出 - 使用cout并立即刷新
-  std::cout << "[IOU Debug] area_quad=" << area_quad << ", area_barcode=" << area_barcode 
-            << ", intersection_size=" << intersection.size();
-  if (intersection.size() > 0) {
-    std::cout << ", first_point=(" << intersection[0].u << "," << intersection[0].v << ")";
-  }
-  std::cout << std::endl << std::flush;
-  
-  const double intersection_area = ComputePolygonArea(intersection);
-  
-  // IOU定义：码区有多少在ROI里面 = 交集面积 / barcode面积
-  if (area_barcode < 1e-9) {
-    return 0.0;
-  }
-  
-  return intersection_area / area_barcode;
+  return failed;
 }
 
 }  // namespace
 
-bool IsRoiInsideQuad(const std::array<Point2D, 4>& quad, const std::array<Point2D, 4>& barcode) {
-  constexpr double kIOUThreshold = 0.8;
-  const double iou = ComputeIOUImpl(quad, barcode);
-  // 调试输出：打印IOU值 - 使用cout并立即刷新
-  std::cout << "[IOU Debug] IOU: " << iou << std::endl << std::flush;
-  return iou > kIOUThreshold;
+bool Projector::LoadCalibration(const std::string& file_path) {
+  return LoadCalibration(file_path, UndistortLutOptions());
 }
 
-bool Projector::LoadCalibration(const std::string& file_path) {
-  const std::string json = ReadAllText(file_path);
-  if (json.empty()) {
+bool Projector::LoadCalibration(const std::string& file_path,
+                                const UndistortLutOptions& lut_options) {
+  const std::string text = ReadAllText(file_path);
+  CalibrationJson json;
+  if (!json.Parse(text)) {
     return false;
   }
 
-  if (!ParseMatrix4x4(json, "extrinsic_matrix", extrinsic_)) {
+  // Nothing is replaced unless every required matrix is present.
+  std::array<std::array<double, 4>, 4> extrinsic;
+  std::array<std::array<double, 3>, 3> camera1;
+  std::array<std::array<double, 3>, 3> camera2;
+  if (!CopyMatrix(json, "extrinsic_matrix", extrinsic) ||
+      !CopyMatrix(json, "camera1_matrix", camera1) ||
+      !CopyMatrix(json, "camera2_matrix", camera2)) {
     return false;
   }
-  if (!ParseMatrix3x3(json, "camera1_matrix", camera1_)) {
-    return false;
+  extrinsic_ = extrinsic;
+  camera1_ = camera1;
+  camera2_ = camera2;
+  dist1_ = Distortion5(json, "camera1_distortion");
+  dist2_ = Distortion5(json, "camera2_distortion");
+  lut_options_ = lut_options;
+  lut1_.reset();
+  if (undistort_mode_ == UndistortMode::kFast) {
+    LoadUndistortLut(lut_options.build_in_background);
   }
-  if (!ParseMatrix3x3(json, "camera2_matrix", camera2_)) {
-    return false;
-  }
-  ParseDistortion5(json, "camera1_distortion", dist1_);
-  ParseDistortion5(json, "camera2_distortion", dist2_);
+  CompileCalibration();
 
   has_calibration_ = true;
   return true;
 }
 
+const char* ProjectStatusName(ProjectStatus status) noexcept {
+  switch (status) {
+    case ProjectStatus::kOk:
+      return "ok";
+    case ProjectStatus::kNotCalibrated:
+      return "calibration not loaded";
+    case ProjectStatus::kInvalidDepth:
+      return "invalid depth";
+    case ProjectStatus::kProjectionFailed:
+      return "projection failed";
+    case ProjectStatus::kUndistortDiverged:
+      return "undistortion diverged";
+  }
+  return "unknown status";
+}
+
+std::string FormatCornersMessage(const CornersResult& result) {
+  std::string message = ProjectStatusName(result.status);
+  if (result.failed_corner >= 0) {
+    message += " at corner " + std::to_string(result.failed_corner);
+  }
+  return message;
+}
+
+size_t ComputeConvexHull(Point2D* points, size_t count) noexcept {
+  if (count < 3) {
+    return count;
+  }
+  // Andrew 单调链，就地完成：按 (u, v) 字典序排序（比较总是一致的，
+  // 近似共线的点也不会破坏排序），中间点按在最左点 L 与最右点 R 连线的
+  // 下方 / 上方 / 线上分组，线上的点不可能是顶点，直接丢弃；
+  // 排成 [L, 下方升序, R, 上方降序] 后做一遍栈扫描，栈存放在数组前部。
+  auto lex_less = [](const Point2D& a, const Point2D& b) {
+    return a.u < b.u || (a.u == b.u && a.v < b.v);
+  };
+  auto cross = [](const Point2D& o, const Point2D& a, const Point2D& b) {
+    return (a.u - o.u) * (b.v - o.v) - (a.v - o.v) * (b.u - o.u);
+  };
+  std::sort(points, points + count, lex_less);
+  const Point2D left = points[0];
+  const Point2D right = points[count - 1];
+  if (left.u == right.u && left.v == right.v) {
+    return 1;
+  }
+  Point2D* const mid_begin = points + 1;
+  Point2D* const mid_end = points + count - 1;
+  Point2D* const below_end =
+      std::partition(mid_begin, mid_end, [&](const Point2D& p) {
+        return cross(left, right, p) < 0.0;
+      });
+  Point2D* const above_end =
+      std::partition(below_end, mid_end, [&](const Point2D& p) {
+        return cross(left, right, p) > 0.0;
+      });
+  std::sort(mid_begin, below_end, lex_less);
+  std::sort(below_end, above_end,
+            [&](const Point2D& a, const Point2D& b) { return lex_less(b, a); });
+  std::move_backward(below_end, above_end, above_end + 1);
+  *below_end = right;
+  const size_t n = static_cast<size_t>(above_end + 1 - points);
+
+  // 逆时针（v 轴向上）扫描，弹出不构成严格左转的点
+  size_t top = 1;
+  for (size_t i = 1; i < n; ++i) {
+    while (top >= 2 &&
+           cross(points[top - 2], points[top - 1], points[i]) <= 0.0) {
+      --top;
+    }
+    points[top++] = points[i];
+  }
+  while (top >= 3 && cross(points[top - 2], points[top - 1], left) <= 0.0) {
+    --top;
+  }
+  return top;
+}
+
 CornersResult Projector::ProjectCorners(
-    const std::array<Point3D, 4>& corners) const {
+    const std::array<Point3D, 4>& corners) const noexcept {
   CornersResult result;
   if (!has_calibration_) {
-    result.message = "calibration not loaded";
     return result;
   }
 
   for (size_t i = 0; i < corners.size(); ++i) {
     const Point3D& pt = corners[i];
-    if (pt.z <= 0.0 || !std::isfinite(pt.z)) {
-      result.message = "invalid depth at corner " + std::to_string(i);
-      return result;
-    }
     double out_u = 0.0;
     double out_v = 0.0;
-    if (!TransformPoint(pt.u, pt.v, pt.z, out_u, out_v)) {
-      result.message = "projection failed at corner " + std::to_string(i);
+    const ProjectStatus st = TransformPoint(pt.u, pt.v, pt.z, out_u, out_v);
+    if (st != ProjectStatus::kOk) {
+      result.status = st;
+      result.failed_corner = static_cast<int>(i);
       return result;
     }
     result.points[i].u = out_u;
@@ -250,180 +213,324 @@ CornersResult Projector::ProjectCorners(
   }
 
   result.ok = true;
-  result.message = "ok";
+  result.status = ProjectStatus::kOk;
   return result;
 }
 
-bool Projector::TransformPoint(double u, double v, double depth,
-                               double& out_u, double& out_v) const {
-  const double fx1 = camera1_[0][0];
-  const double fy1 = camera1_[1][1];
-  const double cx1 = camera1_[0][2];
-  const double cy1 = camera1_[1][2];
-
-  double x_norm = (u - cx1) / fx1;
-  double y_norm = (v - cy1) / fy1;
-  if (HasDistortion(dist1_)) {
-    double xu = 0.0;
-    double yu = 0.0;
-    UndistortNormalized(x_norm, y_norm, dist1_, xu, yu);
-    x_norm = xu;
-    y_norm = yu;
-  }
-
-  const double x = x_norm * depth;
-  const double y = y_norm * depth;
-  const double z = depth;
-
-  const double x2 = extrinsic_[0][0] * x + extrinsic_[0][1] * y +
-                    extrinsic_[0][2] * z + extrinsic_[0][3];
-  const double y2 = extrinsic_[1][0] * x + extrinsic_[1][1] * y +
-                    extrinsic_[1][2] * z + extrinsic_[1][3];
-  const double z2 = extrinsic_[2][0] * x + extrinsic_[2][1] * y +
-                    extrinsic_[2][2] * z + extrinsic_[2][3];
-
-  if (z2 <= 0.0 || !std::isfinite(z2)) {
-    return false;
+DenseRoiResult Projector::ProjectDenseRoi(
+    const std::array<Point3D, 4>& corners, const DenseRoiOptions& options,
+    Point2D* out, size_t capacity) const noexcept {
+  DenseRoiResult result;
+  if (!has_calibration_) {
+    return result;
+  }
+  const size_t samples = std::min(
+      {static_cast<size_t>(std::max(options.samples_per_edge, 1)),
+       static_cast<size_t>(kMaxDenseSamplesPerEdge), capacity / 4});
+  if (out == nullptr || samples == 0) {
+    result.status = ProjectStatus::kProjectionFailed;
+    return result;
   }
 
-  const double fx2 = camera2_[0][0];
-  const double fy2 = camera2_[1][1];
-  const double cx2 = camera2_[0][2];
-  const double cy2 = camera2_[1][2];
-
-  double x2_norm = x2 / z2;
-  double y2_norm = y2 / z2;
-  if (HasDistortion(dist2_)) {
-    double xd = 0.0;
-    double yd = 0.0;
-    DistortNormalized(x2_norm, y2_norm, dist2_, xd, yd);
-    x2_norm = xd;
-    y2_norm = yd;
+  // Samples go straight into struct-of-arrays stack buffers for the kernel.
+  constexpr size_t kMaxPoints = 4 * kMaxDenseSamplesPerEdge;
+  double u[kMaxPoints];
+  double v[kMaxPoints];
+  double z[kMaxPoints];
+  double out_u[kMaxPoints];
+  double out_v[kMaxPoints];
+  ProjectStatus status[kMaxPoints];
+  const size_t count = 4 * samples;
+  for (size_t edge = 0; edge < 4; ++edge) {
+    const Point3D& a = corners[edge];
+    const Point3D& b = corners[(edge + 1) % 4];
+    // 1/z is affine along the image of a plane. Invalid corner depths are
+    // left to the kernel, which reports them at the corner sample.
+    const double inv_za = 1.0 / a.z;
+    const double inv_zb = 1.0 / b.z;
+    for (size_t step = 0; step < samples; ++step) {
+      const size_t i = edge * samples + step;
+      if (step == 0) {
+        u[i] = a.u;
+        v[i] = a.v;
+        z[i] = a.z;
+        continue;
+      }
+      const double t = static_cast<double>(step) / static_cast<double>(samples);
+      u[i] = a.u + t * (b.u - a.u);
+      v[i] = a.v + t * (b.v - a.v);
+      z[i] = 1.0 / (inv_za + t * (inv_zb - inv_za));
+    }
   }
 
-  out_u = fx2 * x2_norm + cx2;
-  out_v = fy2 * y2_norm + cy2;
-  return std::isfinite(out_u) && std::isfinite(out_v);
+  const size_t ok_count = ProjectPoints(u, v, z, count, out_u, out_v, status);
+  if (ok_count != count) {
+    const size_t failed = FirstFailedSample(status, count, samples);
+    result.status = status[failed];
+    result.failed_sample = static_cast<int>(failed);
+    return result;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    out[i].u = out_u[i];
+    out[i].v = out_v[i];
+  }
+  result.count =
+      options.convex_hull ? ComputeConvexHull(out, count) : count;
+  result.ok = true;
+  result.status = ProjectStatus::kOk;
+  return result;
 }
 
-bool Projector::FindKeyArrayStart(const std::string& json,
-                                  const std::string& key,
-                                  size_t& start_pos) const {
-  const std::string quoted = "\"" + key + "\"";
-  const size_t key_pos = json.find(quoted);
-  if (key_pos == std::string::npos) {
-    return false;
+DenseRoiResult Projector::ProjectRoiEnvelope(
+    const std::array<Point2D, 4>& corners_uv, double z_min, double z_max,
+    const RoiEnvelopeOptions& options, Point2D* out,
+    size_t capacity) const noexcept {
+  DenseRoiResult result;
+  if (!has_calibration_) {
+    return result;
   }
-  const size_t array_pos = json.find('[', key_pos);
-  if (array_pos == std::string::npos) {
-    return false;
+  const size_t levels = static_cast<size_t>(std::min(
+      std::max(options.depth_samples, 2), kMaxEnvelopeDepthSamples));
+  const size_t samples = std::min(
+      {static_cast<size_t>(std::max(options.samples_per_edge, 1)),
+       static_cast<size_t>(kMaxDenseSamplesPerEdge), capacity / (4 * levels)});
+  if (out == nullptr || samples == 0) {
+    result.status = ProjectStatus::kProjectionFailed;
+    return result;
   }
-  start_pos = array_pos;
-  return true;
+  if (z_min > z_max) {
+    std::swap(z_min, z_max);
+  }
+
+  // The ROI outline is the same at every depth; each level is one batch.
+  constexpr size_t kMaxPoints = 4 * kMaxDenseSamplesPerEdge;
+  double u[kMaxPoints];
+  double v[kMaxPoints];
+  double z[kMaxPoints];
+  double out_u[kMaxPoints];
+  double out_v[kMaxPoints];
+  ProjectStatus status[kMaxPoints];
+  const size_t per_level = 4 * samples;
+  for (size_t edge = 0; edge < 4; ++edge) {
+    const Point2D& a = corners_uv[edge];
+    const Point2D& b = corners_uv[(edge + 1) % 4];
+    for (size_t step = 0; step < samples; ++step) {
+      const double t = static_cast<double>(step) / static_cast<double>(samples);
+      u[edge * samples + step] = step == 0 ? a.u : a.u + t * (b.u - a.u);
+      v[edge * samples + step] = step == 0 ? a.v : a.v + t * (b.v - a.v);
+    }
+  }
+  // Image motion along the epipolar line is affine in 1/z, so the levels
+  // are spaced evenly there; the end levels are exactly z_min and z_max.
+  const double inv_min = 1.0 / z_min;
+  const double inv_max = 1.0 / z_max;
+  for (size_t level = 0; level < levels; ++level) {
+    const double t =
+        static_cast<double>(level) / static_cast<double>(levels - 1);
+    double depth = 1.0 / (inv_min + t * (inv_max - inv_min));
+    if (level == 0) {
+      depth = z_min;
+    } else if (level + 1 == levels) {
+      depth = z_max;
+    }
+    std::fill(z, z + per_level, depth);
+    const size_t ok_count =
+        ProjectPoints(u, v, z, per_level, out_u, out_v, status);
+    if (ok_count != per_level) {
+      const size_t failed = FirstFailedSample(status, per_level, samples);
+      result.status = status[failed];
+      result.failed_sample = static_cast<int>(level * per_level + failed);
+      return result;
+    }
+    Point2D* level_out = out + level * per_level;
+    for (size_t i = 0; i < per_level; ++i) {
+      level_out[i].u = out_u[i];
+      level_out[i].v = out_v[i];
+    }
+  }
+  result.count = ComputeConvexHull(out, levels * per_level);
+  result.ok = true;
+  result.status = ProjectStatus::kOk;
+  return result;
 }
 
-bool Projector::ParseNumberArray(const std::string& json, size_t start_pos,
-                                 size_t expected_count,
-                                 std::vector<double>& out) const {
-  out.clear();
-  if (start_pos >= json.size() || json[start_pos] != '[') {
-    return false;
+size_t Projector::ProjectPoints(const Point3D* points, size_t count,
+                                Point2D* out, ProjectStatus* status,
+                                uint8_t* iterations) const noexcept {
+  // Deinterleave through small stack blocks so the SoA kernel does the work.
+  constexpr size_t kBlock = 64;
+  double u[kBlock];
+  double v[kBlock];
+  double z[kBlock];
+  double out_u[kBlock];
+  double out_v[kBlock];
+  size_t ok_count = 0;
+  for (size_t base = 0; base < count; base += kBlock) {
+    const size_t n = std::min(kBlock, count - base);
+    for (size_t i = 0; i < n; ++i) {
+      u[i] = points[base + i].u;
+      v[i] = points[base + i].v;
+      z[i] = points[base + i].z;
+    }
+    ok_count += ProjectPoints(
+        u, v, z, n, out_u, out_v, status != nullptr ? status + base : nullptr,
+        iterations != nullptr ? iterations + base : nullptr);
+    for (size_t i = 0; i < n; ++i) {
+      out[base + i].u = out_u[i];
+      out[base + i].v = out_v[i];
+    }
   }
+  return ok_count;
+}
 
-  size_t i = start_pos;
-  int depth = 0;
-  while (i < json.size()) {
-    const char c = json[i];
-    if (c == '[') {
-      depth++;
-      i++;
-      continue;
-    }
-    if (c == ']') {
-      depth--;
-      i++;
-      if (depth == 0) {
-        break;
+size_t Projector::ProjectPoints(const double* u, const double* v,
+                                const double* z, size_t count, double* out_u,
+                                double* out_v, ProjectStatus* status,
+                                uint8_t* iterations) const noexcept {
+  if (!has_calibration_) {
+    for (size_t i = 0; i < count; ++i) {
+      const ProjectStatus st = ProjectOne(u[i], v[i], z[i], out_u[i], out_v[i]);
+      if (status != nullptr) {
+        status[i] = st;
       }
-      continue;
-    }
-    if (c == '-' || c == '+' || std::isdigit(static_cast<unsigned char>(c)) ||
-        c == '.') {
-      char* end_ptr = nullptr;
-      const double value = std::strtod(json.c_str() + i, &end_ptr);
-      if (end_ptr == json.c_str() + i) {
-        return false;
+      if (iterations != nullptr) {
+        iterations[i] = 0;
       }
-      out.push_back(value);
-      i = static_cast<size_t>(end_ptr - json.c_str());
-      continue;
     }
-    i++;
+    return 0;
   }
+  return detail::ActiveProjectBatch()(compiled_, u, v, z, count, out_u, out_v,
+                                      status, iterations);
+}
 
-  if (out.size() < expected_count) {
-    return false;
+ProjectStatus Projector::ProjectOne(double u, double v, double depth,
+                                    double& out_u,
+                                    double& out_v) const noexcept {
+  ProjectStatus st = ProjectStatus::kOk;
+  if (!has_calibration_) {
+    st = ProjectStatus::kNotCalibrated;
+  } else {
+    st = TransformPoint(u, v, depth, out_u, out_v);
   }
-  if (out.size() > expected_count) {
-    out.resize(expected_count);
+  if (st != ProjectStatus::kOk) {
+    out_u = std::numeric_limits<double>::quiet_NaN();
+    out_v = std::numeric_limits<double>::quiet_NaN();
   }
-  return true;
+  return st;
 }
 
-bool Projector::ParseMatrix4x4(
-    const std::string& json, const std::string& key,
-    std::array<std::array<double, 4>, 4>& out) const {
-  size_t start_pos = 0;
-  if (!FindKeyArrayStart(json, key, start_pos)) {
-    return false;
-  }
-  std::vector<double> values;
-  if (!ParseNumberArray(json, start_pos, 16, values)) {
-    return false;
-  }
-  for (size_t r = 0; r < 4; ++r) {
-    for (size_t c = 0; c < 4; ++c) {
-      out[r][c] = values[r * 4 + c];
-    }
-  }
-  return true;
+ProjectStatus Projector::TransformPoint(double u, double v, double depth,
+                                        double& out_u,
+                                        double& out_v) const noexcept {
+  detail::ScalarF64 ou{0.0};
+  detail::ScalarF64 ov{0.0};
+  detail::LaneStatus<detail::ScalarF64> lane_status;
+  detail::ProjectLanes(compiled_, detail::ScalarF64{u}, detail::ScalarF64{v},
+                       detail::ScalarF64{depth}, ou, ov, lane_status, nullptr);
+  out_u = ou.v;
+  out_v = ov.v;
+  return detail::LaneProjectStatus<detail::ScalarF64>(
+      lane_status.ok, lane_status.depth_ok, lane_status.undistort_ok, 0);
 }
 
-bool Projector::ParseMatrix3x3(
-    const std::string& json, const std::string& key,
-    std::array<std::array<double, 3>, 3>& out) const {
-  size_t start_pos = 0;
-  if (!FindKeyArrayStart(json, key, start_pos)) {
-    return false;
+namespace {
+
+struct UndistortSolverSettings {
+  int max_iterations;
+  double tolerance;  // on |D(x) - xd|, normalized camera1 units
+};
+
+UndistortSolverSettings SolverSettingsFor(UndistortMode mode) {
+  switch (mode) {
+    case UndistortMode::kFast:
+      return {4, 1e-6};
+    case UndistortMode::kBalanced:
+      return {8, 1e-10};
+    case UndistortMode::kExact:
+      return {20, 1e-14};
+  }
+  return {8, 1e-10};
+}
+
+}  // namespace
+
+void Projector::RebuildUndistortLut(const UndistortLutOptions& lut_options) {
+  lut_options_ = lut_options;
+  if (!has_calibration_) {
+    return;
   }
-  std::vector<double> values;
-  if (!ParseNumberArray(json, start_pos, 9, values)) {
-    return false;
+  lut1_.reset();
+  if (undistort_mode_ == UndistortMode::kFast) {
+    LoadUndistortLut(false);
   }
-  for (size_t r = 0; r < 3; ++r) {
-    for (size_t c = 0; c < 3; ++c) {
-      out[r][c] = values[r * 3 + c];
-    }
+  SelectUndistortLut();
+}
+
+void Projector::SetUndistortMode(UndistortMode mode) {
+  undistort_mode_ = mode;
+  // Only kFast can use the table, so it is built on the way into kFast
+  // rather than by every load.
+  if (mode == UndistortMode::kFast && has_calibration_ && lut1_ == nullptr) {
+    LoadUndistortLut(false);
   }
-  return true;
+  SelectUndistortLut();
 }
 
-bool Projector::ParseDistortion5(
-    const std::string& json, const std::string& key,
-    std::array<double, 5>& out) const {
-  out.fill(0.0);
-  size_t start_pos = 0;
-  if (!FindKeyArrayStart(json, key, start_pos)) {
-    return false;
+void Projector::LoadUndistortLut(bool cached_only) {
+  if (!HasDistortion(dist1_)) {
+    return;
+  }
+  lut1_ = cached_only
+              ? LoadCachedUndistortLut(camera1_[0][0], camera1_[1][1],
+                                       camera1_[0][2], camera1_[1][2],
+                                       dist1_.data(), lut_options_)
+              : LoadOrBuildUndistortLut(camera1_[0][0], camera1_[1][1],
+                                        camera1_[0][2], camera1_[1][2],
+                                        dist1_.data(), lut_options_);
+}
+
+void Projector::SelectUndistortLut() {
+  const UndistortSolverSettings settings =
+      SolverSettingsFor(undistort_mode_);
+  compiled_.undistort_max_iterations = settings.max_iterations;
+  compiled_.undistort_tolerance = settings.tolerance;
+  // The table stands in for the solve only where its measured residual
+  // meets the mode's tolerance; kExact always solves, so it gives the
+  // same positions with or without a table.
+  const UndistortLut* lut = lut1_.get();
+  const bool usable = lut != nullptr &&
+                      undistort_mode_ != UndistortMode::kExact &&
+                      lut->max_residual < settings.tolerance;
+  compiled_.lut1 = usable ? lut : nullptr;
+}
+
+void Projector::CompileCalibration() {
+  CompiledCalibration& p = compiled_;
+  p.inv_fx1 = 1.0 / camera1_[0][0];
+  p.inv_fy1 = 1.0 / camera1_[1][1];
+  p.cx1 = camera1_[0][2];
+  p.cy1 = camera1_[1][2];
+  for (size_t r = 0; r < 3; ++r) {
+    for (size_t c = 0; c < 4; ++c) {
+      p.rt[r][c] = extrinsic_[r][c];
+    }
   }
-  std::vector<double> values;
-  if (!ParseNumberArray(json, start_pos, 5, values)) {
-    return false;
+  p.fx2 = camera2_[0][0];
+  p.fy2 = camera2_[1][1];
+  p.cx2 = camera2_[0][2];
+  p.cy2 = camera2_[1][2];
+  for (size_t c = 0; c < 4; ++c) {
+    p.k2rt[0][c] = p.fx2 * p.rt[0][c] + p.cx2 * p.rt[2][c];
+    p.k2rt[1][c] = p.fy2 * p.rt[1][c] + p.cy2 * p.rt[2][c];
+    p.k2rt[2][c] = p.rt[2][c];
   }
   for (size_t i = 0; i < 5; ++i) {
-    out[i] = values[i];
+    p.dist1[i] = dist1_[i];
+    p.dist2[i] = dist2_[i];
   }
-  return true;
+  p.has_dist1 = HasDistortion(dist1_);
+  p.has_dist2 = HasDistortion(dist2_);
+  SelectUndistortLut();
 }
 
 bool Projector::HasDistortion(const std::array<double, 5>& dist) const {
@@ -435,45 +542,4 @@ bool Projector::HasDistortion(const std::array<double, 5>& dist) const {
   return false;
 }
 
-void Projector::UndistortNormalized(double xd, double yd,
-                                    const std::array<double, 5>& dist,
-                                    double& xu, double& yu) const {
-  const double k1 = dist[0];
-  const double k2 = dist[1];
-  const double p1 = dist[2];
-  const double p2 = dist[3];
-  const double k3 = dist[4];
-
-  double x = xd;
-  double y = yd;
-  for (int i = 0; i < 5; ++i) {
-    const double r2 = x * x + y * y;
-    const double radial = 1.0 + k1 * r2 + k2 * r2 * r2 + k3 * r2 * r2 * r2;
-    const double x_t = 2.0 * p1 * x * y + p2 * (r2 + 2.0 * x * x);
-    const double y_t = p1 * (r2 + 2.0 * y * y) + 2.0 * p2 * x * y;
-    x = (xd - x_t) / radial;
-    y = (yd - y_t) / radial;
-  }
-  xu = x;
-  yu = y;
-}
-
-void Projector::DistortNormalized(double x, double y,
-                                  const std::array<double, 5>& dist,
-                                  double& xd, double& yd) const {
-  const double k1 = dist[0];
-  const double k2 = dist[1];
-  const double p1 = dist[2];
-  const double p2 = dist[3];
-  const double k3 = dist[4];
-
-  const double r2 = x * x + y * y;
-  const double radial = 1.0 + k1 * r2 + k2 * r2 * r2 + k3 * r2 * r2 * r2;
-  const double x_t = 2.0 * p1 * x * y + p2 * (r2 + 2.0 * x * x);
-  const double y_t = p1 * (r2 + 2.0 * y * y) + 2.0 * p2 * x * y;
-
-  xd = x * radial + x_t;
-  yd = y * radial + y_t;
-}
-
 }  // namespace roi_projector
@@ -3,9 +3,14 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "undistort_lut.h"
+
 namespace roi_projector {
 
 struct Point2D {
@@ -26,18 +31,222 @@ struct Rect {
   double h = 0.0;
 };
 
+// Per-point result written by the batch projection API.
+enum class ProjectStatus : uint8_t {
+  kOk = 0,
+  kNotCalibrated,
+  kInvalidDepth,
+  kProjectionFailed,
+  kUndistortDiverged,  // camera1 undistortion did not converge
+};
+
+// Short English description, e.g. "invalid depth". Never null.
+const char* ProjectStatusName(ProjectStatus status) noexcept;
+
+// Accuracy/latency trade-off of the camera1 undistortion solve (Newton with
+// early exit). Points that miss the tolerance within the step cap are
+// reported as kUndistortDiverged instead of returning a wrong position.
+// A camera1 undistortion table replaces the solve (0 steps) only in a mode
+// whose tolerance its measured residual meets (UndistortLut::max_residual):
+// in practice kFast, since a float table cannot reach 1e-10. It is
+// therefore built (or mapped from the cache) only in kFast: by loading in
+// kFast or by switching to it. kBalanced and kExact solve every point and
+// never build a table; kExact never uses one.
+enum class UndistortMode {
+  kFast,      // <= 4 steps, residual < 1e-6 (~0.002 px)
+  kBalanced,  // <= 8 steps, residual < 1e-10 (default)
+  kExact,     // <= 20 steps, residual < 1e-14
+};
+
+// Result of Projector::ProjectCorners; trivially copyable, so returning it
+// never allocates.
 struct CornersResult {
   bool ok = false;
   std::array<Point2D, 4> points{};
-  std::string message;
+  ProjectStatus status = ProjectStatus::kNotCalibrated;
+  int failed_corner = -1;  // index of the first failing corner, or -1
+};
+
+// Human-readable form of `result`, e.g. "invalid depth at corner 2" or "ok".
+// Allocates; intended for logs and error paths only.
+std::string FormatCornersMessage(const CornersResult& result);
+
+// Upper bound on DenseRoiOptions::samples_per_edge.
+constexpr int kMaxDenseSamplesPerEdge = 64;
+
+// Edge densification for Projector::ProjectDenseRoi. Under camera2
+// distortion straight ROI edges project to curves, which the four projected
+// corners alone cut short.
+struct DenseRoiOptions {
+  // Points per edge, starting at the edge's first corner; 1 gives the four
+  // corners of ProjectCorners. Clamped to [1, kMaxDenseSamplesPerEdge].
+  int samples_per_edge = 16;
+  // Return the convex hull of the projected samples instead of the dense
+  // polygon itself.
+  bool convex_hull = false;
+};
+
+// Result of Projector::ProjectDenseRoi and ProjectRoiEnvelope; the points
+// go to a caller buffer.
+struct DenseRoiResult {
+  bool ok = false;
+  size_t count = 0;  // points written
+  ProjectStatus status = ProjectStatus::kNotCalibrated;
+  // Failing sample, edge * samples_per_edge + step, or -1: the first
+  // failing corner (step 0) if any, else the first failing sample.
+  // ProjectRoiEnvelope adds level * 4 * samples_per_edge for the first
+  // depth level that fails.
+  int failed_sample = -1;
 };
 
-bool IsRoiInsideQuad(const std::array<Point2D, 4>& quad, const std::array<Point2D, 4>& barcode);
+// Upper bound on RoiEnvelopeOptions::depth_samples.
+constexpr int kMaxEnvelopeDepthSamples = 16;
 
+// Sampling for Projector::ProjectRoiEnvelope. Without lens distortion the
+// ROI's depth slab is a truncated pyramid whose image is the hull of its
+// eight corners; the extra samples follow the curves distortion bends its
+// edges into.
+struct RoiEnvelopeOptions {
+  // Points per ROI edge at each depth, as in DenseRoiOptions; 1 leaves out
+  // any bulge of the edges (about 200 px near the image corners of the
+  // test calibration).
+  int samples_per_edge = 16;
+  // Depth levels from z_min to z_max, evenly spaced in inverse depth.
+  // Clamped to [2, kMaxEnvelopeDepthSamples].
+  int depth_samples = 2;
+};
+
+// Instruction set used by the batch projection kernels. The best one
+// available is picked automatically (NEON on aarch64, CPUID dispatch between
+// AVX-512 and AVX2 on x86-64); SetKernelIsa overrides it, e.g. for
+// benchmarks. Returns false if `isa` is not available on this build/host.
+enum class KernelIsa {
+  kScalar,
+  kNeon,
+  kAvx2,
+  kAvx512,
+};
+
+bool IsKernelIsaSupported(KernelIsa isa);
+KernelIsa ActiveKernelIsa();
+bool SetKernelIsa(KernelIsa isa);
+const char* KernelIsaName(KernelIsa isa);
+
+// Calibration "compiled" by LoadCalibration into the block the projection
+// kernels run from: reciprocal camera1 focal lengths, R|t as 3x4, K2 folded
+// into R|t for distortion-free camera2, and precomputed distortion flags.
+// Aligned to a cache line; the fields read first come first.
+struct alignas(64) CompiledCalibration {
+  double inv_fx1 = 1.0;
+  double inv_fy1 = 1.0;
+  double cx1 = 0.0;
+  double cy1 = 0.0;
+  double rt[3][4] = {};    // camera1 -> camera2, bottom row of the 4x4 dropped
+  double k2rt[3][4] = {};  // K2 * R|t, used when camera2 has no distortion
+  double fx2 = 1.0;
+  double fy2 = 1.0;
+  double cx2 = 0.0;
+  double cy2 = 0.0;
+  double dist1[5] = {};  // k1,k2,p1,p2,k3
+  double dist2[5] = {};  // k1,k2,p1,p2,k3
+  // camera1 table, null if not built or not accurate enough for the mode
+  const UndistortLut* lut1 = nullptr;
+  double undistort_tolerance = 1e-10;
+  int undistort_max_iterations = 8;
+  bool has_dist1 = false;
+  bool has_dist2 = false;
+};
+
+// True when more than 80% of `barcode`'s area lies inside `quad`. See
+// roi_coverage.h for the scoring rules and a batch variant.
+bool IsRoiInsideQuad(const std::array<Point2D, 4>& quad,
+                     const std::array<Point2D, 4>& barcode) noexcept;
+
+// Convex hull of finite `points`, computed in place without allocating:
+// `points` is reordered and its first N entries (N returned) become the
+// hull without collinear points, starting at the smallest (u, v) and wound
+// so its interior is on the inside of every edge as in IsRoiInsideQuad.
+// Fewer than three points are returned unchanged.
+size_t ComputeConvexHull(Point2D* points, size_t count) noexcept;
+
+// Const members may run concurrently; loading may not run alongside them.
+// Threads that project while calibrations are reloaded share a
+// SharedProjector (calibration_reload.h) instead.
 class Projector {
  public:
   bool LoadCalibration(const std::string& file_path);
-  CornersResult ProjectCorners(const std::array<Point3D, 4>& corners) const;
+  // In kFast, also builds the camera1 undistortion table described by
+  // `lut_options`, or maps it from lut_options.cache_dir; in the other
+  // modes `lut_options` is kept for a later switch to kFast.
+  // LoadCalibration(path) uses default UndistortLutOptions.
+  bool LoadCalibration(const std::string& file_path,
+                       const UndistortLutOptions& lut_options);
+  // Loads a binary calibration file (calibration_binary.h) by mapping it:
+  // nothing is parsed or recomputed, and a stored camera1 table is used in
+  // place. In kFast, a file without a table gets one as SetUndistortMode
+  // builds it. Returns false, keeping the current calibration, for a
+  // missing, truncated, corrupt (checksum mismatch) or other-version file.
+  // The file stays mapped while its table is in use: replace it by
+  // renaming a new file over it, as SaveCalibrationBinary does, never by
+  // rewriting it in place, which faults readers of the table (SIGBUS).
+  bool LoadCalibrationBinary(const std::string& file_path);
+  // Writes the loaded calibration, with its camera1 table if one was built,
+  // as a binary calibration file. Replaces `file_path` atomically.
+  bool SaveCalibrationBinary(const std::string& file_path) const;
+  // Replaces the camera1 undistortion table with the one `lut_options`
+  // describes, mapped from its cache or built (build_in_background is
+  // ignored); outside kFast it only drops the table and keeps the options.
+  // Like loading, must not run alongside projection.
+  void RebuildUndistortLut(const UndistortLutOptions& lut_options);
+  CornersResult ProjectCorners(
+      const std::array<Point3D, 4>& corners) const noexcept;
+  // Samples each ROI edge between its corners, with inverse depth
+  // interpolated linearly along the edge (exact for a planar ROI seen by
+  // an undistorted camera1), and projects all samples in one batch through
+  // the active kernel. Writes the dense polygon, or its convex hull, to
+  // `out`; samples per edge are further capped at capacity / 4. Does not
+  // allocate.
+  DenseRoiResult ProjectDenseRoi(const std::array<Point3D, 4>& corners,
+                                 const DenseRoiOptions& options, Point2D* out,
+                                 size_t capacity) const noexcept;
+  // Region of camera2 holding the ROI `corners_uv` (camera1 pixels) at any
+  // depth in [z_min, z_max] (either order): the convex hull of the ROI
+  // samples projected at every depth level, all through the batch kernel.
+  // Exact when neither camera has distortion; otherwise as tight as the
+  // sampling. `out` receives the hull and needs room for every sample;
+  // samples per edge are capped to fit. Does not allocate.
+  DenseRoiResult ProjectRoiEnvelope(const std::array<Point2D, 4>& corners_uv,
+                                    double z_min, double z_max,
+                                    const RoiEnvelopeOptions& options,
+                                    Point2D* out,
+                                    size_t capacity) const noexcept;
+
+  // Batch projection over caller-owned buffers, no allocation.
+  // Failed points get NaN coordinates. `status` may be null. `iterations`
+  // (may be null) receives the undistortion Newton steps per point; table
+  // hits take 0. Returns the number of points projected successfully.
+  size_t ProjectPoints(const Point3D* points, size_t count, Point2D* out,
+                       ProjectStatus* status,
+                       uint8_t* iterations = nullptr) const noexcept;
+  // Struct-of-arrays variant of the above.
+  size_t ProjectPoints(const double* u, const double* v, const double* z,
+                       size_t count, double* out_u, double* out_v,
+                       ProjectStatus* status,
+                       uint8_t* iterations = nullptr) const noexcept;
+
+  // Also decides whether the camera1 table is used (see UndistortMode).
+  // Switching to kFast without a table builds or maps one with the options
+  // of the last LoadCalibration or RebuildUndistortLut (build_in_background
+  // ignored), so like loading it must not run alongside projection.
+  void SetUndistortMode(UndistortMode mode);
+  UndistortMode undistort_mode() const { return undistort_mode_; }
+
+  bool has_calibration() const { return has_calibration_; }
+  const CompiledCalibration& compiled_calibration() const { return compiled_; }
+  // Camera1 undistortion table, or null if disabled or not built (outside
+  // kFast). Loaded is not in use: compiled_calibration().lut1 is the table
+  // the current mode projects with.
+  const UndistortLut* undistort_lut() const { return lut1_.get(); }
 
  private:
   bool has_calibration_ = false;
@@ -46,27 +255,22 @@ class Projector {
   std::array<std::array<double, 3>, 3> camera2_{};     // 3x3
   std::array<double, 5> dist1_{};                      // k1,k2,p1,p2,k3
   std::array<double, 5> dist2_{};                      // k1,k2,p1,p2,k3
+  CompiledCalibration compiled_{};
+  std::shared_ptr<const UndistortLut> lut1_;
+  UndistortLutOptions lut_options_;  // for building lut1_ on entering kFast
+  UndistortMode undistort_mode_ = UndistortMode::kBalanced;
 
-  bool ParseMatrix4x4(const std::string& json, const std::string& key,
-                      std::array<std::array<double, 4>, 4>& out) const;
-  bool ParseMatrix3x3(const std::string& json, const std::string& key,
-                      std::array<std::array<double, 3>, 3>& out) const;
-  bool ParseDistortion5(const std::string& json, const std::string& key,
-                        std::array<double, 5>& out) const;
-  bool ParseNumberArray(const std::string& json, size_t start_pos,
-                        size_t expected_count, std::vector<double>& out) const;
-  bool FindKeyArrayStart(const std::string& json, const std::string& key,
-                         size_t& start_pos) const;
-
-  bool TransformPoint(double u, double v, double depth,
-                      double& out_u, double& out_v) const;
+  ProjectStatus ProjectOne(double u, double v, double depth,
+                           double& out_u, double& out_v) const noexcept;
+  ProjectStatus TransformPoint(double u, double v, double depth,
+                               double& out_u, double& out_v) const noexcept;
   bool HasDistortion(const std::array<double, 5>& dist) const;
-  void UndistortNormalized(double xd, double yd,
-                           const std::array<double, 5>& dist,
-                           double& xu, double& yu) const;
-  void DistortNormalized(double x, double y,
-                         const std::array<double, 5>& dist,
-                         double& xd, double& yd) const;
+  void CompileCalibration();
+  // Sets lut1_ from the cache (`cached_only`) or by building, with
+  // lut_options_.
+  void LoadUndistortLut(bool cached_only);
+  // Points compiled_ at the current mode's solver settings and table.
+  void SelectUndistortLut();
 };
 
 }  // namespace roi_projector
@@ -0,0 +1,166 @@
+// ROI 多边形按行扫描转换为像素区间与位图。
+#include "roi_raster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace roi_projector {
+
+namespace {
+
+// 像素坐标限制在 ±2^30 内再取整，避免超大坐标（或 NaN）转换溢出
+int FloorToInt(double x) noexcept {
+  constexpr double kLimit = 1 << 30;
+  if (!(x > -kLimit)) {
+    return -(1 << 30);
+  }
+  if (!(x < kLimit)) {
+    return 1 << 30;
+  }
+  // 截断后向下修正；比 std::floor 便宜（x86-64 基线没有 roundsd）
+  const int truncated = static_cast<int>(x);
+  return truncated - (x < truncated ? 1 : 0);
+}
+
+// 向上取整；与 FloorToInt 同样限制范围
+int CeilToInt(double x) noexcept { return -FloorToInt(-x); }
+
+}  // namespace
+
+bool RoiSpans::Contains(int x, int y) const noexcept {
+  const long row = static_cast<long>(y) - first_row;
+  if (row < 0 || row >= static_cast<long>(spans.size())) {
+    return false;
+  }
+  const RowSpan& span = spans[static_cast<size_t>(row)];
+  return x >= span.x0 && x < span.x1;
+}
+
+size_t RoiSpans::PixelCount() const noexcept {
+  size_t count = 0;
+  for (const RowSpan& span : spans) {
+    count += span.x1 > span.x0 ? static_cast<size_t>(span.x1 - span.x0) : 0;
+  }
+  return count;
+}
+
+bool RoiMask::Test(int x, int y) const noexcept {
+  if (x < 0 || x >= width || y < first_row || y >= first_row + rows) {
+    return false;
+  }
+  const size_t index =
+      static_cast<size_t>(y - first_row) * words_per_row +
+      static_cast<size_t>(x) / 64;
+  return ((words[index] >> (static_cast<unsigned>(x) % 64)) & 1u) != 0;
+}
+
+bool RasterizeRoi(const Point2D* polygon, size_t count,
+                  const RasterOptions& options, RoiSpans& spans) {
+  spans.first_row = 0;
+  spans.spans.clear();
+  if (polygon == nullptr || count < 3 || options.width <= 0 ||
+      options.height <= 0 || !(options.dilation_px >= 0.0) ||
+      !std::isfinite(options.dilation_px)) {
+    return false;
+  }
+  double min_v = std::numeric_limits<double>::infinity();
+  double max_v = -std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < count; ++i) {
+    if (!std::isfinite(polygon[i].u) || !std::isfinite(polygon[i].v)) {
+      return false;
+    }
+    min_v = std::min(min_v, polygon[i].v);
+    max_v = std::max(max_v, polygon[i].v);
+  }
+
+  // 第 y 行（膨胀后）对应的带状区域为闭区间 [y - d, y + 1 + d]，
+  // 与 [v0, v1] 相交即 ceil(v0 - d) - 1 <= y <= floor(v1 + d)；
+  // 列同理，恰好落在整数坐标上的边界两侧的像素都算在内
+  const double d = options.dilation_px;
+  const int row_begin = std::max(0, CeilToInt(min_v - d) - 1);
+  const int row_end = std::min(options.height, FloorToInt(max_v + d) + 1);
+  if (row_begin >= row_end) {
+    return true;
+  }
+  spans.first_row = row_begin;
+  // 取整单调，直接按像素累计每行范围：先置为空区间，逐边取并集
+  RowSpan empty;
+  empty.x0 = std::numeric_limits<int32_t>::max();
+  empty.x1 = std::numeric_limits<int32_t>::min();
+  spans.spans.assign(static_cast<size_t>(row_end - row_begin), empty);
+
+  // 多边形与带状区域的交集在 x 方向的范围由边界决定：
+  // 把每条边裁剪到它跨过的每一行的带状区域内，取裁剪后端点的 x。
+  for (size_t i = 0; i < count; ++i) {
+    Point2D a = polygon[i];
+    Point2D b = polygon[(i + 1) % count];
+    if (a.v > b.v) {
+      std::swap(a, b);
+    }
+    const double du = b.u - a.u;
+    const double dv = b.v - a.v;
+    const int first = std::max(row_begin, CeilToInt(a.v - d) - 1);
+    const int last = std::min(row_end - 1, FloorToInt(b.v + d));
+    for (int row = first; row <= last; ++row) {
+      const double lo = std::max(a.v, row - d);
+      const double hi = std::min(b.v, row + 1 + d);
+      if (lo > hi) {
+        continue;
+      }
+      double x_lo = a.u;
+      double x_hi = b.u;
+      if (dv > 0.0) {
+        // 参数 t 在 [0, 1] 内，近水平的边也不会溢出
+        x_lo = a.u + du * ((lo - a.v) / dv);
+        x_hi = a.u + du * ((hi - a.v) / dv);
+      }
+      RowSpan& span = spans.spans[static_cast<size_t>(row - row_begin)];
+      span.x0 = std::min(span.x0, CeilToInt(std::min(x_lo, x_hi) - d) - 1);
+      span.x1 = std::max(span.x1, FloorToInt(std::max(x_lo, x_hi) + d) + 1);
+    }
+  }
+
+  // 裁剪到图像宽度，完全在图像左右两侧之外的行置空
+  for (RowSpan& span : spans.spans) {
+    span.x0 = std::max(0, span.x0);
+    span.x1 = std::min(options.width, span.x1);
+    if (span.x0 >= span.x1) {
+      span = {};
+    }
+  }
+  return true;
+}
+
+void BuildRoiMask(const RoiSpans& spans, int width, RoiMask& mask) {
+  mask.width = std::max(0, width);
+  mask.first_row = spans.first_row;
+  mask.rows = static_cast<int>(spans.spans.size());
+  mask.words_per_row = (static_cast<size_t>(mask.width) + 63) / 64;
+  mask.words.assign(mask.words_per_row * spans.spans.size(), 0);
+  for (size_t r = 0; r < spans.spans.size(); ++r) {
+    const int x0 = std::max(0, spans.spans[r].x0);
+    const int x1 = std::min(mask.width, spans.spans[r].x1);
+    if (x0 >= x1) {
+      continue;
+    }
+    // 按 64 位字整块置位，首尾两个字用掩码
+    uint64_t* row = mask.words.data() + r * mask.words_per_row;
+    const size_t w0 = static_cast<size_t>(x0) / 64;
+    const size_t w1 = static_cast<size_t>(x1 - 1) / 64;
+    const uint64_t head = ~uint64_t{0} << (static_cast<unsigned>(x0) % 64);
+    const uint64_t tail =
+        ~uint64_t{0} >> (63 - static_cast<unsigned>(x1 - 1) % 64);
+    if (w0 == w1) {
+      row[w0] = head & tail;
+      continue;
+    }
+    row[w0] = head;
+    for (size_t w = w0 + 1; w < w1; ++w) {
+      row[w] = ~uint64_t{0};
+    }
+    row[w1] = tail;
+  }
+}
+
+}  // namespace roi_projector
@@ -0,0 +1,70 @@
+// Rasterization of a projected ROI polygon into camera2 pixels, so the
+// decoder can restrict its search to the ROI instead of decoding the full
+// frame and filtering afterwards.
+//
+// Pixel (x, y) is the closed square [x, x + 1] x [y, y + 1]. A row's span
+// covers every pixel of that row whose square meets the polygon, pixels
+// only touching it included: a polygon edge exactly on x = k takes in
+// columns k - 1 and k, one on y = k rows k - 1 and k. Exact for convex
+// polygons, and the row's full extent (a superset) for non-convex ones.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "roi_projector.h"
+
+namespace roi_projector {
+
+struct RasterOptions {
+  int width = 0;   // image size in pixels; spans are clipped to it
+  int height = 0;
+  // Grow the ROI by this many pixels. Conservative: a row takes the
+  // polygon's extent over the rows within the dilation, widened by it, so
+  // it covers at least every pixel within dilation_px of the polygon.
+  double dilation_px = 0.0;
+};
+
+// Half-open pixel range [x0, x1) of one row; empty when x0 >= x1.
+struct RowSpan {
+  int32_t x0 = 0;
+  int32_t x1 = 0;
+};
+
+// One span per row for rows [first_row, first_row + spans.size()).
+struct RoiSpans {
+  int first_row = 0;
+  std::vector<RowSpan> spans;
+
+  bool Contains(int x, int y) const noexcept;
+  // Number of pixels covered.
+  size_t PixelCount() const noexcept;
+};
+
+// Bit-packed mask over rows [first_row, first_row + rows): bit (x % 64) of
+// words[(y - first_row) * words_per_row + x / 64] is set when (x, y) is in
+// the ROI. Only the ROI's rows are stored.
+struct RoiMask {
+  int width = 0;
+  int first_row = 0;
+  int rows = 0;
+  size_t words_per_row = 0;
+  std::vector<uint64_t> words;
+
+  bool Test(int x, int y) const noexcept;
+};
+
+// Rasterizes `polygon` (count >= 3 vertices, either winding, e.g. the
+// points of ProjectCorners). `spans` is reused; after the first frames this
+// only allocates when the ROI grows. Returns false, leaving `spans` empty,
+// for fewer than three or non-finite vertices, or a non-positive image
+// size. A ROI outside the image gives true with no rows.
+bool RasterizeRoi(const Point2D* polygon, size_t count,
+                  const RasterOptions& options, RoiSpans& spans);
+
+// Expands spans into a bit mask of an image `width` pixels wide; `mask` is
+// reused like `spans`.
+void BuildRoiMask(const RoiSpans& spans, int width, RoiMask& mask);
+
+}  // namespace roi_projector
@@ -0,0 +1,237 @@
+// Per-thread trace rings and the background drain thread.
+#include "roi_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace roi_projector {
+
+namespace {
+
+// Records per thread (192 KiB); a power of two so indices wrap with a mask.
+constexpr uint64_t kRingCapacity = 4096;
+constexpr auto kDrainInterval = std::chrono::milliseconds(1);
+
+// Single-producer (the owning thread) / single-consumer (the drain thread)
+// ring. head and tail only grow; slots are indexed modulo the capacity.
+struct TraceRing {
+  alignas(64) std::atomic<uint64_t> head{0};
+  alignas(64) std::atomic<uint64_t> tail{0};
+  std::atomic<bool> retired{false};  // owning thread has exited
+  uint32_t thread_index = 0;
+  TraceRecord slots[kRingCapacity];
+};
+
+struct TraceState {
+  std::atomic<bool> active{false};
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<uint32_t> next_thread_index{0};
+
+  std::mutex rings_mutex;  // guards rings
+  std::vector<std::unique_ptr<TraceRing>> rings;
+
+  std::mutex control_mutex;  // guards everything below
+  std::condition_variable wake;
+  bool stop = false;
+  std::thread drainer;
+};
+
+// Never destroyed, so threads that exit during static destruction can
+// still retire their rings.
+TraceState& State() {
+  static TraceState* state = new TraceState;
+  return *state;
+}
+
+struct ThreadRing {
+  TraceRing* ring = nullptr;
+  ~ThreadRing() {
+    if (ring != nullptr) {
+      ring->retired.store(true, std::memory_order_release);
+    }
+  }
+};
+
+thread_local ThreadRing t_ring;
+
+// First emit on a thread registers its ring; later emits are lock-free.
+TraceRing* AcquireRing(TraceState& state) {
+  if (t_ring.ring == nullptr) {
+    auto ring = std::make_unique<TraceRing>();
+    ring->thread_index =
+        state.next_thread_index.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(state.rings_mutex);
+    t_ring.ring = ring.get();
+    state.rings.push_back(std::move(ring));
+  }
+  return t_ring.ring;
+}
+
+// Moves every pending record into `batch` (oldest first) and frees the
+// rings of exited threads once they are empty.
+void DrainRings(TraceState& state, std::vector<TraceRecord>& batch) {
+  batch.clear();
+  std::lock_guard<std::mutex> lock(state.rings_mutex);
+  for (auto& ring : state.rings) {
+    const uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    for (; tail < head; ++tail) {
+      batch.push_back(ring->slots[tail & (kRingCapacity - 1)]);
+    }
+    ring->tail.store(tail, std::memory_order_release);
+  }
+  state.rings.erase(
+      std::remove_if(state.rings.begin(), state.rings.end(),
+                     [](const std::unique_ptr<TraceRing>& ring) {
+                       return ring->retired.load(std::memory_order_acquire) &&
+                              ring->head.load(std::memory_order_acquire) ==
+                                  ring->tail.load(std::memory_order_relaxed);
+                     }),
+      state.rings.end());
+  std::stable_sort(batch.begin(), batch.end(),
+                   [](const TraceRecord& a, const TraceRecord& b) {
+                     return a.timestamp_ns < b.timestamp_ns;
+                   });
+}
+
+void PrintRecords(const TraceRecord* records, size_t count, void*) {
+  char line[256];
+  for (size_t i = 0; i < count; ++i) {
+    const size_t n = FormatTraceRecord(records[i], line, sizeof(line) - 1);
+    line[n] = '\n';
+    std::fwrite(line, 1, n + 1, stdout);
+  }
+  std::fflush(stdout);
+}
+
+void DrainLoop(TraceState& state, TraceSink sink, void* user) {
+  std::vector<TraceRecord> batch;
+  batch.reserve(kRingCapacity);
+  bool stopping = false;
+  while (!stopping) {
+    {
+      std::unique_lock<std::mutex> lock(state.control_mutex);
+      state.wake.wait_for(lock, kDrainInterval, [&] { return state.stop; });
+      stopping = state.stop;
+    }
+    DrainRings(state, batch);
+    if (!batch.empty()) {
+      sink(batch.data(), batch.size(), user);
+    }
+  }
+}
+
+}  // namespace
+
+bool TraceCompiledIn() noexcept {
+#if defined(ROI_PROJECTOR_ENABLE_TRACE)
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool StartTracing(TraceSink sink, void* user) {
+  TraceState& state = State();
+  std::lock_guard<std::mutex> lock(state.control_mutex);
+  if (state.drainer.joinable()) {
+    return false;
+  }
+  state.stop = false;
+  state.drainer = std::thread(DrainLoop, std::ref(state),
+                              sink != nullptr ? sink : &PrintRecords, user);
+  state.active.store(true, std::memory_order_relaxed);
+  return true;
+}
+
+void StopTracing() {
+  TraceState& state = State();
+  std::thread drainer;
+  {
+    std::lock_guard<std::mutex> lock(state.control_mutex);
+    state.active.store(false, std::memory_order_relaxed);
+    state.stop = true;
+    drainer = std::move(state.drainer);
+  }
+  state.wake.notify_all();
+  if (drainer.joinable()) {
+    drainer.join();
+  }
+}
+
+uint64_t TraceDroppedRecords() noexcept {
+  return State().dropped.load(std::memory_order_relaxed);
+}
+
+size_t FormatTraceRecord(const TraceRecord& record, char* buffer,
+                         size_t size) noexcept {
+  int n = 0;
+  const double* v = record.values;
+  switch (record.event) {
+    case TraceEvent::kClipEmpty:
+      n = std::snprintf(buffer, size,
+                        "[IOU Debug] Clip edge %d resulted in empty "
+                        "intersection",
+                        static_cast<int>(v[0]));
+      break;
+    case TraceEvent::kIntersection:
+      n = std::snprintf(buffer, size,
+                        "[IOU Debug] area_quad=%g, area_barcode=%g, "
+                        "intersection_size=%d, intersection_area=%g",
+                        v[0], v[1], static_cast<int>(v[2]), v[3]);
+      break;
+    case TraceEvent::kCoverage:
+      n = std::snprintf(buffer, size, "[IOU Debug] IOU: %g", v[0]);
+      break;
+  }
+  if (n < 0 || size == 0) {
+    return 0;
+  }
+  return std::min(static_cast<size_t>(n), size - 1);
+}
+
+namespace detail {
+
+bool TraceActive() noexcept {
+  return State().active.load(std::memory_order_relaxed);
+}
+
+void TraceEmit(TraceEvent event, double v0, double v1, double v2,
+               double v3) noexcept {
+  TraceState& state = State();
+  TraceRing* ring = nullptr;
+  try {
+    ring = AcquireRing(state);
+  } catch (...) {
+    state.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  const uint64_t head = ring->head.load(std::memory_order_relaxed);
+  if (head - ring->tail.load(std::memory_order_acquire) >= kRingCapacity) {
+    state.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  TraceRecord& record = ring->slots[head & (kRingCapacity - 1)];
+  record.timestamp_ns = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+  record.thread_index = ring->thread_index;
+  record.event = event;
+  record.values[0] = v0;
+  record.values[1] = v1;
+  record.values[2] = v2;
+  record.values[3] = v3;
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+}  // namespace detail
+
+}  // namespace roi_projector
@@ -0,0 +1,69 @@
+// Structured tracing for the geometry checks.
+// Trace points (ROI_TRACE) are compiled out unless the library is built with
+// ROI_PROJECTOR_ENABLE_TRACE=ON. When compiled in, each emitting thread owns
+// a lock-free single-producer ring; a background thread started by
+// StartTracing drains the rings into a sink, so trace points never block or
+// take a lock on the hot path.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace roi_projector {
+
+enum class TraceEvent : uint16_t {
+  kClipEmpty,     // values: clip edge index
+  kIntersection,  // values: area_quad, area_barcode, vertices, area
+  kCoverage,      // values: coverage, threshold, inside (0/1)
+};
+
+struct TraceRecord {
+  uint64_t timestamp_ns = 0;  // steady clock
+  uint32_t thread_index = 0;  // small per-thread id, in order of first use
+  TraceEvent event = TraceEvent::kCoverage;
+  double values[4] = {};
+};
+
+// Receives drained records on the background thread.
+using TraceSink = void (*)(const TraceRecord* records, size_t count,
+                           void* user);
+
+// Whether ROI_TRACE points were compiled into the library.
+bool TraceCompiledIn() noexcept;
+
+// Starts the drain thread and enables the trace points. A null `sink`
+// prints one "[IOU Debug]" line per record to stdout. Returns false if
+// tracing is already running.
+bool StartTracing(TraceSink sink = nullptr, void* user = nullptr);
+// Disables the trace points, drains what is left and joins the thread.
+void StopTracing();
+// Records lost because a thread's ring was full.
+uint64_t TraceDroppedRecords() noexcept;
+
+// Writes `record` in the "[IOU Debug]" text format, without a newline.
+size_t FormatTraceRecord(const TraceRecord& record, char* buffer,
+                         size_t size) noexcept;
+
+namespace detail {
+
+bool TraceActive() noexcept;
+void TraceEmit(TraceEvent event, double v0, double v1 = 0.0, double v2 = 0.0,
+               double v3 = 0.0) noexcept;
+
+}  // namespace detail
+
+}  // namespace roi_projector
+
+#if defined(ROI_PROJECTOR_ENABLE_TRACE)
+#define ROI_TRACE(event, ...)                                         \
+  do {                                                                \
+    if (::roi_projector::detail::TraceActive()) {                     \
+      ::roi_projector::detail::TraceEmit(                             \
+          ::roi_projector::TraceEvent::event, __VA_ARGS__);           \
+    }                                                                 \
+  } while (0)
+#else
+#define ROI_TRACE(event, ...) \
+  do {                        \
+  } while (0)
+#endif
@@ -0,0 +1,53 @@
+// Fixed-capacity polygon stored inline, for allocation-free clipping.
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+#include "roi_projector.h"
+
+namespace roi_projector {
+
+// Up to N vertices in a std::array; the vertex count is tracked separately.
+// Callers size N from the geometry (clipping a k-gon by an m-gon yields at
+// most k + m vertices), so push_back past capacity is a logic error.
+template <size_t N>
+class StaticPolygon {
+ public:
+  static constexpr size_t kCapacity = N;
+
+  StaticPolygon() = default;
+
+  template <size_t M>
+  explicit StaticPolygon(const std::array<Point2D, M>& points) noexcept {
+    static_assert(M <= N, "polygon does not fit");
+    for (const Point2D& p : points) {
+      points_[size_++] = p;
+    }
+  }
+
+  size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+  void clear() noexcept { size_ = 0; }
+
+  void push_back(const Point2D& p) noexcept {
+    assert(size_ < N);
+    points_[size_++] = p;
+  }
+
+  Point2D& operator[](size_t i) noexcept { return points_[i]; }
+  const Point2D& operator[](size_t i) const noexcept { return points_[i]; }
+  const Point2D& back() const noexcept { return points_[size_ - 1]; }
+
+  Point2D* begin() noexcept { return points_.data(); }
+  Point2D* end() noexcept { return points_.data() + size_; }
+  const Point2D* begin() const noexcept { return points_.data(); }
+  const Point2D* end() const noexcept { return points_.data() + size_; }
+
+ private:
+  std::array<Point2D, N> points_{};
+  size_t size_ = 0;
+};
+
+}  // namespace roi_projector
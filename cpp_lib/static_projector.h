@@ -0,0 +1,289 @@
+// Projector for a calibration fixed at compile time, for stations whose
+// calibration is frozen into the firmware image. roi_projector_calib_codegen
+// turns a calibration JSON file into a header defining a constexpr
+// StaticCalibration; StaticProjector<kCalibration> then projects with the
+// intrinsics, the fused matrices and the distortion model folded into the
+// code: terms whose coefficient is zero are not emitted at all. It
+// projects one point at a time, so it replaces the scalar kernel (ROI
+// corners, single points); large batches still go faster through
+// Projector's SIMD kernels.
+//
+// Results are bit-identical to a Projector loaded from the same file with
+// the undistortion table disabled (UndistortLutOptions::enabled = false)
+// and the same UndistortMode, provided the code including this header is
+// compiled without floating-point contraction, as the library is
+// (-ffp-contract=off). Dropping a zero term cannot change a result for
+// finite inputs: it only removes an addition of zero.
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#include "roi_projector.h"
+
+namespace roi_projector {
+
+// Calibration as read by Projector::LoadCalibration. A missing or short
+// distortion array is written as zeros.
+struct StaticCalibration {
+  double extrinsic[4][4];  // camera1 -> camera2, row-major
+  double camera1[3][3];
+  double camera2[3][3];
+  double dist1[5];  // k1,k2,p1,p2,k3
+  double dist2[5];  // k1,k2,p1,p2,k3
+};
+
+namespace detail {
+
+constexpr bool AnyNonZero(const double (&dist)[5]) {
+  for (double d : dist) {
+    if (d != 0.0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace detail
+
+template <const StaticCalibration& kCalib,
+          UndistortMode kMode = UndistortMode::kBalanced>
+class StaticProjector {
+ public:
+  static constexpr bool kHasDist1 = detail::AnyNonZero(kCalib.dist1);
+  static constexpr bool kHasDist2 = detail::AnyNonZero(kCalib.dist2);
+
+  // Same contract as one point of Projector::ProjectPoints; failed points
+  // get NaN coordinates.
+  static ProjectStatus Project(double u, double v, double depth,
+                               double& out_u, double& out_v) noexcept {
+    const ProjectStatus status = Transform(u, v, depth, out_u, out_v);
+    if (status != ProjectStatus::kOk) {
+      out_u = std::numeric_limits<double>::quiet_NaN();
+      out_v = std::numeric_limits<double>::quiet_NaN();
+    }
+    return status;
+  }
+
+  // Same contract as Projector::ProjectCorners.
+  static CornersResult ProjectCorners(
+      const std::array<Point3D, 4>& corners) noexcept {
+    CornersResult result;
+    for (size_t i = 0; i < corners.size(); ++i) {
+      double out_u = 0.0;
+      double out_v = 0.0;
+      const ProjectStatus status =
+          Transform(corners[i].u, corners[i].v, corners[i].z, out_u, out_v);
+      if (status != ProjectStatus::kOk) {
+        result.status = status;
+        result.failed_corner = static_cast<int>(i);
+        return result;
+      }
+      result.points[i].u = out_u;
+      result.points[i].v = out_v;
+    }
+    result.ok = true;
+    result.status = ProjectStatus::kOk;
+    return result;
+  }
+
+  // Same contract as Projector::ProjectPoints (AoS layout).
+  static size_t ProjectPoints(const Point3D* points, size_t count,
+                              Point2D* out, ProjectStatus* status) noexcept {
+    size_t ok_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+      const ProjectStatus st =
+          Project(points[i].u, points[i].v, points[i].z, out[i].u, out[i].v);
+      ok_count += st == ProjectStatus::kOk ? 1 : 0;
+      if (status != nullptr) {
+        status[i] = st;
+      }
+    }
+    return ok_count;
+  }
+
+ private:
+  struct Matrix34 {
+    double m[3][4];
+  };
+
+  // R|t, or K2 * R|t for a pinhole camera2, as CompileCalibration fuses it.
+  static constexpr Matrix34 FusedMatrix() {
+    Matrix34 out{};
+    const auto& e = kCalib.extrinsic;
+    const auto& k = kCalib.camera2;
+    for (size_t c = 0; c < 4; ++c) {
+      if (kHasDist2) {
+        out.m[0][c] = e[0][c];
+        out.m[1][c] = e[1][c];
+      } else {
+        out.m[0][c] = k[0][0] * e[0][c] + k[0][2] * e[2][c];
+        out.m[1][c] = k[1][1] * e[1][c] + k[1][2] * e[2][c];
+      }
+      out.m[2][c] = e[2][c];
+    }
+    return out;
+  }
+
+  // Step cap and residual tolerance of the camera1 solve, as
+  // Projector::SetUndistortMode sets them.
+  static constexpr int kMaxIterations = kMode == UndistortMode::kFast  ? 4
+                                        : kMode == UndistortMode::kExact ? 20
+                                                                         : 8;
+  static constexpr double kTolerance = kMode == UndistortMode::kFast ? 1e-6
+                                       : kMode == UndistortMode::kExact
+                                           ? 1e-14
+                                           : 1e-10;
+
+  static constexpr double kInvFx1 = 1.0 / kCalib.camera1[0][0];
+  static constexpr double kInvFy1 = 1.0 / kCalib.camera1[1][1];
+  static constexpr double kCx1 = kCalib.camera1[0][2];
+  static constexpr double kCy1 = kCalib.camera1[1][2];
+  static constexpr Matrix34 kFused = FusedMatrix();
+
+  // a + b, where a term known at compile time to be absent is left out.
+  template <bool kA, bool kB>
+  static double Sum(double a, double b) noexcept {
+    if constexpr (kA && kB) {
+      return a + b;
+    } else if constexpr (kA) {
+      return a;
+    } else if constexpr (kB) {
+      return b;
+    } else {
+      return 0.0;
+    }
+  }
+
+  // Row `r` of the fused matrix applied to (x, y, z, 1).
+  template <size_t r>
+  static double Row(double x, double y, double z) noexcept {
+    constexpr const double* m = kFused.m[r];
+    constexpr bool k0 = m[0] != 0.0;
+    constexpr bool k1 = m[1] != 0.0;
+    constexpr bool k2 = m[2] != 0.0;
+    const double xy = Sum<k0, k1>(m[0] * x, m[1] * y);
+    const double xyz = Sum<k0 || k1, k2>(xy, m[2] * z);
+    return Sum<k0 || k1 || k2, m[3] != 0.0>(xyz, m[3]);
+  }
+
+  // Brown-Conrady terms of the camera1 or camera2 model at (x, y): the
+  // radial factor and the tangential offsets, in the order of the
+  // projection kernels.
+  template <bool kCamera2>
+  struct Model {
+    static constexpr const double* dist =
+        kCamera2 ? kCalib.dist2 : kCalib.dist1;
+    static constexpr bool kK1 = dist[0] != 0.0;
+    static constexpr bool kK2 = dist[1] != 0.0;
+    static constexpr bool kP1 = dist[2] != 0.0;
+    static constexpr bool kP2 = dist[3] != 0.0;
+    static constexpr bool kK3 = dist[4] != 0.0;
+    static constexpr bool kRadial = kK1 || kK2 || kK3;
+    static constexpr bool kTangential = kP1 || kP2;
+
+    static double Radial(double r2) noexcept {
+      const double k1 = Sum<true, kK1>(1.0, dist[0] * r2);
+      const double k2 = Sum<true, kK2>(k1, dist[1] * r2 * r2);
+      return Sum<true, kK3>(k2, dist[4] * r2 * r2 * r2);
+    }
+    static double TangentialX(double x, double y, double r2) noexcept {
+      return Sum<kP1, kP2>(2.0 * dist[2] * x * y,
+                           dist[3] * (r2 + 2.0 * x * x));
+    }
+    static double TangentialY(double x, double y, double r2) noexcept {
+      return Sum<kP1, kP2>(dist[2] * (r2 + 2.0 * y * y),
+                           2.0 * dist[3] * x * y);
+    }
+    static void Distort(double x, double y, double& xd, double& yd) noexcept {
+      const double r2 = x * x + y * y;
+      const double radial = Radial(r2);
+      xd = Sum<true, kTangential>(x * radial, TangentialX(x, y, r2));
+      yd = Sum<true, kTangential>(y * radial, TangentialY(x, y, r2));
+    }
+  };
+
+  // Newton inverse of the camera1 distortion, step for step as the
+  // projection kernels take it.
+  static bool Undistort(double& x_io, double& y_io) noexcept {
+    using M = Model<false>;
+    constexpr const double* d = kCalib.dist1;
+    constexpr double kTolerance2 = kTolerance * kTolerance;
+    const double xd = x_io;
+    const double yd = y_io;
+    double x = xd;
+    double y = yd;
+    for (int step = 0;; ++step) {
+      const double r2 = x * x + y * y;
+      const double radial = M::Radial(r2);
+      const double res_x =
+          Sum<true, M::kTangential>(x * radial, M::TangentialX(x, y, r2)) -
+          xd;
+      const double res_y =
+          Sum<true, M::kTangential>(y * radial, M::TangentialY(x, y, r2)) -
+          yd;
+      const bool converged = res_x * res_x + res_y * res_y < kTolerance2;
+      if (converged || step == kMaxIterations) {
+        x_io = x;
+        y_io = y;
+        return converged;
+      }
+      // d(radial)/d(r2), then the 2x2 Jacobian [a b; b c].
+      const double d_radial = Sum<M::kK1 || M::kK2, M::kK3>(
+          Sum<M::kK1, M::kK2>(d[0], 2.0 * d[1] * r2), 3.0 * d[4] * r2 * r2);
+      const double a = Sum<true, M::kP2>(
+          Sum<true, M::kP1>(Sum<true, M::kRadial>(
+                                radial, 2.0 * x * x * d_radial),
+                            2.0 * d[2] * y),
+          6.0 * d[3] * x);
+      const double b = Sum<M::kRadial || M::kP1, M::kP2>(
+          Sum<M::kRadial, M::kP1>(2.0 * x * y * d_radial, 2.0 * d[2] * x),
+          2.0 * d[3] * y);
+      const double c = Sum<true, M::kP2>(
+          Sum<true, M::kP1>(Sum<true, M::kRadial>(
+                                radial, 2.0 * y * y * d_radial),
+                            6.0 * d[2] * y),
+          2.0 * d[3] * x);
+      const double det = a * c - b * b;
+      x = x - (c * res_x - b * res_y) / det;
+      y = y - (a * res_y - b * res_x) / det;
+    }
+  }
+
+  static ProjectStatus Transform(double u, double v, double depth,
+                                 double& out_u, double& out_v) noexcept {
+    if (!(depth > 0.0) || !std::isfinite(depth)) {
+      return ProjectStatus::kInvalidDepth;
+    }
+    double x_norm = (u - kCx1) * kInvFx1;
+    double y_norm = (v - kCy1) * kInvFy1;
+    if constexpr (kHasDist1) {
+      if (!Undistort(x_norm, y_norm)) {
+        return ProjectStatus::kUndistortDiverged;
+      }
+    }
+    const double x = x_norm * depth;
+    const double y = y_norm * depth;
+    const double z = depth;
+    const double z2 = Row<2>(x, y, z);
+    if constexpr (kHasDist2) {
+      double x2 = Row<0>(x, y, z) / z2;
+      double y2 = Row<1>(x, y, z) / z2;
+      Model<true>::Distort(x2, y2, x2, y2);
+      out_u = kCalib.camera2[0][0] * x2 + kCalib.camera2[0][2];
+      out_v = kCalib.camera2[1][1] * y2 + kCalib.camera2[1][2];
+    } else {
+      out_u = Row<0>(x, y, z) / z2;
+      out_v = Row<1>(x, y, z) / z2;
+    }
+    if (!(z2 > 0.0) || !std::isfinite(z2) || !std::isfinite(out_u) ||
+        !std::isfinite(out_v)) {
+      return ProjectStatus::kProjectionFailed;
+    }
+    return ProjectStatus::kOk;
+  }
+};
+
+}  // namespace roi_projector
@@ -0,0 +1,273 @@
+// Checks that the projection hot path never touches the heap, by counting
+// calls to the global operator new while it runs.
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "basic_projector.h"
+#include "depth_integral.h"
+#include "depth_pyramid.h"
+#include "depth_sampler.h"
+#include "roi_coverage.h"
+#include "roi_projector.h"
+
+namespace {
+
+std::atomic<size_t> g_allocations{0};
+
+void* CountedAlloc(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+}  // namespace
+
+void* operator new(size_t size) { return CountedAlloc(size); }
+void* operator new[](size_t size) { return CountedAlloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(size == 0 ? 1 : size);
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+  return operator new(size, tag);
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+using roi_projector::KernelIsa;
+using roi_projector::Point2D;
+using roi_projector::Point3D;
+using roi_projector::ProjectStatus;
+
+static_assert(noexcept(std::declval<const roi_projector::Projector&>()
+                           .ProjectCorners({})),
+              "ProjectCorners must be noexcept");
+static_assert(noexcept(std::declval<const roi_projector::Projector&>()
+                           .ProjectPoints(nullptr, 0, nullptr, nullptr)),
+              "ProjectPoints must be noexcept");
+static_assert(noexcept(std::declval<const roi_projector::Projector&>()
+                           .ProjectDenseRoi({}, {}, nullptr, 0)),
+              "ProjectDenseRoi must be noexcept");
+static_assert(noexcept(std::declval<const roi_projector::Projector&>()
+                           .ProjectRoiEnvelope({}, 0.0, 0.0, {}, nullptr, 0)),
+              "ProjectRoiEnvelope must be noexcept");
+static_assert(noexcept(roi_projector::ProjectRoiFromDepth(
+                  std::declval<const roi_projector::Projector&>(), {}, {},
+                  {})),
+              "ProjectRoiFromDepth must be noexcept");
+
+// Runs `fn` twice (the first call may initialize statics) and returns the
+// allocations made by the second.
+template <class Fn>
+size_t AllocationsIn(Fn&& fn) {
+  fn();
+  const size_t before = g_allocations.load(std::memory_order_relaxed);
+  fn();
+  return g_allocations.load(std::memory_order_relaxed) - before;
+}
+
+int Expect(const char* what, size_t allocations) {
+  if (allocations != 0) {
+    std::cerr << what << ": " << allocations << " allocations\n";
+    return 1;
+  }
+  std::cout << what << ": no allocations\n";
+  return 0;
+}
+
+int CheckProjector(const roi_projector::Projector& projector) {
+  constexpr size_t kPoints = 257;
+  std::vector<Point3D> pts(kPoints);
+  std::vector<double> u(kPoints), v(kPoints), z(kPoints);
+  for (size_t i = 0; i < kPoints; ++i) {
+    pts[i] = {static_cast<double>((i * 37) % 1920),
+              static_cast<double>((i * 53) % 1200),
+              (i % 31 == 0) ? 0.0 : 800.0 + static_cast<double>(i)};
+    u[i] = pts[i].u;
+    v[i] = pts[i].v;
+    z[i] = pts[i].z;
+  }
+  std::vector<Point2D> out(kPoints);
+  std::vector<double> out_u(kPoints), out_v(kPoints);
+  std::vector<ProjectStatus> status(kPoints);
+  std::vector<uint8_t> iterations(kPoints);
+
+  const std::array<Point3D, 4> good = {
+      {{100.0, 200.0, 1000.0}, {400.0, 200.0, 1000.0},
+       {400.0, 350.0, 1000.0}, {100.0, 350.0, 1000.0}}};
+  std::array<Point3D, 4> bad = good;
+  bad[2].z = -1.0;
+
+  int failures = 0;
+  failures += Expect("ProjectCorners ok", AllocationsIn([&] {
+                       if (!projector.ProjectCorners(good).ok) {
+                         std::cerr << "unexpected failure\n";
+                       }
+                     }));
+  failures += Expect("ProjectCorners invalid depth", AllocationsIn([&] {
+                       projector.ProjectCorners(bad);
+                     }));
+  std::array<Point2D, 4 * roi_projector::kMaxDenseSamplesPerEdge> dense{};
+  for (bool hull : {false, true}) {
+    roi_projector::DenseRoiOptions dense_options;
+    dense_options.samples_per_edge = roi_projector::kMaxDenseSamplesPerEdge;
+    dense_options.convex_hull = hull;
+    failures += Expect(hull ? "ProjectDenseRoi hull" : "ProjectDenseRoi",
+                       AllocationsIn([&] {
+                         projector.ProjectDenseRoi(good, dense_options,
+                                                   dense.data(), dense.size());
+                       }));
+  }
+  std::array<Point2D, 4 * roi_projector::kMaxDenseSamplesPerEdge *
+                          roi_projector::kMaxEnvelopeDepthSamples>
+      envelope{};
+  const std::array<Point2D, 4> roi_uv = {{{good[0].u, good[0].v},
+                                          {good[1].u, good[1].v},
+                                          {good[2].u, good[2].v},
+                                          {good[3].u, good[3].v}}};
+  roi_projector::RoiEnvelopeOptions envelope_options;
+  envelope_options.samples_per_edge = roi_projector::kMaxDenseSamplesPerEdge;
+  envelope_options.depth_samples = roi_projector::kMaxEnvelopeDepthSamples;
+  failures += Expect("ProjectRoiEnvelope", AllocationsIn([&] {
+                       projector.ProjectRoiEnvelope(roi_uv, 700.0, 1500.0,
+                                                    envelope_options,
+                                                    envelope.data(),
+                                                    envelope.size());
+                     }));
+
+  // Depth frame covering the ROI, with a hole at corner 0 so the
+  // nearest-valid fallback runs too.
+  constexpr int kDepthWidth = 512;
+  constexpr int kDepthHeight = 400;
+  std::vector<float> depth(kDepthWidth * kDepthHeight, 1000.0f);
+  for (int y = 190; y <= 210; ++y) {
+    for (int x = 90; x <= 110; ++x) {
+      depth[y * kDepthWidth + x] = 0.0f;
+    }
+  }
+  roi_projector::DepthImageView image;
+  image.data = depth.data();
+  image.width = kDepthWidth;
+  image.height = kDepthHeight;
+  roi_projector::DepthSampleOptions depth_options;
+  depth_options.window_radius = roi_projector::kMaxDepthWindowRadius;
+  failures += Expect("ProjectRoiFromDepth", AllocationsIn([&] {
+                       if (!roi_projector::ProjectRoiFromDepth(
+                                projector, image, roi_uv, depth_options)
+                                .corners.ok) {
+                         std::cerr << "unexpected failure\n";
+                       }
+                     }));
+  // Only the first frame sizes the tables and starts the workers.
+  roi_projector::DepthIntegral integral;
+  integral.Build(image, 1);
+  failures += Expect("DepthIntegral rebuild", AllocationsIn([&] {
+                       integral.Build(image, 1);
+                       integral.BoundingBoxStats(roi_uv);
+                     }));
+  integral.Build(image, 4);
+  failures += Expect("DepthIntegral rebuild, 4 threads", AllocationsIn([&] {
+                       integral.Build(image, 4);
+                       integral.Build(image, 2);
+                     }));
+  // Likewise the pyramid arena.
+  roi_projector::DepthPyramid pyramid;
+  pyramid.Build(image);
+  failures += Expect("DepthPyramid rebuild", AllocationsIn([&] {
+                       pyramid.Build(image);
+                       pyramid.RoiRange(roi_uv);
+                     }));
+  const KernelIsa saved = roi_projector::ActiveKernelIsa();
+  for (KernelIsa isa : {KernelIsa::kScalar, KernelIsa::kNeon, KernelIsa::kAvx2,
+                        KernelIsa::kAvx512}) {
+    if (!roi_projector::SetKernelIsa(isa)) {
+      continue;
+    }
+    const std::string name = roi_projector::KernelIsaName(isa);
+    failures += Expect((name + " ProjectPoints AoS").c_str(),
+                       AllocationsIn([&] {
+                         projector.ProjectPoints(pts.data(), kPoints,
+                                                 out.data(), status.data(),
+                                                 iterations.data());
+                       }));
+    failures += Expect((name + " ProjectPoints SoA").c_str(),
+                       AllocationsIn([&] {
+                         projector.ProjectPoints(
+                             u.data(), v.data(), z.data(), kPoints,
+                             out_u.data(), out_v.data(), status.data(),
+                             iterations.data());
+                       }));
+  }
+  roi_projector::SetKernelIsa(saved);
+
+  for (bool use_float : {false, true}) {
+    const auto handle =
+        roi_projector::MakeSpecializedProjector(projector, use_float);
+    if (handle == nullptr) {
+      continue;
+    }
+    failures += Expect(handle->Name(), AllocationsIn([&] {
+                         handle->ProjectPoints(pts.data(), kPoints, out.data(),
+                                               status.data());
+                       }));
+  }
+  return failures;
+}
+
+int CheckRoiInsideQuad() {
+  const std::array<Point2D, 4> quad = {
+      {{0.0, 0.0}, {100.0, 0.0}, {100.0, 100.0}, {0.0, 100.0}}};
+  const std::array<Point2D, 4> barcode = {
+      {{90.0, 10.0}, {120.0, 10.0}, {120.0, 40.0}, {90.0, 40.0}}};
+  int failures = Expect("IsRoiInsideQuad", AllocationsIn([&] {
+                          roi_projector::IsRoiInsideQuad(quad, barcode);
+                        }));
+  const std::array<roi_projector::Quad, 3> barcodes = {{barcode, quad, quad}};
+  std::array<double, 3> coverage{};
+  std::array<bool, 3> pass{};
+  failures += Expect("ScoreBarcodes", AllocationsIn([&] {
+                       roi_projector::ScoreBarcodes(
+                           quad, barcodes.data(), barcodes.size(), 0.5,
+                           coverage.data(), pass.data());
+                     }));
+  return failures;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string calib_path = (argc > 1) ? argv[1] : "test/calib_out.json";
+
+  int failures = CheckRoiInsideQuad();
+  {
+    roi_projector::Projector unloaded;
+    failures += Expect("ProjectCorners not calibrated", AllocationsIn([&] {
+                         unloaded.ProjectCorners({});
+                       }));
+  }
+  for (bool use_lut : {true, false}) {
+    roi_projector::UndistortLutOptions options;
+    options.enabled = use_lut;
+    roi_projector::Projector projector;
+    if (!projector.LoadCalibration(calib_path, options)) {
+      std::cerr << "Failed to load calibration: " << calib_path << "\n";
+      return 1;
+    }
+    std::cout << (use_lut ? "with table\n" : "without table\n");
+    failures += CheckProjector(projector);
+  }
+  return failures == 0 ? 0 : 1;
+}
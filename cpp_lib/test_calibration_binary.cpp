@@ -0,0 +1,262 @@
+// Checks the binary calibration format: the checksum against reference
+// values, round trips with and without the camera1 table, the table used
+// in place from the mapping, rejection of damaged files, and concurrent
+// saves to one path.
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "calibration_binary.h"
+#include "roi_projector.h"
+
+namespace {
+
+int failures = 0;
+
+void Expect(bool ok, const std::string& what) {
+  if (!ok) {
+    std::cerr << what << "\n";
+    ++failures;
+  }
+}
+
+std::vector<char> ReadBytes(const std::filesystem::path& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(in),
+                           std::istreambuf_iterator<char>());
+}
+
+void WriteBytes(const std::filesystem::path& path,
+                const std::vector<char>& bytes) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+void CheckChecksum() {
+  // XXH64 reference values, seed 0.
+  Expect(roi_projector::CalibrationChecksum("", 0) == 0xEF46DB3751D8E999ull,
+         "checksum: empty");
+  Expect(roi_projector::CalibrationChecksum("a", 1) == 0xD24EC4F1A98C6E5Bull,
+         "checksum: one byte");
+  Expect(roi_projector::CalibrationChecksum("abc", 3) ==
+             0x44BC2CF5AD770999ull,
+         "checksum: three bytes");
+  const std::string text = "Nobody inspects the spammish repetition";
+  Expect(roi_projector::CalibrationChecksum(text.data(), text.size()) ==
+             0xFBCEA83C8A378BF1ull,
+         "checksum: stripes and tail");
+}
+
+std::vector<roi_projector::Point2D> Project(
+    const roi_projector::Projector& projector) {
+  std::vector<roi_projector::Point2D> points;
+  for (double y = 50; y < 1200; y += 230) {
+    for (double x = 40; x < 1920; x += 310) {
+      const roi_projector::CornersResult result = projector.ProjectCorners(
+          {{{x, y, 900}, {x + 15, y, 1200}, {x, y + 15, 1500},
+            {x + 15, y + 15, 2100}}});
+      points.insert(points.end(), result.points.begin(),
+                    result.points.end());
+    }
+  }
+  return points;
+}
+
+bool SameProjection(const std::vector<roi_projector::Point2D>& a,
+                    const std::vector<roi_projector::Point2D>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].u != b[i].u || a[i].v != b[i].v) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Temporaries are named `path`.tmp.XXXXXX.
+void ExpectNoTemporary(const std::filesystem::path& path,
+                       const std::string& what) {
+  const std::string prefix = path.filename().string() + ".tmp.";
+  for (const auto& entry :
+       std::filesystem::directory_iterator(path.parent_path())) {
+    const std::string name = entry.path().filename().string();
+    Expect(name.rfind(prefix, 0) != 0,
+           what + "temporary file left behind: " + name);
+  }
+}
+
+void CheckRoundTrip(const std::string& calib_path,
+                    const std::filesystem::path& path) {
+  for (bool with_lut : {true, false}) {
+    const std::string what = with_lut ? "with table: " : "without table: ";
+    roi_projector::UndistortLutOptions options;
+    options.enabled = with_lut;
+    roi_projector::Projector reference;
+    // Only kFast builds the table.
+    reference.SetUndistortMode(roi_projector::UndistortMode::kFast);
+    if (!reference.LoadCalibration(calib_path, options)) {
+      std::cerr << "Failed to load calibration: " << calib_path << "\n";
+      ++failures;
+      return;
+    }
+    Expect(reference.SaveCalibrationBinary(path.string()), what + "save");
+    ExpectNoTemporary(path, what);
+    // Compared in the default mode, which `loaded` keeps; kFast would
+    // build a table for the file without one.
+    reference.SetUndistortMode(roi_projector::UndistortMode::kBalanced);
+
+    roi_projector::Projector loaded;
+    Expect(loaded.LoadCalibrationBinary(path.string()) &&
+               loaded.has_calibration(),
+           what + "load");
+    Expect(SameProjection(Project(loaded), Project(reference)),
+           what + "projection differs");
+    const roi_projector::UndistortLut* lut = loaded.undistort_lut();
+    Expect((lut != nullptr) == with_lut, what + "table presence");
+    if (lut != nullptr && reference.undistort_lut() != nullptr) {
+      const roi_projector::UndistortLut& built = *reference.undistort_lut();
+      Expect(lut->storage.empty() && lut->mapping != nullptr,
+             what + "table not used in place");
+      Expect(lut->cols == built.cols && lut->rows == built.rows &&
+                 lut->stride == built.stride &&
+                 lut->inv_stride == built.inv_stride,
+             what + "table geometry");
+    }
+
+    // Resaving a loaded file reproduces it byte for byte.
+    const std::filesystem::path again = path.string() + ".again";
+    Expect(loaded.SaveCalibrationBinary(again.string()) &&
+               ReadBytes(again) == ReadBytes(path),
+           what + "resave");
+    std::filesystem::remove(again);
+  }
+}
+
+void CheckDamaged(const std::string& calib_path,
+                  const std::filesystem::path& path) {
+  roi_projector::Projector reference;
+  if (!reference.LoadCalibration(calib_path) ||
+      !reference.SaveCalibrationBinary(path.string())) {
+    std::cerr << "Failed to write " << path << "\n";
+    ++failures;
+    return;
+  }
+  const std::vector<char> good = ReadBytes(path);
+  const std::vector<roi_projector::Point2D> expected = Project(reference);
+  const std::filesystem::path bad = path.string() + ".bad";
+
+  // Each damaged file fails and leaves the loaded calibration unchanged.
+  auto expect_rejected = [&](std::vector<char> bytes,
+                             const std::string& what) {
+    WriteBytes(bad, bytes);
+    roi_projector::Projector projector;
+    projector.LoadCalibrationBinary(path.string());
+    Expect(!projector.LoadCalibrationBinary(bad.string()) &&
+               projector.has_calibration() &&
+               SameProjection(Project(projector), expected),
+           "rejected: " + what);
+  };
+  std::vector<char> bytes = good;
+  bytes[0] = 'X';
+  expect_rejected(bytes, "magic");
+  bytes = good;
+  bytes[8] = static_cast<char>(roi_projector::kCalibrationFormatVersion + 1);
+  expect_rejected(bytes, "version");
+  bytes = good;
+  bytes[64 + 8] ^= 1;  // in extrinsic[1]
+  expect_rejected(bytes, "block byte");
+  bytes = good;
+  bytes[bytes.size() - 3] ^= 0x40;  // in the table
+  expect_rejected(bytes, "table byte");
+  bytes = good;
+  bytes.resize(bytes.size() - 8);
+  expect_rejected(bytes, "truncated");
+  bytes = good;
+  bytes.push_back(0);
+  expect_rejected(bytes, "trailing byte");
+  expect_rejected(std::vector<char>(good.begin(), good.begin() + 100),
+                  "header only");
+  expect_rejected({}, "empty");
+  std::filesystem::remove(bad);
+
+  roi_projector::Projector projector;
+  Expect(!projector.LoadCalibrationBinary(bad.string()) &&
+             !projector.has_calibration(),
+         "missing file");
+  Expect(!projector.SaveCalibrationBinary(bad.string()),
+         "save without calibration");
+}
+
+// Threads saving to the same path, half of them with the camera1 table:
+// every save succeeds and the survivor is one complete file, readable by
+// other users.
+void CheckConcurrentSaves(const std::string& calib_path,
+                          const std::filesystem::path& path) {
+  std::array<roi_projector::Projector, 2> projectors;
+  for (size_t i = 0; i < projectors.size(); ++i) {
+    roi_projector::UndistortLutOptions options;
+    options.enabled = i == 0;
+    if (options.enabled) {
+      projectors[i].SetUndistortMode(roi_projector::UndistortMode::kFast);
+    }
+    if (!projectors[i].LoadCalibration(calib_path, options)) {
+      std::cerr << "Failed to load calibration: " << calib_path << "\n";
+      ++failures;
+      return;
+    }
+  }
+  constexpr int kThreads = 4;
+  constexpr int kSaves = 25;
+  std::array<int, kThreads> failed_saves{};
+  std::vector<std::thread> writers;
+  for (int t = 0; t < kThreads; ++t) {
+    writers.emplace_back([&, t] {
+      for (int i = 0; i < kSaves; ++i) {
+        failed_saves[t] +=
+            projectors[t % 2].SaveCalibrationBinary(path.string()) ? 0 : 1;
+      }
+    });
+  }
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+  for (int t = 0; t < kThreads; ++t) {
+    Expect(failed_saves[t] == 0, "concurrent saves: a save failed");
+  }
+  roi_projector::Projector loaded;
+  Expect(loaded.LoadCalibrationBinary(path.string()) &&
+             SameProjection(Project(loaded), Project(projectors[1])),
+         "concurrent saves: survivor does not load");
+  const auto perms = std::filesystem::status(path).permissions();
+  Expect((perms & std::filesystem::perms::others_read) !=
+             std::filesystem::perms::none,
+         "concurrent saves: file not readable by others");
+  ExpectNoTemporary(path, "concurrent saves: ");
+  Expect(!projectors[0].SaveCalibrationBinary(
+             (path.parent_path() / "missing_dir" / "x.bin").string()),
+         "save into a missing directory succeeded");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string calib_path = (argc > 1) ? argv[1] : "test/calib_out.json";
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "test_calibration_binary.bin";
+  CheckChecksum();
+  CheckRoundTrip(calib_path, path);
+  CheckDamaged(calib_path, path);
+  CheckConcurrentSaves(calib_path, path);
+  std::filesystem::remove(path);
+  std::cout << (failures == 0 ? "calibration binary: ok\n"
+                              : "calibration binary: FAILED\n");
+  return failures == 0 ? 0 : 1;
+}
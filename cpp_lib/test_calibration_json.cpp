@@ -0,0 +1,203 @@
+// Checks the single-pass calibration JSON index: top-level keys only,
+// strings and escapes, number forms, malformed input, and LoadCalibration
+// on a bundle that repeats the calibration keys in nested values.
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "calibration_json.h"
+#include "roi_projector.h"
+
+namespace {
+
+using roi_projector::CalibrationJson;
+using roi_projector::JsonNumbers;
+
+int failures = 0;
+
+void Expect(bool ok, const std::string& what) {
+  if (!ok) {
+    std::cerr << what << "\n";
+    ++failures;
+  }
+}
+
+bool Equals(const JsonNumbers& numbers, std::initializer_list<double> want) {
+  if (numbers.count != want.size()) {
+    return false;
+  }
+  size_t i = 0;
+  for (double w : want) {
+    if (numbers.values[i++] != w) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+void CheckCalibrationFile(const std::string& calib_path) {
+  const std::string text = ReadFile(calib_path);
+  CalibrationJson json;
+  Expect(json.Parse(text) && json.size() == 5, "calibration file");
+  Expect(Equals(json.Find("camera1_matrix"),
+                {2141.442000362903, 0.0, 959.5, 0.0, 2141.359883417685, 599.5,
+                 0.0, 0.0, 1.0}),
+         "camera1_matrix");
+  Expect(Equals(json.Find("camera1_distortion"),
+                {-0.006699997194960479, -3.0617983391752306,
+                 -7.712856784340319e-06, -0.00045252517962608544,
+                 57.16343803048374}),
+         "camera1_distortion");
+  Expect(json.Find("extrinsic_matrix").count == 16, "extrinsic_matrix");
+  Expect(json.Find("missing").count == 0, "missing key");
+}
+
+void CheckKeys() {
+  // The key also appears in a string, an escaped string and a nested
+  // object before the top-level one.
+  const std::string text = R"({
+    "note": "\"camera1_matrix\": [9, 9]",
+    "comment": "camera1_matrix",
+    "stations": [{"camera1_matrix": [7, 7, 7]}, {"id": "a\\"}],
+    "camera1_matrix": [[1, 2], [3, 4e2]],
+    "camera1_matrix": [5],
+    "names": ["a", "b"],
+    "mixed": [1, [2, "x"]],
+    "flag": true, "none": null, "off": false, "scalar": 3,
+    "empty": [],
+    "after": [-0.0, 1E-3, -12.5e+1, 0]
+  })";
+  CalibrationJson json;
+  Expect(json.Parse(text), "keys: parse");
+  Expect(Equals(json.Find("camera1_matrix"), {1, 2, 3, 400}),
+         "keys: first top-level key wins");
+  Expect(json.Find("id").count == 0 && json.Find("names").count == 0 &&
+             json.Find("mixed").count == 0 && json.Find("scalar").count == 0,
+         "keys: non-numeric values");
+  Expect(json.Find("empty").count == 0, "keys: empty array");
+  Expect(Equals(json.Find("after"), {-0.0, 1e-3, -125.0, 0.0}),
+         "keys: number forms");
+}
+
+void CheckMalformed() {
+  const char* kBad[] = {
+      "",
+      "  ",
+      "[1, 2]",
+      "{",
+      R"({"a": [1, 2,]})",
+      R"({"a": [1 2]})",
+      R"({"a": +1})",
+      R"({"a": .5})",
+      R"({"a": inf})",
+      R"({"a": [1.]})",
+      R"({"a": [01]})",
+      R"({"a": [1e]})",
+      R"({"a": [-]})",
+      R"({"a": [1e400]})",
+      R"({"a": [1]} x)",
+      R"({"a" [1]})",
+      R"({"a": [1], })",
+      R"({"a": "open})",
+      R"({"a": "\)",
+      R"({"a": tru})",
+      R"({a: [1]})",
+  };
+  CalibrationJson json;
+  for (const char* text : kBad) {
+    Expect(!json.Parse(text) && json.size() == 0,
+           std::string("accepted malformed: ") + text);
+  }
+  Expect(json.Parse(" {} \n") && json.size() == 0, "empty object");
+
+  // Nesting is bounded rather than recursed into without limit; the
+  // top-level object counts as one level.
+  auto nested = [](int depth) {
+    return "{\"a\": " + std::string(static_cast<size_t>(depth), '[') + "1" +
+           std::string(static_cast<size_t>(depth), ']') + "}";
+  };
+  Expect(json.Parse(nested(roi_projector::kMaxCalibrationJsonDepth - 1)) &&
+             Equals(json.Find("a"), {1}),
+         "nesting at the limit");
+  Expect(!json.Parse(nested(roi_projector::kMaxCalibrationJsonDepth)),
+         "nesting past the limit");
+}
+
+std::array<roi_projector::Point2D, 4> Project(
+    const roi_projector::Projector& projector) {
+  const roi_projector::CornersResult result = projector.ProjectCorners(
+      {{{100, 200, 1000}, {1800, 150, 900}, {1700, 1100, 1500},
+        {50, 1000, 2000}}});
+  return result.points;
+}
+
+bool SameProjection(const std::array<roi_projector::Point2D, 4>& a,
+                    const std::array<roi_projector::Point2D, 4>& b) {
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].u != b[i].u || a[i].v != b[i].v) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void CheckLoad(const std::string& calib_path) {
+  roi_projector::Projector reference;
+  if (!reference.LoadCalibration(calib_path)) {
+    std::cerr << "Failed to load calibration: " << calib_path << "\n";
+    ++failures;
+    return;
+  }
+  const std::string calib = ReadFile(calib_path);
+  const std::string body = calib.substr(calib.find('{') + 1);
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "test_calibration_json.json";
+
+  // Decoy keys in metadata and stations come before the real ones.
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << R"({"metadata": {"extrinsic_matrix": [0, 0, 0]},)"
+        << R"("stations": [{"camera1_matrix": [[1, 0, 0], [0, 1, 0]]}],)"
+        << R"("comment": "camera2_matrix [1, 2, 3]",)" << body;
+  }
+  roi_projector::Projector projector;
+  Expect(projector.LoadCalibration(path.string()) &&
+             SameProjection(Project(projector), Project(reference)),
+         "load: bundle with decoy keys");
+
+  // A file without camera2_matrix is rejected and changes nothing.
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << R"({"extrinsic_matrix": [1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0,)"
+        << R"( 0, 0, 0, 1], "camera1_matrix": [1, 0, 0, 0, 1, 0, 0, 0, 1]})";
+  }
+  Expect(!projector.LoadCalibration(path.string()) &&
+             projector.has_calibration() &&
+             SameProjection(Project(projector), Project(reference)),
+         "load: incomplete file");
+  std::filesystem::remove(path);
+  Expect(!projector.LoadCalibration(path.string()), "load: missing file");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string calib_path = (argc > 1) ? argv[1] : "test/calib_out.json";
+  CheckCalibrationFile(calib_path);
+  CheckKeys();
+  CheckMalformed();
+  CheckLoad(calib_path);
+  std::cout << (failures == 0 ? "calibration json: ok\n"
+                              : "calibration json: FAILED\n");
+  return failures == 0 ? 0 : 1;
+}
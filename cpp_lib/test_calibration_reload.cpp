@@ -0,0 +1,320 @@
+// Checks calibration hot reload: readers always see one whole calibration
+// while another thread keeps publishing, publishing waits for readers of
+// the replaced calibration, and the watcher reloads a rewritten file.
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "calibration_json.h"
+#include "calibration_reload.h"
+#include "roi_projector.h"
+
+namespace {
+
+using roi_projector::Point2D;
+using roi_projector::Point3D;
+using roi_projector::Projector;
+using roi_projector::SharedProjector;
+
+std::atomic<int> failures{0};
+
+void Expect(bool ok, const std::string& what) {
+  if (!ok) {
+    std::cerr << what << "\n";
+    ++failures;
+  }
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+// `calib_path` with the extrinsic translation moved by `shift_mm` along x.
+std::string ShiftedCalibration(const std::string& calib_path,
+                               double shift_mm) {
+  const std::string text = ReadFile(calib_path);
+  roi_projector::CalibrationJson json;
+  if (!json.Parse(text)) {
+    return "";
+  }
+  std::ostringstream out;
+  out.precision(17);
+  out << "{";
+  const char* keys[] = {"extrinsic_matrix", "camera1_matrix",
+                        "camera2_matrix", "camera1_distortion",
+                        "camera2_distortion"};
+  for (const char* key : keys) {
+    const roi_projector::JsonNumbers numbers = json.Find(key);
+    out << (key == keys[0] ? "" : ", ") << "\"" << key << "\": [";
+    for (size_t i = 0; i < numbers.count; ++i) {
+      const bool moved = key == keys[0] && i == 3;
+      out << (i == 0 ? "" : ", ") << numbers.values[i] + (moved ? shift_mm : 0);
+    }
+    out << "]";
+  }
+  out << "}";
+  return out.str();
+}
+
+std::vector<Point3D> MakePoints() {
+  std::vector<Point3D> points;
+  for (double v = 40; v < 1200; v += 140) {
+    for (double u = 30; u < 1920; u += 210) {
+      points.push_back({u, v, 700 + u * 0.5});
+    }
+  }
+  return points;
+}
+
+std::vector<Point2D> Project(const Projector& projector,
+                             const std::vector<Point3D>& points) {
+  std::vector<Point2D> out(points.size());
+  projector.ProjectPoints(points.data(), points.size(), out.data(), nullptr);
+  return out;
+}
+
+bool Same(const std::vector<Point2D>& a, const std::vector<Point2D>& b) {
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].u != b[i].u || a[i].v != b[i].v) {
+      return false;
+    }
+  }
+  return a.size() == b.size();
+}
+
+struct Calibrations {
+  std::filesystem::path dir;
+  std::string json[2];    // original, shifted
+  std::string binary[2];  // same, as binary calibration files
+  std::vector<Point2D> expected[2];
+};
+
+bool Prepare(const std::string& calib_path, const std::vector<Point3D>& pts,
+             Calibrations& calib) {
+  calib.dir = std::filesystem::temp_directory_path() /
+              "test_calibration_reload";
+  std::filesystem::remove_all(calib.dir);
+  std::filesystem::create_directories(calib.dir);
+  for (int i = 0; i < 2; ++i) {
+    calib.json[i] = (calib.dir / ("calib" + std::to_string(i) + ".json"))
+                        .string();
+    calib.binary[i] = (calib.dir / ("calib" + std::to_string(i) + ".bin"))
+                          .string();
+    std::ofstream(calib.json[i]) << ShiftedCalibration(calib_path, i * 5.0);
+    Projector projector;
+    if (!projector.LoadCalibration(calib.json[i]) ||
+        !projector.SaveCalibrationBinary(calib.binary[i])) {
+      return false;
+    }
+    calib.expected[i] = Project(projector, pts);
+  }
+  return !Same(calib.expected[0], calib.expected[1]);
+}
+
+void CheckPublish(const Calibrations& calib, const std::vector<Point3D>& pts) {
+  SharedProjector shared;
+  Expect(!shared.Acquire() && shared.version() == 0, "empty: no snapshot");
+  Expect(!shared.Load(calib.dir.string() + "/missing.json") &&
+             shared.version() == 0,
+         "empty: missing file publishes nothing");
+  Expect(shared.Load(calib.json[0]) && shared.version() == 1 &&
+             Same(Project(*shared.Acquire(), pts), calib.expected[0]),
+         "publish: json");
+
+  // The undistortion mode carries over to the reloaded calibration.
+  {
+    auto projector = std::make_unique<Projector>();
+    projector->LoadCalibrationBinary(calib.binary[0]);
+    projector->SetUndistortMode(roi_projector::UndistortMode::kExact);
+    shared.Publish(std::move(projector));
+  }
+  Projector exact;
+  exact.LoadCalibrationBinary(calib.binary[1]);
+  exact.SetUndistortMode(roi_projector::UndistortMode::kExact);
+  Expect(shared.Load(calib.binary[1]) &&
+             shared.Acquire()->undistort_mode() ==
+                 roi_projector::UndistortMode::kExact &&
+             Same(Project(*shared.Acquire(), pts), Project(exact, pts)),
+         "publish: binary keeps the undistortion mode");
+  // Back to the default mode, which `expected` was projected with.
+  {
+    auto projector = std::make_unique<Projector>();
+    projector->LoadCalibrationBinary(calib.binary[1]);
+    shared.Publish(std::move(projector));
+  }
+
+  // A held snapshot keeps its calibration, and the publish replacing it
+  // does not return until the snapshot is released.
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool held = false;
+  bool release = false;
+  std::thread reader([&] {
+    SharedProjector::Snapshot snapshot = shared.Acquire();
+    std::unique_lock<std::mutex> lock(mutex);
+    held = true;
+    cv.notify_all();
+    cv.wait(lock, [&] { return release; });
+    Expect(Same(Project(*snapshot, pts), calib.expected[1]),
+           "held snapshot changed");
+  });
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return held; });
+  }
+  std::atomic<bool> published{false};
+  std::thread writer([&] {
+    shared.Load(calib.binary[0]);
+    published = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  Expect(!published && shared.version() == 5,
+         "publish returned while a reader held the old calibration");
+  Expect(Same(Project(*shared.Acquire(), pts), calib.expected[0]),
+         "new readers see the new calibration at once");
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    release = true;
+  }
+  cv.notify_all();
+  reader.join();
+  writer.join();
+  Expect(published, "publish after release");
+}
+
+void CheckConcurrent(const Calibrations& calib,
+                     const std::vector<Point3D>& pts) {
+  // Binary files with tables, so a table freed under a reader would be
+  // read after its mapping is gone.
+  SharedProjector shared;
+  shared.Load(calib.binary[0]);
+  std::atomic<bool> stop{false};
+  std::atomic<int> torn{0};
+  std::atomic<long> reads{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; ++t) {
+    readers.emplace_back([&] {
+      std::vector<Point2D> out(pts.size());
+      while (!stop.load(std::memory_order_relaxed)) {
+        const SharedProjector::Snapshot snapshot = shared.Acquire();
+        snapshot->ProjectPoints(pts.data(), pts.size(), out.data(), nullptr);
+        if (!Same(out, calib.expected[0]) && !Same(out, calib.expected[1])) {
+          ++torn;
+        }
+        ++reads;
+      }
+    });
+  }
+  constexpr int kPublishes = 100;
+  for (int i = 1; i <= kPublishes; ++i) {
+    Expect(shared.Load(calib.binary[i % 2]), "concurrent: load");
+  }
+  stop = true;
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+  Expect(torn == 0, "concurrent: " + std::to_string(torn.load()) + " of " +
+                        std::to_string(reads.load()) +
+                        " reads saw neither calibration");
+  Expect(shared.version() == kPublishes + 1, "concurrent: version");
+}
+
+struct ReloadLog {
+  std::mutex mutex;
+  std::condition_variable cv;
+  int ok = 0;
+  int failed = 0;
+};
+
+void OnReload(const std::string&, bool ok, void* user) {
+  ReloadLog& log = *static_cast<ReloadLog*>(user);
+  std::lock_guard<std::mutex> lock(log.mutex);
+  ++(ok ? log.ok : log.failed);
+  log.cv.notify_all();
+}
+
+bool WaitFor(ReloadLog& log, int ok, int failed) {
+  std::unique_lock<std::mutex> lock(log.mutex);
+  return log.cv.wait_for(lock, std::chrono::seconds(5), [&] {
+    return log.ok >= ok && log.failed >= failed;
+  });
+}
+
+void CheckWatcher(const Calibrations& calib, const std::vector<Point3D>& pts) {
+  const std::string path = (calib.dir / "station.calib").string();
+  std::filesystem::copy_file(calib.json[0], path);
+  SharedProjector shared;
+  shared.Load(path);
+  ReloadLog log;
+  roi_projector::CalibrationWatcher watcher;
+  if (!watcher.Start(shared, path, roi_projector::UndistortLutOptions(),
+                     OnReload, &log)) {
+#if defined(__linux__)
+    Expect(false, "watcher: start");
+#endif
+    return;
+  }
+  Expect(!watcher.Start(shared, path), "watcher: started twice");
+
+  // JSON rewritten in place. (A mapped binary file must not be: see
+  // LoadCalibrationBinary.)
+  std::filesystem::copy_file(calib.json[1], path,
+                             std::filesystem::copy_options::overwrite_existing);
+  Expect(WaitFor(log, 1, 0) &&
+             Same(Project(*shared.Acquire(), pts), calib.expected[1]),
+         "watcher: reload after rewrite");
+
+  // Binary renamed into place, as SaveCalibrationBinary writes.
+  Projector original;
+  original.LoadCalibrationBinary(calib.binary[0]);
+  original.SaveCalibrationBinary(path);
+  Expect(WaitFor(log, 2, 0) &&
+             Same(Project(*shared.Acquire(), pts), calib.expected[0]),
+         "watcher: reload after rename");
+
+  // Other files in the directory are ignored; a broken file is reported
+  // and keeps the calibration.
+  std::ofstream(calib.dir / "other.calib") << "x";
+  const std::filesystem::path broken = calib.dir / "broken.tmp";
+  std::ofstream(broken) << "{\"truncated\": [";
+  std::filesystem::rename(broken, path);
+  Expect(WaitFor(log, 2, 1) &&
+             Same(Project(*shared.Acquire(), pts), calib.expected[0]),
+         "watcher: broken file");
+  {
+    std::lock_guard<std::mutex> lock(log.mutex);
+    Expect(log.ok == 2 && log.failed == 1, "watcher: reload count");
+  }
+  watcher.Stop();
+  Expect(!watcher.running(), "watcher: stop");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string calib_path = (argc > 1) ? argv[1] : "test/calib_out.json";
+  const std::vector<Point3D> points = MakePoints();
+  Calibrations calib;
+  if (!Prepare(calib_path, points, calib)) {
+    std::cerr << "Failed to prepare calibrations from " << calib_path << "\n";
+    return 1;
+  }
+  CheckPublish(calib, points);
+  CheckConcurrent(calib, points);
+  CheckWatcher(calib, points);
+  std::filesystem::remove_all(calib.dir);
+  std::cout << (failures == 0 ? "calibration reload: ok\n"
+                              : "calibration reload: FAILED\n");
+  return failures == 0 ? 0 : 1;
+}
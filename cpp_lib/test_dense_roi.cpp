@@ -0,0 +1,270 @@
+// Checks edge-densified ROI projection, depth-range envelopes and the
+// convex hull they return.
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "roi_projector.h"
+
+namespace {
+
+using roi_projector::DenseRoiOptions;
+using roi_projector::DenseRoiResult;
+using roi_projector::Point2D;
+using roi_projector::Point3D;
+using roi_projector::ProjectStatus;
+
+int failures = 0;
+
+void Expect(bool ok, const char* what) {
+  if (!ok) {
+    std::cerr << what << "\n";
+    ++failures;
+  }
+}
+
+double Cross(const Point2D& o, const Point2D& a, const Point2D& b) {
+  return (a.u - o.u) * (b.v - o.v) - (a.v - o.v) * (b.u - o.u);
+}
+
+// Near the corners of camera1's image, where distortion bends edges most.
+const std::array<Point3D, 4> kCorners = {{{60.0, 50.0, 820.0},
+                                          {1860.0, 70.0, 900.0},
+                                          {1850.0, 1150.0, 1300.0},
+                                          {70.0, 1140.0, 1100.0}}};
+
+void CheckDense(const roi_projector::Projector& projector) {
+  constexpr int kSamples = 16;
+  constexpr size_t kCount = 4 * kSamples;
+  std::array<Point2D, 4 * roi_projector::kMaxDenseSamplesPerEdge> dense{};
+
+  // One sample per edge is ProjectCorners.
+  DenseRoiOptions options;
+  options.samples_per_edge = 1;
+  DenseRoiResult result =
+      projector.ProjectDenseRoi(kCorners, options, dense.data(), dense.size());
+  const roi_projector::CornersResult corners =
+      projector.ProjectCorners(kCorners);
+  Expect(result.ok && result.count == 4 && corners.ok, "corners: failed");
+  for (size_t i = 0; i < 4; ++i) {
+    Expect(dense[i].u == corners.points[i].u &&
+               dense[i].v == corners.points[i].v,
+           "corners: differ from ProjectCorners");
+  }
+
+  // Every sample is the projection of its point on the edge, with inverse
+  // depth interpolated linearly.
+  options.samples_per_edge = kSamples;
+  result =
+      projector.ProjectDenseRoi(kCorners, options, dense.data(), dense.size());
+  Expect(result.ok && result.count == kCount, "dense: failed");
+  double max_bulge = 0.0;
+  for (size_t edge = 0; edge < 4; ++edge) {
+    const Point3D& a = kCorners[edge];
+    const Point3D& b = kCorners[(edge + 1) % 4];
+    const Point2D& pa = corners.points[edge];
+    const Point2D& pb = corners.points[(edge + 1) % 4];
+    for (int step = 0; step < kSamples; ++step) {
+      const double t = static_cast<double>(step) / kSamples;
+      Point3D p = a;
+      if (step > 0) {
+        p = {a.u + t * (b.u - a.u), a.v + t * (b.v - a.v),
+             1.0 / (1.0 / a.z + t * (1.0 / b.z - 1.0 / a.z))};
+      }
+      Point2D expected;
+      ProjectStatus status;
+      projector.ProjectPoints(&p, 1, &expected, &status);
+      const Point2D& got = dense[edge * kSamples + step];
+      Expect(status == ProjectStatus::kOk &&
+                 std::fabs(got.u - expected.u) < 1e-9 &&
+                 std::fabs(got.v - expected.v) < 1e-9,
+             "dense: sample differs from ProjectPoints");
+      const double chord = std::hypot(pb.u - pa.u, pb.v - pa.v);
+      max_bulge = std::max(max_bulge, std::fabs(Cross(pa, pb, got)) / chord);
+    }
+  }
+  std::cout << "largest sample offset from the projected corner quad: "
+            << max_bulge << " px\n";
+
+  // The hull holds every sample and is made of samples.
+  std::array<Point2D, 4 * roi_projector::kMaxDenseSamplesPerEdge> hull{};
+  options.convex_hull = true;
+  result =
+      projector.ProjectDenseRoi(kCorners, options, hull.data(), hull.size());
+  Expect(result.ok && result.count >= 3 && result.count <= kCount,
+         "hull: failed");
+  for (size_t i = 0; i < result.count; ++i) {
+    const Point2D& a = hull[i];
+    const Point2D& b = hull[(i + 1) % result.count];
+    Expect(std::any_of(dense.begin(), dense.begin() + kCount,
+                       [&](const Point2D& p) {
+                         return p.u == a.u && p.v == a.v;
+                       }),
+           "hull: vertex is not a sample");
+    for (size_t k = 0; k < kCount; ++k) {
+      if (Cross(a, b, dense[k]) < -1e-6) {
+        std::cerr << "hull: sample " << k << " outside edge " << i << "\n";
+        ++failures;
+        return;
+      }
+    }
+  }
+
+  // A small buffer caps the samples per edge.
+  options.convex_hull = false;
+  result = projector.ProjectDenseRoi(kCorners, options, dense.data(), 10);
+  Expect(result.ok && result.count == 8, "capacity: not capped");
+
+  // Failures name the first bad sample: corner 2 is sample 2 * kSamples.
+  std::array<Point3D, 4> bad = kCorners;
+  bad[2].z = 0.0;
+  result = projector.ProjectDenseRoi(bad, options, dense.data(), dense.size());
+  Expect(!result.ok && result.status == ProjectStatus::kInvalidDepth &&
+             result.failed_sample == 2 * kSamples,
+         "invalid depth: wrong failure");
+
+  roi_projector::Projector uncalibrated;
+  result = uncalibrated.ProjectDenseRoi(kCorners, options, dense.data(),
+                                        dense.size());
+  Expect(!result.ok && result.status == ProjectStatus::kNotCalibrated,
+         "uncalibrated: wrong failure");
+}
+
+// Largest distance of `p` outside the convex polygon `hull` (0 if inside).
+double DistanceOutside(const Point2D* hull, size_t count, const Point2D& p) {
+  double outside = 0.0;
+  for (size_t i = 0; i < count; ++i) {
+    const Point2D& a = hull[i];
+    const Point2D& b = hull[(i + 1) % count];
+    const double len = std::hypot(b.u - a.u, b.v - a.v);
+    outside = std::max(outside, -Cross(a, b, p) / len);
+  }
+  return outside;
+}
+
+void CheckEnvelope(const roi_projector::Projector& projector) {
+  const std::array<Point2D, 4> roi = {{{kCorners[0].u, kCorners[0].v},
+                                       {kCorners[1].u, kCorners[1].v},
+                                       {kCorners[2].u, kCorners[2].v},
+                                       {kCorners[3].u, kCorners[3].v}}};
+  std::array<Point2D, 4 * roi_projector::kMaxDenseSamplesPerEdge *
+                          roi_projector::kMaxEnvelopeDepthSamples>
+      hull{};
+
+  // A single depth gives the hull of the projected corners.
+  roi_projector::RoiEnvelopeOptions options;
+  options.samples_per_edge = 1;
+  DenseRoiResult result = projector.ProjectRoiEnvelope(
+      roi, 900.0, 900.0, options, hull.data(), hull.size());
+  std::array<Point3D, 4> flat = kCorners;
+  for (Point3D& p : flat) {
+    p.z = 900.0;
+  }
+  const roi_projector::CornersResult corners = projector.ProjectCorners(flat);
+  Expect(result.ok && result.count == 4, "single depth: not a quad");
+  for (size_t i = 0; i < result.count; ++i) {
+    Expect(std::any_of(corners.points.begin(), corners.points.end(),
+                       [&](const Point2D& p) {
+                         return p.u == hull[i].u && p.v == hull[i].v;
+                       }),
+           "single depth: vertex is not a corner");
+  }
+
+  // Points anywhere in the ROI at any depth in range fall inside the
+  // envelope; the order of the depth bounds does not matter.
+  options.samples_per_edge = 16;
+  options.depth_samples = 8;
+  result = projector.ProjectRoiEnvelope(roi, 1500.0, 700.0, options,
+                                        hull.data(), hull.size());
+  Expect(result.ok && result.count >= 4, "range: failed");
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  double worst = 0.0;
+  for (int i = 0; i < 20000; ++i) {
+    // Bilinear point of the ROI; depth uniform in [700, 1500].
+    const double s = unit(rng);
+    const double t = unit(rng);
+    Point3D p;
+    p.u = (1 - t) * ((1 - s) * roi[0].u + s * roi[1].u) +
+          t * ((1 - s) * roi[3].u + s * roi[2].u);
+    p.v = (1 - t) * ((1 - s) * roi[0].v + s * roi[1].v) +
+          t * ((1 - s) * roi[3].v + s * roi[2].v);
+    p.z = 700.0 + 800.0 * unit(rng);
+    Point2D projected;
+    ProjectStatus status;
+    projector.ProjectPoints(&p, 1, &projected, &status);
+    worst = std::max(worst,
+                     DistanceOutside(hull.data(), result.count, projected));
+  }
+  std::cout << "envelope: " << result.count
+            << " hull vertices, largest excursion " << worst << " px\n";
+  Expect(worst < 0.5, "range: points outside the envelope");
+
+  // Samples per edge shrink to fit the buffer: 2 levels x 4 edges x 2.
+  result = projector.ProjectRoiEnvelope(roi, 700.0, 1500.0, {16, 2},
+                                        hull.data(), 17);
+  Expect(result.ok && result.count <= 16, "capacity: not capped");
+
+  result = projector.ProjectRoiEnvelope(roi, 0.0, 1500.0, options,
+                                        hull.data(), hull.size());
+  Expect(!result.ok && result.status == ProjectStatus::kInvalidDepth &&
+             result.failed_sample == 0,
+         "zero depth: wrong failure");
+}
+
+// Hull of a grid with collinear points, duplicates and an interior point.
+void CheckHull() {
+  std::array<Point2D, 12> points = {{{0, 0},
+                                     {1, 0},
+                                     {2, 0},
+                                     {2, 1},
+                                     {2, 2},
+                                     {1, 2},
+                                     {0, 2},
+                                     {0, 1},
+                                     {1, 1},
+                                     {2, 2},
+                                     {0, 0},
+                                     {1, 0}}};
+  const size_t n = roi_projector::ComputeConvexHull(points.data(),
+                                                    points.size());
+  const std::array<Point2D, 4> expected = {{{0, 0}, {2, 0}, {2, 2}, {0, 2}}};
+  Expect(n == 4, "hull: square has wrong vertex count");
+  for (size_t i = 0; i < std::min<size_t>(n, 4); ++i) {
+    Expect(points[i].u == expected[i].u && points[i].v == expected[i].v,
+           "hull: wrong square vertex");
+  }
+  // The hull is usable as an ROI: a barcode inside it is fully covered.
+  const std::array<Point2D, 4> quad = {{points[0], points[1], points[2],
+                                        points[3]}};
+  const std::array<Point2D, 4> barcode = {
+      {{0.5, 0.5}, {1.5, 0.5}, {1.5, 1.5}, {0.5, 1.5}}};
+  Expect(roi_projector::IsRoiInsideQuad(quad, barcode),
+         "hull: winding not usable as an ROI");
+
+  std::array<Point2D, 5> line = {{{0, 0}, {3, 3}, {1, 1}, {2, 2}, {1, 1}}};
+  Expect(roi_projector::ComputeConvexHull(line.data(), line.size()) == 2,
+         "hull: collinear points");
+  std::array<Point2D, 3> same = {{{4, 4}, {4, 4}, {4, 4}}};
+  Expect(roi_projector::ComputeConvexHull(same.data(), same.size()) == 1,
+         "hull: identical points");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string calib_path = (argc > 1) ? argv[1] : "test/calib_out.json";
+  roi_projector::Projector projector;
+  if (!projector.LoadCalibration(calib_path)) {
+    std::cerr << "Failed to load calibration: " << calib_path << "\n";
+    return 1;
+  }
+  CheckDense(projector);
+  CheckEnvelope(projector);
+  CheckHull();
+  std::cout << (failures == 0 ? "dense roi: ok\n" : "dense roi: FAILED\n");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+// Checks depth summed-area tables against per-pixel sums, for any number
+// of build threads.
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "depth_integral.h"
+
+namespace {
+
+using roi_projector::DepthImageView;
+using roi_projector::DepthIntegral;
+using roi_projector::DepthRectStats;
+
+int failures = 0;
+
+void Expect(bool ok, const char* what) {
+  if (!ok) {
+    std::cerr << what << "\n";
+    ++failures;
+  }
+}
+
+DepthRectStats Reference(const DepthImageView& image, int x0, int y0, int x1,
+                         int y1) {
+  DepthRectStats stats;
+  double sum = 0.0;
+  for (int y = std::max(y0, 0); y < std::min(y1, image.height); ++y) {
+    for (int x = std::max(x0, 0); x < std::min(x1, image.width); ++x) {
+      ++stats.pixels;
+      const float d = image.Row(y)[x];
+      if (roi_projector::IsValidDepth(d)) {
+        ++stats.valid;
+        sum += d;
+      }
+    }
+  }
+  if (stats.valid == 0) {
+    return stats;
+  }
+  stats.mean = sum / stats.valid;
+  // Two-pass variance as the exact reference.
+  double sq = 0.0;
+  for (int y = std::max(y0, 0); y < std::min(y1, image.height); ++y) {
+    for (int x = std::max(x0, 0); x < std::min(x1, image.width); ++x) {
+      const float d = image.Row(y)[x];
+      if (roi_projector::IsValidDepth(d)) {
+        sq += (d - stats.mean) * (d - stats.mean);
+      }
+    }
+  }
+  stats.variance = sq / stats.valid;
+  stats.valid_ratio = static_cast<double>(stats.valid) / stats.pixels;
+  return stats;
+}
+
+void CheckRandomFrames() {
+  std::mt19937 rng(9);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  DepthIntegral integral;
+  for (int frame = 0; frame < 6; ++frame) {
+    const int width = 150 + 37 * frame;
+    const int height = 70 + 61 * frame;
+    const size_t stride = static_cast<size_t>(width) + (frame % 2) * 5;
+    std::vector<float> data(stride * height, 2000.0f);
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        // Tilted surface with noise and clusters of holes.
+        float d = static_cast<float>(800.0 + 2.0 * x + 1.5 * y +
+                                     5.0 * unit(rng));
+        if ((x / 7 + y / 5) % 6 == 0 || unit(rng) < 0.05) {
+          const float holes[] = {0.0f, 0.05f, 6500.0f, nan};
+          d = holes[(x + y) % 4];
+        }
+        data[y * stride + x] = d;
+      }
+    }
+    DepthImageView image;
+    image.data = data.data();
+    image.width = width;
+    image.height = height;
+    image.row_stride = stride;
+
+    for (int threads : {1, 3, 8}) {
+      Expect(integral.Build(image, threads), "build failed");
+      for (int i = 0; i < 300; ++i) {
+        int x0 = static_cast<int>(unit(rng) * (width + 20)) - 10;
+        int x1 = static_cast<int>(unit(rng) * (width + 20)) - 10;
+        int y0 = static_cast<int>(unit(rng) * (height + 20)) - 10;
+        int y1 = static_cast<int>(unit(rng) * (height + 20)) - 10;
+        if (x0 > x1) {
+          std::swap(x0, x1);
+        }
+        if (y0 > y1) {
+          std::swap(y0, y1);
+        }
+        const DepthRectStats got = integral.Stats(x0, y0, x1, y1);
+        const DepthRectStats expected = Reference(image, x0, y0, x1, y1);
+        const bool match =
+            got.pixels == expected.pixels && got.valid == expected.valid &&
+            got.valid_ratio == expected.valid_ratio &&
+            std::fabs(got.mean - expected.mean) <= 1e-9 * expected.mean &&
+            std::fabs(got.variance - expected.variance) <= 1e-3;
+        if (!match) {
+          std::cerr << "frame " << frame << ", " << threads << " threads, ["
+                    << x0 << ", " << x1 << ") x [" << y0 << ", " << y1
+                    << "): valid " << got.valid << " / " << expected.valid
+                    << ", mean " << got.mean << " / " << expected.mean
+                    << ", variance " << got.variance << " / "
+                    << expected.variance << "\n";
+          ++failures;
+          return;
+        }
+      }
+    }
+  }
+}
+
+void CheckRoi() {
+  std::vector<float> data(100 * 80);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<float>(1000 + i % 100);  // depth = 1000 + x
+  }
+  DepthImageView image;
+  image.data = data.data();
+  image.width = 100;
+  image.height = 80;
+  DepthIntegral integral;
+  Expect(integral.Build(image, 1), "build failed");
+
+  // Pixel centres in [10.2, 19.8] x [5, 9]: columns 11..19, rows 5..9.
+  const std::array<roi_projector::Point2D, 4> roi = {
+      {{10.2, 5.0}, {19.8, 5.5}, {19.0, 9.0}, {11.0, 8.5}}};
+  const DepthRectStats stats = integral.BoundingBoxStats(roi);
+  Expect(stats.pixels == 45 && stats.valid == 45 && stats.mean == 1015.0 &&
+             std::fabs(stats.variance - 20.0 / 3.0) < 1e-9,
+         "roi bounding box");
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  Expect(integral.BoundingBoxStats({{{nan, 0}, {1, 0}, {1, 1}, {0, 1}}})
+                 .pixels == 0,
+         "non-finite roi");
+  Expect(integral.Stats(-50, -50, 500, 500).pixels == 100 * 80,
+         "clipping to the frame");
+
+  DepthImageView empty;
+  Expect(!integral.Build(empty) && integral.width() == 0 &&
+             integral.Stats(0, 0, 10, 10).pixels == 0,
+         "empty view accepted");
+}
+
+// Many builds on the same workers, with the band count changing between
+// them, and after the object (and so its workers) has moved: every build
+// must give the single-thread tables exactly.
+void CheckWorkerReuse() {
+  const int width = 97;
+  const int height = 600;
+  std::vector<float> data(static_cast<size_t>(width) * height);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = (i * 2654435761u) % 7 == 0 ? 0.0f
+                                          : 900.0f + static_cast<float>(i % 89);
+  }
+  DepthImageView image;
+  image.data = data.data();
+  image.width = width;
+  image.height = height;
+  DepthIntegral serial;
+  Expect(serial.Build(image, 1), "build failed");
+
+  DepthIntegral integral;
+  auto check = [&](int threads, const char* what) {
+    Expect(integral.Build(image, threads), "build failed");
+    for (int y = 0; y <= height; y += 7) {
+      for (int x = 0; x <= width; x += 3) {
+        const DepthRectStats a = integral.Stats(0, 0, x, y);
+        const DepthRectStats b = serial.Stats(0, 0, x, y);
+        if (a.valid != b.valid || a.mean != b.mean) {
+          Expect(false, what);
+          return;
+        }
+      }
+    }
+  };
+  for (int round = 0; round < 200; ++round) {
+    check(1 + round % 9, "worker reuse");
+  }
+  DepthIntegral moved = std::move(integral);
+  integral = std::move(moved);
+  check(8, "worker reuse after move");
+}
+
+}  // namespace
+
+int main() {
+  CheckRandomFrames();
+  CheckRoi();
+  CheckWorkerReuse();
+  std::cout << (failures == 0 ? "depth integral: ok\n"
+                              : "depth integral: FAILED\n");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+// Checks min/max depth pyramid queries against per-pixel scans, on every
+// kernel ISA this host supports.
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "depth_pyramid.h"
+
+namespace {
+
+using roi_projector::DepthBounds;
+using roi_projector::DepthImageView;
+using roi_projector::DepthPyramid;
+using roi_projector::KernelIsa;
+
+int failures = 0;
+
+void Expect(bool ok, const char* what) {
+  if (!ok) {
+    std::cerr << what << "\n";
+    ++failures;
+  }
+}
+
+// Min and max of the valid depths in [x0, x1) x [y0, y1), clipped.
+DepthBounds Scan(const DepthImageView& image, int x0, int y0, int x1,
+                 int y1) {
+  DepthBounds bounds;
+  float lo = std::numeric_limits<float>::infinity();
+  float hi = -std::numeric_limits<float>::infinity();
+  for (int y = std::max(y0, 0); y < std::min(y1, image.height); ++y) {
+    for (int x = std::max(x0, 0); x < std::min(x1, image.width); ++x) {
+      const float d = image.Row(y)[x];
+      if (roi_projector::IsValidDepth(d)) {
+        lo = std::min(lo, d);
+        hi = std::max(hi, d);
+      }
+    }
+  }
+  if (lo <= hi) {
+    bounds.ok = true;
+    bounds.z_min = lo;
+    bounds.z_max = hi;
+  }
+  return bounds;
+}
+
+// The pixels covered by the cells a query of a clipped, non-empty
+// [x0, x1) x [y0, y1) reads, as documented in depth_pyramid.h.
+DepthBounds ExpectedRange(const DepthImageView& image, int levels, int x0,
+                          int y0, int x1, int y1) {
+  // Level l cells are 2^(l + 1) pixels on a side.
+  int shift = 1;
+  while (shift < levels &&
+         (((x1 - 1) >> shift) - (x0 >> shift) >=
+              roi_projector::kDepthPyramidQueryCells ||
+          ((y1 - 1) >> shift) - (y0 >> shift) >=
+              roi_projector::kDepthPyramidQueryCells)) {
+    ++shift;
+  }
+  return Scan(image, (x0 >> shift) << shift, (y0 >> shift) << shift,
+              (((x1 - 1) >> shift) + 1) << shift,
+              (((y1 - 1) >> shift) + 1) << shift);
+}
+
+bool Same(const DepthBounds& a, const DepthBounds& b) {
+  return a.ok == b.ok && a.z_min == b.z_min && a.z_max == b.z_max;
+}
+
+void CheckRandomFrames() {
+  const KernelIsa original = roi_projector::ActiveKernelIsa();
+  const KernelIsa kIsas[] = {KernelIsa::kScalar, KernelIsa::kNeon,
+                             KernelIsa::kAvx2, KernelIsa::kAvx512};
+  std::mt19937 rng(20);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  DepthPyramid pyramid;
+  // Odd and even sizes, down to single rows and columns.
+  const int kSizes[][2] = {{1, 1},   {1, 37},   {45, 1},  {17, 9},
+                           {64, 64}, {203, 131}, {320, 77}};
+  for (size_t frame = 0; frame < std::size(kSizes); ++frame) {
+    const int width = kSizes[frame][0];
+    const int height = kSizes[frame][1];
+    const size_t stride = static_cast<size_t>(width) + (frame % 2) * 3;
+    std::vector<float> data(stride * height, -1.0f);
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        float d = static_cast<float>(900.0 + 3.0 * x - 2.0 * y +
+                                     40.0 * unit(rng));
+        if ((x / 9 + y / 4) % 5 == 0 || unit(rng) < 0.05) {
+          const float holes[] = {0.0f, 0.05f, 6500.0f, nan};
+          d = holes[(x + y) % 4];
+        }
+        data[y * stride + x] = d;
+      }
+    }
+    DepthImageView image;
+    image.data = data.data();
+    image.width = width;
+    image.height = height;
+    image.row_stride = stride;
+
+    struct Query {
+      int x0, y0, x1, y1;
+    };
+    std::vector<Query> queries;
+    for (int i = 0; i < 400; ++i) {
+      Query q;
+      q.x0 = static_cast<int>(unit(rng) * (width + 20)) - 10;
+      q.x1 = static_cast<int>(unit(rng) * (width + 20)) - 10;
+      q.y0 = static_cast<int>(unit(rng) * (height + 20)) - 10;
+      q.y1 = static_cast<int>(unit(rng) * (height + 20)) - 10;
+      if (q.x0 > q.x1) {
+        std::swap(q.x0, q.x1);
+      }
+      if (q.y0 > q.y1) {
+        std::swap(q.y0, q.y1);
+      }
+      queries.push_back(q);
+    }
+
+    // Every ISA must answer exactly as the scalar kernels do.
+    std::vector<DepthBounds> scalar;
+    for (KernelIsa isa : kIsas) {
+      if (!roi_projector::SetKernelIsa(isa)) {
+        continue;
+      }
+      Expect(pyramid.Build(image), "build failed");
+      for (size_t i = 0; i < queries.size(); ++i) {
+        const Query& q = queries[i];
+        const DepthBounds got = pyramid.Range(q.x0, q.y0, q.x1, q.y1);
+        if (isa == KernelIsa::kScalar) {
+          scalar.push_back(got);
+        } else if (!Same(got, scalar[i])) {
+          std::cerr << roi_projector::KernelIsaName(isa) << " frame "
+                    << frame << ": differs from scalar\n";
+          ++failures;
+          break;
+        }
+        const int x0 = std::max(q.x0, 0);
+        const int y0 = std::max(q.y0, 0);
+        const int x1 = std::min(q.x1, width);
+        const int y1 = std::min(q.y1, height);
+        const DepthBounds exact = Scan(image, x0, y0, x1, y1);
+        const DepthBounds expected =
+            x0 < x1 && y0 < y1
+                ? ExpectedRange(image, pyramid.levels(), x0, y0, x1, y1)
+                : DepthBounds{};
+        const bool contains = !exact.ok || (got.ok && got.z_min <=
+                                  exact.z_min && got.z_max >= exact.z_max);
+        if (!Same(got, expected) || !contains) {
+          std::cerr << roi_projector::KernelIsaName(isa) << " frame "
+                    << frame << ", [" << q.x0 << ", " << q.x1 << ") x ["
+                    << q.y0 << ", " << q.y1 << "): got " << got.ok << " "
+                    << got.z_min << ".." << got.z_max << ", expected "
+                    << expected.ok << " " << expected.z_min << ".."
+                    << expected.z_max << "\n";
+          ++failures;
+          break;
+        }
+      }
+    }
+  }
+  roi_projector::SetKernelIsa(original);
+}
+
+void CheckRoi() {
+  std::vector<float> data(100 * 80);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<float>(1000 + i % 100);  // depth = 1000 + x
+  }
+  DepthImageView image;
+  image.data = data.data();
+  image.width = 100;
+  image.height = 80;
+  DepthPyramid pyramid;
+  Expect(pyramid.Build(image) && pyramid.levels() == 7, "levels");
+
+  // Pixel centres in [10.2, 19.8] x [5, 9]: columns 11..19, rows 5..9,
+  // read as level 0 cells 5..9 x 2..4, i.e. columns 10..19.
+  const std::array<roi_projector::Point2D, 4> roi = {
+      {{10.2, 5.0}, {19.8, 5.5}, {19.0, 9.0}, {11.0, 8.5}}};
+  const DepthBounds bounds = pyramid.RoiRange(roi);
+  Expect(bounds.ok && bounds.z_min == 1010.0 && bounds.z_max == 1019.0,
+         "roi range");
+  const DepthBounds pixel = pyramid.Range(31, 30, 32, 31);
+  Expect(pixel.z_min == 1030.0 && pixel.z_max == 1031.0, "single pixel");
+  const DepthBounds all = pyramid.Range(-50, -50, 500, 500);
+  Expect(all.ok && all.z_min == 1000.0 && all.z_max == 1099.0,
+         "clipping to the frame");
+
+  std::fill(data.begin(), data.begin() + 100 * 40, 0.0f);
+  Expect(pyramid.Build(image) && !pyramid.Range(0, 0, 100, 20).ok,
+         "holes only");
+
+  DepthImageView empty;
+  Expect(!pyramid.Build(empty) && pyramid.levels() == 0 &&
+             !pyramid.Range(0, 0, 10, 10).ok,
+         "empty view accepted");
+}
+
+}  // namespace
+
+int main() {
+  CheckRandomFrames();
+  CheckRoi();
+  std::cout << (failures == 0 ? "depth pyramid: ok\n"
+                              : "depth pyramid: FAILED\n");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,306 @@
+// Checks depth sampling against a brute-force reference and the one-call
+// ROI projection built on it.
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "depth_sampler.h"
+
+namespace {
+
+using roi_projector::DepthImageView;
+using roi_projector::DepthSample;
+using roi_projector::DepthSampleOptions;
+using roi_projector::DepthSource;
+using roi_projector::Point2D;
+
+int failures = 0;
+
+void Expect(bool ok, const char* what) {
+  if (!ok) {
+    std::cerr << what << "\n";
+    ++failures;
+  }
+}
+
+bool Valid(float d) {
+  return d >= roi_projector::kMinValidDepth &&
+         d <= roi_projector::kMaxValidDepth;
+}
+
+// Straightforward version of SampleDepth; for the nearest-pixel fallback it
+// returns every depth that ties for nearest.
+std::vector<float> Reference(const DepthImageView& image, double u, double v,
+                             const DepthSampleOptions& options,
+                             DepthSource& source, int& valid_pixels) {
+  const size_t stride = image.row_stride != 0
+                            ? image.row_stride
+                            : static_cast<size_t>(image.width);
+  auto at = [&](int x, int y) { return image.data[y * stride + x]; };
+  const int cx = static_cast<int>(std::floor(u + 0.5));
+  const int cy = static_cast<int>(std::floor(v + 0.5));
+  const int r = options.window_radius;
+  std::vector<float> window;
+  for (int y = cy - r; y <= cy + r; ++y) {
+    for (int x = cx - r; x <= cx + r; ++x) {
+      if (x >= 0 && x < image.width && y >= 0 && y < image.height &&
+          Valid(at(x, y))) {
+        window.push_back(at(x, y));
+      }
+    }
+  }
+  valid_pixels = static_cast<int>(window.size());
+  if (!window.empty() && valid_pixels >= options.min_valid) {
+    std::sort(window.begin(), window.end());
+    const size_t k = static_cast<size_t>(
+        options.percentile * (window.size() - 1) + 0.5);
+    source = DepthSource::kWindow;
+    return {window[k]};
+  }
+  int best_ring = std::numeric_limits<int>::max();
+  double best_dist = std::numeric_limits<double>::infinity();
+  std::vector<float> nearest;
+  for (int y = 0; y < image.height; ++y) {
+    for (int x = 0; x < image.width; ++x) {
+      const int ring = std::max(std::abs(x - cx), std::abs(y - cy));
+      if (!Valid(at(x, y)) || options.fallback_radius <= 0 ||
+          ring > options.fallback_radius) {
+        continue;
+      }
+      const double dist = (x - u) * (x - u) + (y - v) * (y - v);
+      if (ring < best_ring || (ring == best_ring && dist < best_dist)) {
+        best_ring = ring;
+        best_dist = dist;
+        nearest.assign(1, at(x, y));
+      } else if (ring == best_ring && dist == best_dist) {
+        nearest.push_back(at(x, y));
+      }
+    }
+  }
+  source = nearest.empty() ? DepthSource::kNone : DepthSource::kNearest;
+  return nearest;
+}
+
+void CheckAgainstReference() {
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  for (int frame = 0; frame < 40; ++frame) {
+    // Odd widths and padded rows exercise the SIMD tails; the padding
+    // holds valid depths that must never be read.
+    const int width = 13 + frame % 29;
+    const int height = 9 + frame % 17;
+    const size_t stride = static_cast<size_t>(width) + (frame % 3) * 3;
+    std::vector<float> data(stride * height, 4321.0f);
+    const double hole_rate = 0.2 + 0.75 * unit(rng);
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        float& d = data[y * stride + x];
+        const double pick = unit(rng);
+        if (pick < hole_rate) {
+          const float holes[] = {0.0f, 0.05f, -1.0f, 6000.5f, nan};
+          d = holes[static_cast<size_t>(unit(rng) * 5) % 5];
+        } else {
+          d = static_cast<float>(500.0 + 1000.0 * unit(rng));
+        }
+      }
+    }
+    DepthImageView image;
+    image.data = data.data();
+    image.width = width;
+    image.height = height;
+    image.row_stride = stride == static_cast<size_t>(width) ? 0 : stride;
+
+    for (int i = 0; i < 200; ++i) {
+      DepthSampleOptions options;
+      options.window_radius = static_cast<int>(unit(rng) * 8);
+      options.percentile = unit(rng);
+      options.min_valid = static_cast<int>(unit(rng) * 6);
+      // Now and then a radius far beyond the frame, which is clamped.
+      options.fallback_radius = i % 16 == 0
+                                    ? std::numeric_limits<int>::max()
+                                    : static_cast<int>(unit(rng) * 12);
+      const double u = -6.0 + (width + 12) * unit(rng);
+      const double v = -6.0 + (height + 12) * unit(rng);
+      const DepthSample got = roi_projector::SampleDepth(image, u, v, options);
+      DepthSource source;
+      int valid_pixels;
+      const std::vector<float> expected =
+          Reference(image, u, v, options, source, valid_pixels);
+      const bool match =
+          got.source == source && got.valid_pixels == valid_pixels &&
+          (source == DepthSource::kNone
+               ? got.depth == 0.0
+               : std::find(expected.begin(), expected.end(),
+                           static_cast<float>(got.depth)) != expected.end());
+      if (!match) {
+        std::cerr << "frame " << frame << " sample (" << u << ", " << v
+                  << "): got " << got.depth << " from source "
+                  << static_cast<int>(got.source) << ", expected source "
+                  << static_cast<int>(source) << "\n";
+        ++failures;
+        return;
+      }
+    }
+  }
+}
+
+void CheckEdgeCases() {
+  std::vector<float> data(10 * 10, 0.0f);
+  DepthImageView image;
+  image.data = data.data();
+  image.width = 10;
+  image.height = 10;
+  DepthSampleOptions options;
+
+  // All holes: nothing, even with the fallback.
+  DepthSample sample = roi_projector::SampleDepth(image, 5, 5, options);
+  Expect(sample.source == DepthSource::kNone && sample.depth == 0.0,
+         "all holes");
+
+  // A lone valid pixel: below min_valid, so the fallback finds it.
+  data[2 * 10 + 8] = 1234.0f;
+  sample = roi_projector::SampleDepth(image, 5, 5, options);
+  Expect(sample.source == DepthSource::kNearest && sample.depth == 1234.0f,
+         "nearest valid");
+  options.fallback_radius = 2;
+  Expect(roi_projector::SampleDepth(image, 5, 5, options).source ==
+             DepthSource::kNone,
+         "fallback radius not honoured");
+
+  // Median of a full window; extremes of the percentile range.
+  for (int i = 0; i < 100; ++i) {
+    data[i] = 1000.0f + i;
+  }
+  options = DepthSampleOptions();
+  options.window_radius = 1;
+  Expect(roi_projector::SampleDepth(image, 4.4, 5.6, options).depth == 1064.0,
+         "median");
+  options.percentile = 0.0;
+  Expect(roi_projector::SampleDepth(image, 4.4, 5.6, options).depth == 1053.0,
+         "minimum");
+  options.percentile = 1.0;
+  Expect(roi_projector::SampleDepth(image, 4.4, 5.6, options).depth == 1075.0,
+         "maximum");
+
+  // A point outside the frame still reaches it through the fallback.
+  options = DepthSampleOptions();
+  sample = roi_projector::SampleDepth(image, -8.0, 3.0, options);
+  Expect(sample.source == DepthSource::kNearest && sample.depth == 1030.0,
+         "outside the frame");
+  Expect(roi_projector::SampleDepth(image, std::nan(""), 3.0, options)
+                 .source == DepthSource::kNone,
+         "non-finite point");
+  image.row_stride = 5;
+  Expect(roi_projector::SampleDepth(image, 5, 5, options).source ==
+             DepthSource::kNone,
+         "row stride below width");
+  image.row_stride = 0;
+
+  // Radii up to INT_MAX stop at the frame: all holes find nothing, a lone
+  // pixel in the far corner is found, also from a point far outside the
+  // frame and from one whose coordinates hit the ±2^30 clamp.
+  std::fill(data.begin(), data.end(), 0.0f);
+  options = DepthSampleOptions();
+  options.fallback_radius = std::numeric_limits<int>::max();
+  Expect(roi_projector::SampleDepth(image, 0, 0, options).source ==
+             DepthSource::kNone,
+         "huge radius, all holes");
+  data[9 * 10 + 9] = 2222.0f;
+  for (const Point2D& p : {Point2D{0, 0}, Point2D{-5e6, 3e6},
+                           Point2D{1e300, -1e300}}) {
+    sample = roi_projector::SampleDepth(image, p.u, p.v, options);
+    Expect(sample.source == DepthSource::kNearest && sample.depth == 2222.0,
+           "huge radius, far corner");
+  }
+  // A 1x1 frame: the only pixel is the centre ring.
+  const float one = 1500.0f;
+  DepthImageView single;
+  single.data = &one;
+  single.width = 1;
+  single.height = 1;
+  options.min_valid = 2;
+  sample = roi_projector::SampleDepth(single, 0, 0, options);
+  Expect(sample.source == DepthSource::kNearest && sample.depth == 1500.0,
+         "single pixel frame");
+}
+
+void CheckProjectRoi(const roi_projector::Projector& projector) {
+  constexpr int kWidth = 1920;
+  constexpr int kHeight = 1200;
+  // Tilted plane, 900 mm at the top rising to 1300 mm at the bottom, with
+  // a hole around the third corner.
+  std::vector<float> data(static_cast<size_t>(kWidth) * kHeight);
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      data[y * kWidth + x] = 900.0f + 400.0f * y / kHeight;
+    }
+  }
+  const std::array<Point2D, 4> roi = {
+      {{400.0, 300.0}, {1500.0, 320.0}, {1480.0, 900.0}, {420.0, 880.0}}};
+  for (int y = 870; y <= 940; ++y) {
+    for (int x = 1440; x <= 1520; ++x) {
+      data[y * kWidth + x] = 0.0f;
+    }
+  }
+  DepthImageView image;
+  image.data = data.data();
+  image.width = kWidth;
+  image.height = kHeight;
+
+  DepthSampleOptions options;
+  options.fallback_radius = 60;
+  const roi_projector::DepthRoiResult result =
+      roi_projector::ProjectRoiFromDepth(projector, image, roi, options);
+  std::array<roi_projector::Point3D, 4> corners{};
+  for (size_t i = 0; i < 4; ++i) {
+    corners[i] = {roi[i].u, roi[i].v, result.depths[i].depth};
+  }
+  const roi_projector::CornersResult expected =
+      projector.ProjectCorners(corners);
+  Expect(result.corners.ok && expected.ok, "roi: failed");
+  Expect(result.depths[0].source == DepthSource::kWindow &&
+             result.depths[0].depth == data[300 * kWidth + 400],
+         "roi: corner 0 depth");
+  Expect(result.depths[2].source == DepthSource::kNearest &&
+             result.depths[2].depth == data[869 * kWidth + 1480],
+         "roi: corner 2 fallback depth");
+  for (size_t i = 0; i < 4; ++i) {
+    Expect(result.corners.points[i].u == expected.points[i].u &&
+               result.corners.points[i].v == expected.points[i].v,
+           "roi: differs from ProjectCorners");
+  }
+
+  options.fallback_radius = 0;
+  const roi_projector::DepthRoiResult missing =
+      roi_projector::ProjectRoiFromDepth(projector, image, roi, options);
+  Expect(!missing.corners.ok &&
+             missing.corners.status ==
+                 roi_projector::ProjectStatus::kInvalidDepth &&
+             missing.corners.failed_corner == 2 &&
+             missing.depths[3].source == DepthSource::kWindow,
+         "roi: missing depth not reported");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string calib_path = (argc > 1) ? argv[1] : "test/calib_out.json";
+  roi_projector::Projector projector;
+  if (!projector.LoadCalibration(calib_path)) {
+    std::cerr << "Failed to load calibration: " << calib_path << "\n";
+    return 1;
+  }
+  CheckAgainstReference();
+  CheckEdgeCases();
+  CheckProjectRoi(projector);
+  std::cout << (failures == 0 ? "depth sampler: ok\n"
+                              : "depth sampler: FAILED\n");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,338 @@
+// Checks every available projection kernel, and the compile-time
+// specialized projectors for every distortion model, against the scalar
+// kernel.
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "basic_projector.h"
+#include "projection_kernel.h"
+#include "roi_projector.h"
+
+namespace {
+
+using roi_projector::KernelIsa;
+using roi_projector::ProjectStatus;
+
+// Returns the number of kernels that disagree with the scalar kernel.
+int CheckKernels(const roi_projector::Projector& projector) {
+  // Odd count so every kernel also runs its padded tail; includes invalid
+  // depths so the status lanes are exercised.
+  constexpr size_t kPoints = 1001;
+  std::vector<double> u(kPoints), v(kPoints), z(kPoints);
+  for (size_t i = 0; i < kPoints; ++i) {
+    u[i] = static_cast<double>((i * 37) % 1920);
+    v[i] = static_cast<double>((i * 53) % 1200);
+    z[i] = (i % 97 == 0) ? 0.0 : 500.0 + static_cast<double>((i * 11) % 1500);
+  }
+  z[5] = NAN;
+
+  std::vector<double> ref_u(kPoints), ref_v(kPoints);
+  std::vector<ProjectStatus> ref_status(kPoints);
+  std::vector<uint8_t> ref_iterations(kPoints);
+  roi_projector::SetKernelIsa(KernelIsa::kScalar);
+  projector.ProjectPoints(u.data(), v.data(), z.data(), kPoints, ref_u.data(),
+                          ref_v.data(), ref_status.data(),
+                          ref_iterations.data());
+
+  int failures = 0;
+  const KernelIsa kAll[] = {KernelIsa::kNeon, KernelIsa::kAvx2,
+                            KernelIsa::kAvx512};
+  for (KernelIsa isa : kAll) {
+    if (!roi_projector::SetKernelIsa(isa)) {
+      std::cout << roi_projector::KernelIsaName(isa) << ": skipped\n";
+      continue;
+    }
+    std::vector<double> out_u(kPoints), out_v(kPoints);
+    std::vector<ProjectStatus> status(kPoints);
+    std::vector<uint8_t> iterations(kPoints);
+    projector.ProjectPoints(u.data(), v.data(), z.data(), kPoints,
+                            out_u.data(), out_v.data(), status.data(),
+                            iterations.data());
+    for (size_t i = 0; i < kPoints; ++i) {
+      const bool status_ok = status[i] == ref_status[i] &&
+                             iterations[i] == ref_iterations[i];
+      const bool both_nan = std::isnan(out_u[i]) && std::isnan(ref_u[i]);
+      const bool close =
+          both_nan ||
+          (std::fabs(out_u[i] - ref_u[i]) <=
+               roi_projector::detail::kKernelTolerancePx &&
+           std::fabs(out_v[i] - ref_v[i]) <=
+               roi_projector::detail::kKernelTolerancePx);
+      if (!status_ok || !close) {
+        std::cerr << roi_projector::KernelIsaName(isa) << ": point " << i
+                  << " differs from scalar\n";
+        ++failures;
+        break;
+      }
+    }
+    std::cout << roi_projector::KernelIsaName(isa) << ": checked\n";
+  }
+  return failures;
+}
+
+// Float specializations round the pose and intrinsics to 24-bit mantissas.
+constexpr double kFloatTolerancePx = 0.05;
+
+bool UndistortOutcome(ProjectStatus status) {
+  return status == ProjectStatus::kOk ||
+         status == ProjectStatus::kUndistortDiverged;
+}
+
+// Returns the number of specialized projectors that disagree with the
+// scalar kernel or are not the `models` ("camera1/camera2") specialization.
+int CheckSpecialized(const roi_projector::Projector& projector,
+                     const std::string& models) {
+  constexpr size_t kPoints = 1001;
+  std::vector<roi_projector::Point3D> pts(kPoints);
+  for (size_t i = 0; i < kPoints; ++i) {
+    pts[i].u = static_cast<double>((i * 37) % 1920);
+    pts[i].v = static_cast<double>((i * 53) % 1200);
+    pts[i].z =
+        (i % 97 == 0) ? 0.0 : 500.0 + static_cast<double>((i * 11) % 1500);
+  }
+
+  std::vector<roi_projector::Point2D> ref(kPoints);
+  std::vector<ProjectStatus> ref_status(kPoints);
+  roi_projector::SetKernelIsa(KernelIsa::kScalar);
+  projector.ProjectPoints(pts.data(), kPoints, ref.data(), ref_status.data());
+
+  int failures = 0;
+  for (bool use_float : {false, true}) {
+    const auto handle =
+        roi_projector::MakeSpecializedProjector(projector, use_float);
+    if (handle == nullptr) {
+      std::cerr << "MakeSpecializedProjector failed\n";
+      ++failures;
+      continue;
+    }
+    const std::string expected =
+        std::string(use_float ? "float/" : "double/") + models;
+    if (handle->Name() != expected) {
+      std::cerr << handle->Name() << ": expected " << expected << "\n";
+      ++failures;
+      continue;
+    }
+    const double tolerance = use_float
+                                 ? kFloatTolerancePx
+                                 : roi_projector::detail::kKernelTolerancePx;
+    std::vector<roi_projector::Point2D> out(kPoints);
+    std::vector<ProjectStatus> status(kPoints);
+    handle->ProjectPoints(pts.data(), kPoints, out.data(), status.data());
+    for (size_t i = 0; i < kPoints; ++i) {
+      // Float solves to a looser tolerance, so near the edge of
+      // convergence it may disagree on kOk vs kUndistortDiverged.
+      const bool both_ok = status[i] == ProjectStatus::kOk &&
+                           ref_status[i] == ProjectStatus::kOk;
+      const bool status_ok =
+          status[i] == ref_status[i] ||
+          (use_float && UndistortOutcome(status[i]) &&
+           UndistortOutcome(ref_status[i]));
+      const bool close = !both_ok ||
+                         (std::fabs(out[i].u - ref[i].u) <= tolerance &&
+                          std::fabs(out[i].v - ref[i].v) <= tolerance);
+      if (!status_ok || !close) {
+        std::cerr << handle->Name() << ": point " << i
+                  << " differs from scalar\n";
+        ++failures;
+        break;
+      }
+    }
+    std::cout << handle->Name() << ": checked\n";
+  }
+  return failures;
+}
+
+// Distortion of one camera in a calibration variant.
+enum class Distortion { kNone, kRadial, kTangential, kFull };
+
+// Specialization MakeSpecializedProjector picks for `kind`.
+const char* ModelName(Distortion kind) {
+  switch (kind) {
+    case Distortion::kNone:
+      return "none";
+    case Distortion::kRadial:
+      return "radial";
+    case Distortion::kTangential:
+    case Distortion::kFull:
+      break;
+  }
+  return "brown-conrady";
+}
+
+// `dist` (k1,k2,p1,p2,k3) as a JSON array, keeping only the terms of `kind`.
+std::string DistortionJson(const double dist[5], Distortion kind) {
+  const bool radial = kind == Distortion::kRadial || kind == Distortion::kFull;
+  const bool tangential =
+      kind == Distortion::kTangential || kind == Distortion::kFull;
+  std::string out = "[";
+  for (size_t i = 0; i < 5; ++i) {
+    const bool keep = (i == 2 || i == 3) ? tangential : radial;
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.17g", keep ? dist[i] : 0.0);
+    out += std::string(i == 0 ? "" : ", ") + text;
+  }
+  return out + "]";
+}
+
+// Replaces the array value of `key` in `json`.
+bool ReplaceArray(std::string& json, const std::string& key,
+                  const std::string& value) {
+  const size_t key_pos = json.find("\"" + key + "\"");
+  const size_t begin = json.find('[', key_pos);
+  if (key_pos == std::string::npos || begin == std::string::npos) {
+    return false;
+  }
+  int depth = 0;
+  for (size_t end = begin; end < json.size(); ++end) {
+    depth += json[end] == '[' ? 1 : json[end] == ']' ? -1 : 0;
+    if (depth == 0) {
+      json.replace(begin, end + 1 - begin, value);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Runs CheckKernels and CheckSpecialized on copies of the calibration with
+// each camera's distortion cut down to none, radial, tangential or all
+// terms, so every specialization is compared with the scalar kernel.
+int CheckDistortionModels(const std::string& calib_path) {
+  roi_projector::Projector base;
+  std::ifstream in(calib_path, std::ios::binary);
+  std::ostringstream text;
+  text << in.rdbuf();
+  if (!base.LoadCalibration(calib_path) || !in) {
+    std::cerr << "models: cannot read " << calib_path << "\n";
+    return 1;
+  }
+  const roi_projector::CompiledCalibration& c = base.compiled_calibration();
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() /
+      "test_projection_kernels_variant.json";
+  const Distortion kAll[] = {Distortion::kNone, Distortion::kRadial,
+                             Distortion::kTangential, Distortion::kFull};
+  int failures = 0;
+  for (Distortion dist1 : kAll) {
+    for (Distortion dist2 : kAll) {
+      std::string json = text.str();
+      const bool replaced =
+          ReplaceArray(json, "camera1_distortion",
+                       DistortionJson(c.dist1, dist1)) &&
+          ReplaceArray(json, "camera2_distortion",
+                       DistortionJson(c.dist2, dist2));
+      std::ofstream(path, std::ios::binary) << json;
+      roi_projector::Projector projector;
+      if (!replaced || !projector.LoadCalibration(path.string())) {
+        std::cerr << "models: cannot load variant\n";
+        ++failures;
+        continue;
+      }
+      const std::string models =
+          std::string(ModelName(dist1)) + "/" + ModelName(dist2);
+      std::cout << "models " << models << "\n";
+      failures += CheckKernels(projector);
+      failures += CheckSpecialized(projector, models);
+    }
+  }
+  std::filesystem::remove(path);
+  return failures;
+}
+
+// A loaded table must not change kBalanced or kExact results: both solve
+// every point, bit for bit as without a table. kFast takes the table when
+// its measured residual meets the mode's tolerance, with 0 steps on hits.
+int CheckModesWithTable(const std::string& calib_path) {
+  roi_projector::UndistortLutOptions no_lut;
+  no_lut.enabled = false;
+  roi_projector::Projector with_table;
+  roi_projector::Projector without_table;
+  // Only kFast builds the table; it is kept on leaving kFast.
+  with_table.SetUndistortMode(roi_projector::UndistortMode::kFast);
+  if (!with_table.LoadCalibration(calib_path) ||
+      !without_table.LoadCalibration(calib_path, no_lut) ||
+      with_table.undistort_lut() == nullptr) {
+    std::cerr << "modes: no table built\n";
+    return 1;
+  }
+  std::vector<roi_projector::Point3D> pts;
+  for (double v = 0.5; v < 1200; v += 37.3) {
+    for (double u = 0.5; u < 1920; u += 41.7) {
+      pts.push_back({u, v, 900.0});
+    }
+  }
+  const size_t n = pts.size();
+  int failures = 0;
+  for (auto mode : {roi_projector::UndistortMode::kBalanced,
+                    roi_projector::UndistortMode::kExact}) {
+    with_table.SetUndistortMode(mode);
+    without_table.SetUndistortMode(mode);
+    std::vector<roi_projector::Point2D> a(n), b(n);
+    std::vector<ProjectStatus> sa(n), sb(n);
+    std::vector<uint8_t> ia(n), ib(n);
+    with_table.ProjectPoints(pts.data(), n, a.data(), sa.data(), ia.data());
+    without_table.ProjectPoints(pts.data(), n, b.data(), sb.data(), ib.data());
+    auto same_value = [](double x, double y) {
+      return x == y || (std::isnan(x) && std::isnan(y));
+    };
+    bool same = with_table.compiled_calibration().lut1 == nullptr;
+    size_t solved = 0;
+    for (size_t i = 0; same && i < n; ++i) {
+      same = sa[i] == sb[i] && ia[i] == ib[i] &&
+             same_value(a[i].u, b[i].u) && same_value(a[i].v, b[i].v);
+      solved += ia[i] > 0 ? 1 : 0;
+    }
+    if (!same || solved == 0) {
+      std::cerr << "modes: table changed the "
+                << (mode == roi_projector::UndistortMode::kExact ? "exact"
+                                                                 : "balanced")
+                << " solve\n";
+      ++failures;
+    }
+  }
+
+  with_table.SetUndistortMode(roi_projector::UndistortMode::kFast);
+  const bool fits = with_table.undistort_lut()->max_residual < 1e-6;
+  if ((with_table.compiled_calibration().lut1 != nullptr) != fits || !fits) {
+    std::cerr << "modes: fast mode does not use a table of residual "
+              << with_table.undistort_lut()->max_residual << "\n";
+    ++failures;
+  }
+  std::cout << "modes with table: checked (table residual "
+            << with_table.undistort_lut()->max_residual << ")\n";
+  return failures;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string calib_path = (argc > 1) ? argv[1] : "test/calib_out.json";
+
+  // Once with the undistortion table and once with the Newton solve only.
+  int failures = 0;
+  for (bool use_lut : {true, false}) {
+    roi_projector::UndistortLutOptions options;
+    options.enabled = use_lut;
+    roi_projector::Projector projector;
+    // Only kFast builds and projects through the table.
+    projector.SetUndistortMode(use_lut ? roi_projector::UndistortMode::kFast
+                                       : roi_projector::UndistortMode::kBalanced);
+    if (!projector.LoadCalibration(calib_path, options)) {
+      std::cerr << "Failed to load calibration: " << calib_path << "\n";
+      return 1;
+    }
+    std::cout << (use_lut ? "with table\n" : "without table\n");
+    failures += CheckKernels(projector);
+    failures += CheckSpecialized(projector, "brown-conrady/brown-conrady");
+  }
+  failures += CheckDistortionModels(calib_path);
+  failures += CheckModesWithTable(calib_path);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+// Checks RoiAssigner against brute-force scoring of every ROI/barcode pair.
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "roi_assigner.h"
+
+namespace {
+
+using roi_projector::Quad;
+
+Quad Box(double u, double v, double w, double h, double skew) {
+  return {{{u, v}, {u + w, v + skew}, {u + w - skew, v + h}, {u, v + h}}};
+}
+
+// Finite quads added to the scene beyond the barcode grid.
+enum class FarQuads {
+  kNone,
+  // Off-grid ROIs and barcodes, and ROIs with a corner so far out that its
+  // grid cell does not fit in an int.
+  kRois,
+  // As kRois plus a barcode with such a corner, which stretches the grid.
+  kRoisAndBarcodes,
+};
+
+// Deterministic layout: a few large ROIs and many small barcodes, some
+// inside ROIs, some straddling, some far away, plus one non-finite.
+void MakeScene(size_t roi_count, size_t barcode_count, FarQuads far_quads,
+               std::vector<Quad>& rois, std::vector<Quad>& barcodes) {
+  rois.clear();
+  barcodes.clear();
+  for (size_t i = 0; i < roi_count; ++i) {
+    const double u = 150.0 * static_cast<double>(i % 8) + 13.0 * (i / 8);
+    const double v = 170.0 * static_cast<double>(i / 8);
+    rois.push_back(Box(u, v, 160.0, 120.0, 6.0));
+  }
+  for (size_t i = 0; i < barcode_count; ++i) {
+    const double u = static_cast<double>((i * 97) % 1300) - 50.0;
+    const double v = static_cast<double>((i * 61) % 1450) - 40.0;
+    barcodes.push_back(Box(u, v, 30.0 + (i % 7), 18.0 + (i % 5), 2.0));
+  }
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  barcodes.push_back({{{nan, 0}, {1, 0}, {1, 1}, {0, 1}}});
+  if (far_quads != FarQuads::kNone) {
+    rois.push_back(Box(-5000.0, -4000.0, 200.0, 150.0, 0.0));
+    rois.push_back(Box(9000.0, 8000.0, 200.0, 150.0, 0.0));
+    rois.push_back({{{100, 100}, {1e13, 120}, {1e13, 1e13}, {90, 300}}});
+    rois.push_back({{{-1e13, -1e13}, {300, 80}, {310, 260}, {80, 250}}});
+    barcodes.push_back(Box(-8000.0, -7000.0, 30.0, 20.0, 0.0));
+  }
+  if (far_quads == FarQuads::kRoisAndBarcodes) {
+    barcodes.push_back({{{120, 140}, {1e13, 150}, {1e13, 160}, {110, 170}}});
+  }
+}
+
+int Check(const roi_projector::RoiAssignerOptions& options, size_t roi_count,
+          size_t barcode_count, roi_projector::RoiAssigner& assigner,
+          FarQuads far_quads = FarQuads::kNone) {
+  std::vector<Quad> rois;
+  std::vector<Quad> barcodes;
+  MakeScene(roi_count, barcode_count, far_quads, rois, barcodes);
+  roi_projector::RoiAssignment result;
+  assigner.Assign(rois.data(), rois.size(), barcodes.data(), barcodes.size(),
+                  result);
+
+  int failures = 0;
+  std::vector<bool> roi_used(rois.size(), false);
+  size_t unmatched = 0;
+  for (size_t b = 0; b < barcodes.size(); ++b) {
+    int best = -1;
+    double best_coverage = 0.0;
+    for (size_t r = 0; r < rois.size(); ++r) {
+      const double c = roi_projector::CoverageRoi(rois[r]).Coverage(barcodes[b]);
+      if (c > options.threshold && c > best_coverage) {
+        best = static_cast<int>(r);
+        best_coverage = c;
+      }
+    }
+    if (result.roi_for_barcode[b] != best ||
+        result.coverage[b] != best_coverage) {
+      std::cerr << "barcode " << b << ": got roi " << result.roi_for_barcode[b]
+                << ", expected " << best << "\n";
+      ++failures;
+    }
+    if (best < 0) {
+      ++unmatched;
+    } else {
+      roi_used[static_cast<size_t>(best)] = true;
+    }
+  }
+  size_t unused = 0;
+  for (bool used : roi_used) {
+    unused += used ? 0 : 1;
+  }
+  if (result.unmatched_barcodes.size() != unmatched ||
+      result.unmatched_rois.size() != unused) {
+    std::cerr << "unmatched lists disagree\n";
+    ++failures;
+  }
+  std::cout << roi_count << " x " << barcodes.size() << ": "
+            << (barcodes.size() - unmatched) << " matched, "
+            << assigner.last_candidate_count() << " candidates\n";
+  return failures;
+}
+
+}  // namespace
+
+int main() {
+  int failures = 0;
+  for (double threshold : {0.8, 0.3}) {
+    for (double cell_size : {0.0, 7.0, 500.0}) {
+      roi_projector::RoiAssignerOptions options;
+      options.threshold = threshold;
+      options.cell_size = cell_size;
+      roi_projector::RoiAssigner assigner(options);
+      // Reused assigner, shrinking and growing input.
+      failures += Check(options, 64, 512, assigner);
+      failures += Check(options, 3, 10, assigner);
+      failures += Check(options, 0, 5, assigner);
+      failures += Check(options, 16, 0, assigner);
+      failures += Check(options, 64, 512, assigner);
+      // Off-grid and huge-coordinate quads must be clamped to the grid.
+      failures += Check(options, 16, 64, assigner, FarQuads::kRois);
+      failures +=
+          Check(options, 16, 64, assigner, FarQuads::kRoisAndBarcodes);
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
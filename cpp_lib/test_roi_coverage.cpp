@@ -0,0 +1,260 @@
+// Checks coverage scores against shapes with known areas.
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "roi_coverage.h"
+
+namespace {
+
+using roi_projector::Point2D;
+using roi_projector::Quad;
+
+// Axis-aligned rectangle, wound clockwise on screen (v down) so its
+// interior is on the inside of every edge (cross(b - a, p - a) >= 0).
+Quad Rect(double u0, double v0, double u1, double v1) {
+  return {{{u0, v0}, {u1, v0}, {u1, v1}, {u0, v1}}};
+}
+
+int failures = 0;
+
+void ExpectNear(const char* what, double actual, double expected) {
+  if (!(std::fabs(actual - expected) <= 1e-12)) {
+    std::cerr << what << ": got " << actual << ", expected " << expected
+              << "\n";
+    ++failures;
+  }
+}
+
+// Each cheap tier decides the case it is meant for, with the same score as
+// clipping would give.
+void CheckTiers(const roi_projector::CoverageRoi& prepared) {
+  using roi_projector::CoverageTier;
+  struct Case {
+    const char* what;
+    Quad barcode;
+    CoverageTier tier;
+    double coverage;
+  };
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const Case kCases[] = {
+      {"invalid", {{{nan, 0}, {0, 10}, {10, 10}, {10, 0}}},
+       CoverageTier::kInvalid, 0.0},
+      {"bounding box", Rect(110, 10, 140, 40), CoverageTier::kBoundingBox,
+       0.0},
+      {"contained", Rect(10, 10, 40, 40), CoverageTier::kContained, 1.0},
+      {"contained, sharing an edge", Rect(0, 10, 30, 40),
+       CoverageTier::kContained, 1.0},
+      // Square rotated 45 degrees beyond the ROI's bottom-right corner; its
+      // bounding box overlaps the ROI's.
+      {"separated", {{{95, 115}, {115, 95}, {125, 105}, {105, 125}}},
+       CoverageTier::kSeparated, 0.0},
+      {"clipped", Rect(90, 10, 120, 40), CoverageTier::kClipped, 1.0 / 3.0},
+  };
+  for (const Case& c : kCases) {
+    roi_projector::ResetCoverageTierStats();
+    ExpectNear(c.what, prepared.Coverage(c.barcode), c.coverage);
+    const roi_projector::CoverageTierStats stats =
+        roi_projector::GetCoverageTierStats();
+    for (size_t i = 0; i < roi_projector::kCoverageTierCount; ++i) {
+      const uint64_t expected = i == static_cast<size_t>(c.tier) ? 1 : 0;
+      if (stats.calls[i] != expected) {
+        std::cerr << c.what << ": "
+                  << roi_projector::CoverageTierName(
+                         static_cast<CoverageTier>(i))
+                  << " count " << stats.calls[i] << ", expected " << expected
+                  << "\n";
+        ++failures;
+      }
+    }
+  }
+
+  // Counts of threads that have exited are kept.
+  roi_projector::ResetCoverageTierStats();
+  std::thread worker([&] {
+    for (int i = 0; i < 10; ++i) {
+      prepared.Coverage(Rect(10, 10, 40, 40));
+    }
+  });
+  worker.join();
+  prepared.Coverage(Rect(10, 10, 40, 40));
+  const uint64_t contained = roi_projector::GetCoverageTierStats()
+      .calls[static_cast<size_t>(CoverageTier::kContained)];
+  if (contained != 11) {
+    std::cerr << "contained count across threads " << contained
+              << ", expected 11\n";
+    ++failures;
+  }
+}
+
+// Convex quad: four sorted angles on a rotated ellipse.
+Quad RandomConvexQuad(std::mt19937& rng, double cu, double cv) {
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  const double two_pi = 6.283185307179586;
+  double angles[4];
+  for (double& a : angles) {
+    a = two_pi * unit(rng);
+  }
+  std::sort(angles, angles + 4);
+  const double ru = 5.0 + 60.0 * unit(rng);
+  const double rv = 5.0 + 60.0 * unit(rng);
+  const double tilt = two_pi * unit(rng);
+  Quad quad;
+  for (size_t k = 0; k < 4; ++k) {
+    const double x = ru * std::cos(angles[k]);
+    const double y = rv * std::sin(angles[k]);
+    quad[k] = {cu + x * std::cos(tilt) - y * std::sin(tilt),
+               cv + x * std::sin(tilt) + y * std::cos(tilt)};
+  }
+  return quad;
+}
+
+// ComputePairCoverage on every supported kernel against CoverageRoi,
+// including pairs the kernels hand back to the scalar path.
+void CheckPairCoverage(const Quad& roi) {
+  std::vector<Quad> rois;
+  std::vector<Quad> barcodes;
+  auto add = [&](const Quad& r, const Quad& b) {
+    rois.push_back(r);
+    barcodes.push_back(b);
+  };
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const Quad reversed = {{roi[3], roi[2], roi[1], roi[0]}};
+  const Quad inside = Rect(10, 10, 40, 40);
+  add(roi, inside);
+  add(roi, {{inside[3], inside[2], inside[1], inside[0]}});  // other winding
+  add(roi, Rect(0, 10, 30, 40));      // shares part of the left edge
+  add(roi, Rect(0, 0, 100, 100));     // identical
+  add(roi, Rect(100, 10, 130, 40));   // touching from outside
+  add(roi, Rect(90, 10, 120, 40));
+  add(roi, Rect(-100, -100, 200, 200));
+  add(reversed, inside);
+  add(roi, {{{nan, 0}, {0, 10}, {10, 10}, {10, 0}}});
+  add(roi, {{{1, 1}, {2, 2}, {3, 3}, {4, 4}}});
+  add(Rect(0, 0, 0, 10), inside);
+  add(roi, {{{90, 10}, {130, 50}, {90, 90}, {110, 50}}});  // concave
+  add({{{0, 0}, {100, 0}, {50, 50}, {100, 100}}}, inside);  // concave roi
+
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<double> centre(-20.0, 120.0);
+  std::uniform_real_distribution<double> corner(-50.0, 150.0);
+  for (int i = 0; i < 2000; ++i) {
+    Quad r = RandomConvexQuad(rng, centre(rng), centre(rng));
+    if ((r[1].u - r[0].u) * (r[2].v - r[1].v) -
+            (r[1].v - r[0].v) * (r[2].u - r[1].u) < 0.0) {
+      std::swap(r[1], r[3]);
+    }
+    add(r, RandomConvexQuad(rng, centre(rng), centre(rng)));
+    // Arbitrary, possibly non-convex or self-intersecting, quads.
+    Quad b;
+    for (Point2D& p : b) {
+      p = {corner(rng), corner(rng)};
+    }
+    add(roi, b);
+  }
+
+  const roi_projector::KernelIsa original = roi_projector::ActiveKernelIsa();
+  const roi_projector::KernelIsa kIsas[] = {
+      roi_projector::KernelIsa::kScalar, roi_projector::KernelIsa::kNeon,
+      roi_projector::KernelIsa::kAvx2, roi_projector::KernelIsa::kAvx512};
+  // Odd count so every lane width ends with a partial group.
+  if (rois.size() % 2 == 0) {
+    rois.pop_back();
+    barcodes.pop_back();
+  }
+  const size_t count = rois.size();
+  std::vector<double> coverage(count);
+  for (roi_projector::KernelIsa isa : kIsas) {
+    if (!roi_projector::SetKernelIsa(isa)) {
+      continue;
+    }
+    roi_projector::ComputePairCoverage(rois.data(), barcodes.data(), count,
+                                       coverage.data());
+    for (size_t i = 0; i < count; ++i) {
+      const double expected =
+          roi_projector::CoverageRoi(rois[i]).Coverage(barcodes[i]);
+      // Scores are in [0, 1], so this is 1e-9 relative to a full match.
+      if (!(std::fabs(coverage[i] - expected) <= 1e-9)) {
+        std::cerr << roi_projector::KernelIsaName(isa) << " pair " << i
+                  << ": got " << coverage[i] << ", expected " << expected
+                  << "\n";
+        ++failures;
+      }
+    }
+  }
+  roi_projector::SetKernelIsa(original);
+}
+
+}  // namespace
+
+int main() {
+  const Quad roi = Rect(0.0, 0.0, 100.0, 100.0);
+  const roi_projector::CoverageRoi prepared(roi);
+
+  ExpectNear("inside", prepared.Coverage(Rect(10, 10, 40, 40)), 1.0);
+  ExpectNear("disjoint", prepared.Coverage(Rect(110, 10, 140, 40)), 0.0);
+  ExpectNear("straddling right edge",
+             prepared.Coverage(Rect(90, 10, 120, 40)), 1.0 / 3.0);
+  ExpectNear("straddling corner", prepared.Coverage(Rect(80, 80, 120, 120)),
+             0.25);
+  // Diamond centred on the ROI's top-right corner: a quarter is inside.
+  const Quad diamond = {{{100, 90}, {110, 100}, {100, 110}, {90, 100}}};
+  ExpectNear("diamond on corner", prepared.Coverage(diamond), 0.25);
+  ExpectNear("touching edge", prepared.Coverage(Rect(100, 10, 130, 40)), 0.0);
+  ExpectNear("barcode contains roi",
+             prepared.Coverage(Rect(-100, -100, 200, 200)), 1.0 / 9.0);
+
+  const Quad reversed = {{roi[3], roi[2], roi[1], roi[0]}};
+  ExpectNear("reversed roi",
+             roi_projector::CoverageRoi(reversed).Coverage(Rect(10, 10, 40, 40)),
+             0.0);
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  ExpectNear("non-finite barcode",
+             prepared.Coverage({{{nan, 0}, {0, 10}, {10, 10}, {10, 0}}}), 0.0);
+  ExpectNear("degenerate barcode",
+             prepared.Coverage({{{1, 1}, {2, 2}, {3, 3}, {4, 4}}}), 0.0);
+  if (roi_projector::CoverageRoi(Rect(0, 0, 0, 10)).valid()) {
+    std::cerr << "degenerate roi reported valid\n";
+    ++failures;
+  }
+
+  // The batch API agrees with the single-pair one.
+  constexpr size_t kBarcodes = 64;
+  std::vector<Quad> barcodes;
+  for (size_t i = 0; i < kBarcodes; ++i) {
+    const double u = -30.0 + 2.3 * i;
+    const double v = 70.0 - 1.1 * i;
+    barcodes.push_back(Rect(u, v, u + 35.0, v + 20.0));
+  }
+  std::array<double, kBarcodes> coverage{};
+  std::array<bool, kBarcodes> pass{};
+  const size_t passed = roi_projector::ScoreBarcodes(
+      roi, barcodes.data(), kBarcodes, 0.5, coverage.data(), pass.data());
+  size_t expected_passed = 0;
+  for (size_t i = 0; i < kBarcodes; ++i) {
+    ExpectNear("batch", coverage[i], prepared.Coverage(barcodes[i]));
+    expected_passed += coverage[i] > 0.5 ? 1 : 0;
+    if (pass[i] != (coverage[i] > 0.5) ||
+        roi_projector::IsRoiInsideQuad(roi, barcodes[i]) !=
+            (coverage[i] > roi_projector::kDefaultCoverageThreshold)) {
+      std::cerr << "pass flag mismatch at " << i << "\n";
+      ++failures;
+    }
+  }
+  if (passed != expected_passed) {
+    std::cerr << "pass count " << passed << " != " << expected_passed << "\n";
+    ++failures;
+  }
+
+  CheckTiers(prepared);
+  CheckPairCoverage(roi);
+
+  std::cout << (failures == 0 ? "coverage: ok\n" : "coverage: FAILED\n");
+  return failures == 0 ? 0 : 1;
+}
@@ -31,7 +31,8 @@ int main(int argc, char** argv) {
 
   const auto result = projector.ProjectCorners(corners);
   if (!result.ok) {
-    std::cerr << "Project corners failed: " << result.message << "\n";
+    std::cerr << "Project corners failed: "
+              << roi_projector::FormatCornersMessage(result) << "\n";
     return 1;
   }
 
@@ -0,0 +1,251 @@
+// Checks ROI rasterization against per-pixel brute force.
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "roi_coverage.h"
+#include "roi_raster.h"
+
+namespace {
+
+using roi_projector::Point2D;
+using roi_projector::Quad;
+using roi_projector::RasterOptions;
+using roi_projector::RoiSpans;
+
+int failures = 0;
+
+void Expect(bool ok, const char* what) {
+  if (!ok) {
+    std::cerr << what << "\n";
+    ++failures;
+  }
+}
+
+Quad Rect(double u0, double v0, double u1, double v1) {
+  return {{{u0, v0}, {u1, v0}, {u1, v1}, {u0, v1}}};
+}
+
+double SegmentDistance(const Point2D& p, const Point2D& a,
+                       const Point2D& b) {
+  const double du = b.u - a.u;
+  const double dv = b.v - a.v;
+  const double len2 = du * du + dv * dv;
+  double t = len2 > 0.0 ? ((p.u - a.u) * du + (p.v - a.v) * dv) / len2 : 0.0;
+  t = std::min(1.0, std::max(0.0, t));
+  return std::hypot(p.u - a.u - t * du, p.v - a.v - t * dv);
+}
+
+// Distance between the boundaries of two quads that do not overlap.
+double QuadDistance(const Quad& a, const Quad& b) {
+  double best = std::numeric_limits<double>::infinity();
+  for (int pass = 0; pass < 2; ++pass) {
+    const Quad& p = pass == 0 ? a : b;
+    const Quad& q = pass == 0 ? b : a;
+    for (const Point2D& corner : p) {
+      for (size_t k = 0; k < 4; ++k) {
+        best = std::min(best, SegmentDistance(corner, q[k], q[(k + 1) % 4]));
+      }
+    }
+  }
+  return best;
+}
+
+Quad RandomConvexQuad(std::mt19937& rng) {
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  double angles[4];
+  for (double& a : angles) {
+    a = 6.283185307179586 * unit(rng);
+  }
+  std::sort(angles, angles + 4);
+  const double cu = -10.0 + 90.0 * unit(rng);
+  const double cv = -10.0 + 70.0 * unit(rng);
+  const double ru = 1.0 + 30.0 * unit(rng);
+  const double rv = 1.0 + 30.0 * unit(rng);
+  Quad quad;
+  for (size_t k = 0; k < 4; ++k) {
+    quad[k] = {cu + ru * std::cos(angles[k]), cv + rv * std::sin(angles[k])};
+  }
+  return quad;
+}
+
+void CheckKnownRect() {
+  const Quad rect = Rect(10.5, 20.5, 30.5, 40.5);
+  RasterOptions options;
+  options.width = 100;
+  options.height = 100;
+  RoiSpans spans;
+  Expect(roi_projector::RasterizeRoi(rect.data(), 4, options, spans),
+         "rect: failed");
+  Expect(spans.first_row == 20 && spans.spans.size() == 21, "rect: rows");
+  for (const auto& span : spans.spans) {
+    Expect(span.x0 == 10 && span.x1 == 31, "rect: span");
+  }
+  Expect(spans.PixelCount() == 21 * 21, "rect: pixel count");
+
+  options.dilation_px = 2.0;
+  roi_projector::RasterizeRoi(rect.data(), 4, options, spans);
+  Expect(spans.first_row == 18 && spans.spans.size() == 25,
+         "dilated rect: rows");
+  for (const auto& span : spans.spans) {
+    Expect(span.x0 == 8 && span.x1 == 33, "dilated rect: span");
+  }
+
+  // Clipped to the image; rows left entirely of it are empty.
+  options.dilation_px = 0.0;
+  const Quad partly = Rect(-20.5, -5.5, 10.5, 3.5);
+  roi_projector::RasterizeRoi(partly.data(), 4, options, spans);
+  Expect(spans.first_row == 0 && spans.spans.size() == 4 &&
+             spans.spans[0].x0 == 0 && spans.spans[0].x1 == 11,
+         "partly outside");
+  const Quad left = Rect(-50.5, 10.5, -20.5, 20.5);
+  Expect(roi_projector::RasterizeRoi(left.data(), 4, options, spans) &&
+             spans.PixelCount() == 0,
+         "left of image");
+  const Quad below = Rect(10.5, 120.5, 20.5, 130.5);
+  Expect(roi_projector::RasterizeRoi(below.data(), 4, options, spans) &&
+             spans.spans.empty(),
+         "below image");
+
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const Quad bad = {{{nan, 0}, {10, 0}, {10, 10}, {0, 10}}};
+  Expect(!roi_projector::RasterizeRoi(bad.data(), 4, options, spans) &&
+             spans.spans.empty(),
+         "non-finite accepted");
+  Expect(!roi_projector::RasterizeRoi(rect.data(), 2, options, spans),
+         "two vertices accepted");
+}
+
+// Edges exactly on integer coordinates: pixels only touching the polygon
+// there are in, on both sides of the edge.
+void CheckIntegerEdges() {
+  RasterOptions options;
+  options.width = 100;
+  options.height = 100;
+  RoiSpans spans;
+  // Edges on x = 10, 30 and y = 20, 40.
+  const Quad rect = Rect(10, 20, 30, 40);
+  roi_projector::RasterizeRoi(rect.data(), 4, options, spans);
+  Expect(spans.first_row == 19 && spans.spans.size() == 22,
+         "integer rect: rows");
+  for (const auto& span : spans.spans) {
+    Expect(span.x0 == 9 && span.x1 == 31, "integer rect: span");
+  }
+  for (int y = 0; y < 60; ++y) {
+    for (int x = 0; x < 60; ++x) {
+      const bool touches = x >= 9 && x <= 30 && y >= 19 && y <= 40;
+      Expect(spans.Contains(x, y) == touches, "integer rect: pixel");
+    }
+  }
+
+  // Pixels within exactly the dilation of an integer edge.
+  options.dilation_px = 2.0;
+  roi_projector::RasterizeRoi(rect.data(), 4, options, spans);
+  Expect(spans.first_row == 17 && spans.spans.size() == 26,
+         "dilated integer rect: rows");
+  for (const auto& span : spans.spans) {
+    Expect(span.x0 == 7 && span.x1 == 33, "dilated integer rect: span");
+  }
+  options.dilation_px = 0.0;
+
+  // Diamond with integer vertices: the top and bottom rows only touch a
+  // vertex, which lies on the corner of two pixels.
+  const Quad diamond = {{{20, 10}, {30, 20}, {20, 30}, {10, 20}}};
+  roi_projector::RasterizeRoi(diamond.data(), 4, options, spans);
+  Expect(spans.first_row == 9 && spans.spans.size() == 22,
+         "diamond: rows");
+  Expect(spans.spans.front().x0 == 19 && spans.spans.front().x1 == 21 &&
+             spans.spans.back().x0 == 19 && spans.spans.back().x1 == 21,
+         "diamond: touching rows");
+  // Row 19 reaches the side vertices at v = 20; so does row 20.
+  Expect(spans.spans[10].x0 == 9 && spans.spans[10].x1 == 31 &&
+             spans.spans[11].x0 == 9 && spans.spans[11].x1 == 31,
+         "diamond: widest rows");
+
+  // An edge on the image border still stops at the image.
+  const Quad border = Rect(0, 0, 5, 5);
+  roi_projector::RasterizeRoi(border.data(), 4, options, spans);
+  Expect(spans.first_row == 0 && spans.spans.size() == 6 &&
+             spans.spans[0].x0 == 0 && spans.spans[0].x1 == 6,
+         "integer rect on the border");
+}
+
+// Undilated spans are exactly the pixels the quad overlaps; dilated ones
+// include every pixel within the dilation.
+void CheckRandomQuads() {
+  constexpr int kWidth = 70;
+  constexpr int kHeight = 50;
+  std::mt19937 rng(11);
+  RasterOptions options;
+  options.width = kWidth;
+  options.height = kHeight;
+  RoiSpans spans;
+  RoiSpans dilated;
+  for (int i = 0; i < 300; ++i) {
+    const Quad quad = RandomConvexQuad(rng);
+    options.dilation_px = 0.0;
+    roi_projector::RasterizeRoi(quad.data(), 4, options, spans);
+    options.dilation_px = 2.5;
+    roi_projector::RasterizeRoi(quad.data(), 4, options, dilated);
+    for (int y = 0; y < kHeight; ++y) {
+      for (int x = 0; x < kWidth; ++x) {
+        const Quad pixel = Rect(x, y, x + 1, y + 1);
+        const bool overlaps =
+            roi_projector::CoverageRoi(pixel).Coverage(quad) > 0.0;
+        if (spans.Contains(x, y) != overlaps) {
+          std::cerr << "quad " << i << " pixel (" << x << ", " << y
+                    << "): in spans " << spans.Contains(x, y)
+                    << ", overlaps " << overlaps << "\n";
+          ++failures;
+          return;
+        }
+        if (!dilated.Contains(x, y) &&
+            (overlaps || QuadDistance(pixel, quad) <= options.dilation_px)) {
+          std::cerr << "quad " << i << " pixel (" << x << ", " << y
+                    << ") within dilation but not in spans\n";
+          ++failures;
+          return;
+        }
+      }
+    }
+  }
+}
+
+void CheckMask() {
+  for (int width : {1, 63, 64, 65, 200}) {
+    RoiSpans spans;
+    spans.first_row = 3;
+    for (int r = 0; r < 70; ++r) {
+      const int x0 = (r * 37) % (width + 5) - 2;
+      spans.spans.push_back({x0, x0 + (r * 13) % 130});
+    }
+    roi_projector::RoiMask mask;
+    roi_projector::BuildRoiMask(spans, width, mask);
+    for (int y = 0; y < 80; ++y) {
+      for (int x = -2; x < width + 2; ++x) {
+        const bool expected = x >= 0 && x < width && spans.Contains(x, y);
+        if (mask.Test(x, y) != expected) {
+          std::cerr << "mask width " << width << " (" << x << ", " << y
+                    << ")\n";
+          ++failures;
+          return;
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  CheckKnownRect();
+  CheckIntegerEdges();
+  CheckRandomQuads();
+  CheckMask();
+  std::cout << (failures == 0 ? "raster: ok\n" : "raster: FAILED\n");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,246 @@
+// Checks StaticProjector against the runtime Projector: the header
+// generated from the test calibration and hand-written calibrations with
+// some or all distortion terms zero must give the same coordinates, bit
+// for bit, and the same statuses as Projector without the undistortion
+// table.
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "roi_projector.h"
+#include "static_projector.h"
+#include "test_calibration.h"
+
+namespace {
+
+using roi_projector::KernelIsa;
+using roi_projector::Point2D;
+using roi_projector::Point3D;
+using roi_projector::ProjectStatus;
+using roi_projector::Projector;
+using roi_projector::StaticCalibration;
+using roi_projector::StaticProjector;
+using roi_projector::UndistortMode;
+
+int failures = 0;
+
+void Expect(bool ok, const std::string& what) {
+  if (!ok) {
+    std::cerr << what << "\n";
+    ++failures;
+  }
+}
+
+// Radial-only camera1 and pinhole camera2, behind which points closer
+// than 600 mm to camera1 fall.
+constexpr StaticCalibration kRadialOnly = {
+    {{0.99, 0.0, 0.141, 40.0},
+     {0.0, 1.0, 0.0, 0.0},
+     {-0.141, 0.0, 0.99, -600.0},
+     {0.0, 0.0, 0.0, 1.0}},
+    {{1400.0, 0.0, 960.0}, {0.0, 1400.0, 600.0}, {0.0, 0.0, 1.0}},
+    {{900.0, 0.0, 640.0}, {0.0, 905.0, 360.0}, {0.0, 0.0, 1.0}},
+    {-0.21, 0.05, 0.0, 0.0, 0.0},
+    {0.0, 0.0, 0.0, 0.0, 0.0},
+};
+
+// Pinhole camera1 and a camera2 with tangential distortion only.
+constexpr StaticCalibration kTangentialOnly = {
+    {{1.0, 0.0, 0.0, -55.0},
+     {0.0, 1.0, 0.0, 3.0},
+     {0.0, 0.0, 1.0, 12.0},
+     {0.0, 0.0, 0.0, 1.0}},
+    {{1300.0, 0.0, 955.0}, {0.0, 1310.0, 590.0}, {0.0, 0.0, 1.0}},
+    {{880.0, 0.0, 650.0}, {0.0, 870.0, 355.0}, {0.0, 0.0, 1.0}},
+    {0.0, 0.0, 0.0, 0.0, 0.0},
+    {0.0, 0.0, 0.0015, -0.0008, 0.0},
+};
+
+// No distortion at all.
+constexpr StaticCalibration kPinhole = {
+    {{1.0, 0.0, 0.0, 100.0},
+     {0.0, 1.0, 0.0, 0.0},
+     {0.0, 0.0, 1.0, 0.0},
+     {0.0, 0.0, 0.0, 1.0}},
+    {{1200.0, 0.0, 960.0}, {0.0, 1200.0, 600.0}, {0.0, 0.0, 1.0}},
+    {{1200.0, 0.0, 960.0}, {0.0, 1200.0, 600.0}, {0.0, 0.0, 1.0}},
+    {0.0, 0.0, 0.0, 0.0, 0.0},
+    {0.0, 0.0, 0.0, 0.0, 0.0},
+};
+
+static_assert(StaticProjector<kRadialOnly>::kHasDist1 &&
+                  !StaticProjector<kRadialOnly>::kHasDist2,
+              "radial-only flags");
+static_assert(!StaticProjector<kTangentialOnly>::kHasDist1 &&
+                  StaticProjector<kTangentialOnly>::kHasDist2,
+              "tangential-only flags");
+static_assert(!StaticProjector<kPinhole>::kHasDist1 &&
+                  !StaticProjector<kPinhole>::kHasDist2,
+              "pinhole flags");
+
+// `calib` as calibration JSON.
+std::string ToJson(const StaticCalibration& calib) {
+  std::string out = "{";
+  auto add = [&out](const char* key, const double* values, size_t count) {
+    out += std::string(out.size() > 1 ? ", " : "") + "\"" + key + "\": [";
+    for (size_t i = 0; i < count; ++i) {
+      char text[32];
+      std::snprintf(text, sizeof(text), "%.17g", values[i]);
+      out += std::string(i == 0 ? "" : ", ") + text;
+    }
+    out += "]";
+  };
+  add("extrinsic_matrix", &calib.extrinsic[0][0], 16);
+  add("camera1_matrix", &calib.camera1[0][0], 9);
+  add("camera2_matrix", &calib.camera2[0][0], 9);
+  add("camera1_distortion", calib.dist1, 5);
+  add("camera2_distortion", calib.dist2, 5);
+  return out + "}";
+}
+
+// Camera1 pixels over and beyond a 1920x1200 image at a range of depths,
+// plus invalid depths.
+std::vector<Point3D> MakePoints() {
+  std::vector<Point3D> points;
+  for (double v = -300; v <= 1500; v += 75) {
+    for (double u = -400; u <= 2300; u += 90) {
+      points.push_back({u, v, 250 + std::fabs(u - v) * 1.7});
+    }
+  }
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double inf = std::numeric_limits<double>::infinity();
+  for (double z : {0.0, -0.0, -5.0, nan, inf, -inf}) {
+    points.push_back({700.0, 500.0, z});
+  }
+  return points;
+}
+
+bool SameValue(double a, double b) {
+  return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+// Compares StaticProjector<kCalib, kMode> with `projector` point by point
+// (scalar path) and in one batch (active kernel).
+template <const StaticCalibration& kCalib, UndistortMode kMode>
+void Compare(Projector& projector, const std::string& what) {
+  using Static = StaticProjector<kCalib, kMode>;
+  projector.SetUndistortMode(kMode);
+  const std::vector<Point3D> points = MakePoints();
+  const size_t n = points.size();
+  std::vector<Point2D> expected(n);
+  std::vector<ProjectStatus> expected_status(n);
+  const size_t expected_ok = projector.ProjectPoints(
+      points.data(), n, expected.data(), expected_status.data());
+  std::vector<Point2D> got(n);
+  std::vector<ProjectStatus> got_status(n);
+  const size_t got_ok =
+      Static::ProjectPoints(points.data(), n, got.data(), got_status.data());
+
+  size_t mismatches = 0;
+  size_t failed = 0;
+  for (size_t i = 0; i < n; ++i) {
+    failed += got_status[i] != ProjectStatus::kOk ? 1 : 0;
+    if (got_status[i] != expected_status[i] ||
+        !SameValue(got[i].u, expected[i].u) ||
+        !SameValue(got[i].v, expected[i].v)) {
+      ++mismatches;
+    }
+    double u = 0.0;
+    double v = 0.0;
+    const ProjectStatus st =
+        Static::Project(points[i].u, points[i].v, points[i].z, u, v);
+    if (st != got_status[i] || !SameValue(u, got[i].u) ||
+        !SameValue(v, got[i].v)) {
+      ++mismatches;
+    }
+  }
+  Expect(mismatches == 0 && got_ok == expected_ok,
+         what + ": " + std::to_string(mismatches) + " of " +
+             std::to_string(n) + " points differ");
+  Expect(failed >= 6 && got_ok > n / 2, what + ": unexpected failure count");
+
+  // Corners, with a failing one reported as Projector reports it.
+  for (size_t bad = 0; bad <= 4; ++bad) {
+    std::array<Point3D, 4> corners = {
+        {{300, 200, 900}, {1600, 240, 950}, {1580, 1000, 1010},
+         {320, 980, 990}}};
+    if (bad < 4) {
+      corners[bad].z = -1.0;
+    }
+    const roi_projector::CornersResult a = Static::ProjectCorners(corners);
+    const roi_projector::CornersResult b = projector.ProjectCorners(corners);
+    bool same = a.ok == b.ok && a.status == b.status &&
+                a.failed_corner == b.failed_corner;
+    for (size_t i = 0; same && a.ok && i < 4; ++i) {
+      same = a.points[i].u == b.points[i].u && a.points[i].v == b.points[i].v;
+    }
+    Expect(same && a.ok == (bad == 4), what + ": corners");
+  }
+}
+
+template <const StaticCalibration& kCalib>
+void CompareAllModes(Projector& projector, const std::string& what) {
+  Compare<kCalib, UndistortMode::kFast>(projector, what + " fast");
+  Compare<kCalib, UndistortMode::kBalanced>(projector, what + " balanced");
+  Compare<kCalib, UndistortMode::kExact>(projector, what + " exact");
+}
+
+bool Load(Projector& projector, const std::string& path) {
+  roi_projector::UndistortLutOptions options;
+  options.enabled = false;
+  if (!projector.LoadCalibration(path, options)) {
+    std::cerr << "Failed to load calibration: " << path << "\n";
+    ++failures;
+    return false;
+  }
+  return true;
+}
+
+template <const StaticCalibration& kCalib>
+void CheckHandWritten(const std::filesystem::path& dir,
+                      const std::string& name, const std::string& suffix) {
+  const std::filesystem::path path = dir / (name + ".json");
+  std::ofstream(path) << ToJson(kCalib);
+  Projector projector;
+  if (Load(projector, path.string())) {
+    CompareAllModes<kCalib>(projector, name + suffix);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string calib_path = (argc > 1) ? argv[1] : "test/calib_out.json";
+  using roi_projector_generated::kTestCalibration;
+  static_assert(StaticProjector<kTestCalibration>::kHasDist1 &&
+                    StaticProjector<kTestCalibration>::kHasDist2,
+                "test calibration has both distortion models");
+
+  const std::filesystem::path dir =
+      std::filesystem::temp_directory_path() / "test_static_projector";
+  std::filesystem::create_directories(dir);
+  for (KernelIsa isa : {KernelIsa::kScalar, roi_projector::ActiveKernelIsa()}) {
+    const KernelIsa previous = roi_projector::ActiveKernelIsa();
+    roi_projector::SetKernelIsa(isa);
+    const std::string suffix =
+        std::string(" (") + roi_projector::KernelIsaName(isa) + ")";
+    Projector projector;
+    if (Load(projector, calib_path)) {
+      CompareAllModes<kTestCalibration>(projector, "generated" + suffix);
+    }
+    CheckHandWritten<kRadialOnly>(dir, "radial_only", suffix);
+    CheckHandWritten<kTangentialOnly>(dir, "tangential_only", suffix);
+    CheckHandWritten<kPinhole>(dir, "pinhole", suffix);
+    roi_projector::SetKernelIsa(previous);
+  }
+  std::filesystem::remove_all(dir);
+  std::cout << (failures == 0 ? "static projector: ok\n"
+                              : "static projector: FAILED\n");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+// Checks that trace records from several threads all reach the sink.
+// Built only with ROI_PROJECTOR_ENABLE_TRACE=ON.
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "roi_projector.h"
+#include "roi_trace.h"
+
+namespace {
+
+using roi_projector::Point2D;
+using roi_projector::TraceEvent;
+using roi_projector::TraceRecord;
+
+struct Collected {
+  std::mutex mutex;
+  std::vector<TraceRecord> records;
+};
+
+void Collect(const TraceRecord* records, size_t count, void* user) {
+  auto* collected = static_cast<Collected*>(user);
+  std::lock_guard<std::mutex> lock(collected->mutex);
+  collected->records.insert(collected->records.end(), records,
+                            records + count);
+}
+
+}  // namespace
+
+int main() {
+  if (!roi_projector::TraceCompiledIn()) {
+    std::cerr << "trace points not compiled in\n";
+    return 1;
+  }
+
+  constexpr int kThreads = 4;
+  constexpr int kChecksPerThread = 5000;
+  // Straddles the ROI's left edge with 37/40 of its area inside, so every
+  // check clips and emits exactly one kIntersection and one kCoverage
+  // record.
+  const std::array<Point2D, 4> roi = {
+      {{0.0, 0.0}, {100.0, 0.0}, {100.0, 100.0}, {0.0, 100.0}}};
+  const std::array<Point2D, 4> barcode = {
+      {{-3.0, 10.0}, {37.0, 10.0}, {37.0, 40.0}, {-3.0, 40.0}}};
+  const double kCoverage = 37.0 / 40.0;
+
+  Collected collected;
+  if (!roi_projector::StartTracing(&Collect, &collected) ||
+      roi_projector::StartTracing(&Collect, &collected)) {
+    std::cerr << "StartTracing should succeed exactly once\n";
+    return 1;
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < kChecksPerThread; ++i) {
+        if (!roi_projector::IsRoiInsideQuad(roi, barcode)) {
+          std::cerr << "unexpected result\n";
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  roi_projector::StopTracing();
+
+  const uint64_t expected = 2ull * kThreads * kChecksPerThread;
+  const uint64_t dropped = roi_projector::TraceDroppedRecords();
+  int failures = 0;
+  if (collected.records.size() + dropped != expected) {
+    std::cerr << "records " << collected.records.size() << " + dropped "
+              << dropped << " != " << expected << "\n";
+    ++failures;
+  }
+  std::vector<uint64_t> last(kThreads + 1, 0);
+  for (const TraceRecord& record : collected.records) {
+    if (record.thread_index >= last.size() ||
+        record.timestamp_ns < last[record.thread_index]) {
+      std::cerr << "records out of order\n";
+      ++failures;
+      break;
+    }
+    last[record.thread_index] = record.timestamp_ns;
+    if (record.event == TraceEvent::kCoverage &&
+        std::fabs(record.values[0] - kCoverage) > 1e-12) {
+      std::cerr << "unexpected coverage " << record.values[0] << "\n";
+      ++failures;
+      break;
+    }
+  }
+  std::cout << collected.records.size() << " records, " << dropped
+            << " dropped\n";
+  return failures == 0 ? 0 : 1;
+}
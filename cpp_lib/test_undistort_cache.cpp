@@ -0,0 +1,272 @@
+// Checks the on-disk undistortion table cache: a miss builds and stores
+// the table, a hit maps the same table, keys follow the calibration and the
+// options, damaged entries are rebuilt, and background builds publish the
+// table after the calibration.
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "calibration_reload.h"
+#include "roi_projector.h"
+
+namespace {
+
+using roi_projector::Point2D;
+using roi_projector::Point3D;
+using roi_projector::Projector;
+using roi_projector::UndistortLut;
+using roi_projector::UndistortLutOptions;
+using roi_projector::UndistortMode;
+
+int failures = 0;
+
+void Expect(bool ok, const std::string& what) {
+  if (!ok) {
+    std::cerr << what << "\n";
+    ++failures;
+  }
+}
+
+std::vector<std::filesystem::path> CacheFiles(
+    const std::filesystem::path& dir) {
+  std::vector<std::filesystem::path> files;
+  if (std::filesystem::exists(dir)) {
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+      files.push_back(entry.path());
+    }
+  }
+  return files;
+}
+
+bool SameTable(const UndistortLut* a, const UndistortLut* b) {
+  return a != nullptr && b != nullptr && a->width == b->width &&
+         a->height == b->height && a->stride == b->stride &&
+         a->cols == b->cols && a->rows == b->rows &&
+         a->inv_stride == b->inv_stride &&
+         std::memcmp(a->data, b->data, a->SizeBytes()) == 0;
+}
+
+std::vector<Point2D> Project(const Projector& projector) {
+  std::vector<Point3D> points;
+  for (double v = 40; v < 1200; v += 170) {
+    for (double u = 30; u < 1920; u += 230) {
+      points.push_back({u, v, 800 + v});
+    }
+  }
+  std::vector<Point2D> out(points.size());
+  projector.ProjectPoints(points.data(), points.size(), out.data(), nullptr);
+  return out;
+}
+
+bool Same(const std::vector<Point2D>& a, const std::vector<Point2D>& b) {
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].u != b[i].u || a[i].v != b[i].v) {
+      return false;
+    }
+  }
+  return a.size() == b.size();
+}
+
+// Only kFast builds a table, so the projectors here start in it.
+void CheckCache(const std::string& calib_path,
+                const std::filesystem::path& dir) {
+  Projector reference;
+  reference.SetUndistortMode(UndistortMode::kFast);
+  if (!reference.LoadCalibration(calib_path)) {
+    std::cerr << "Failed to load calibration: " << calib_path << "\n";
+    ++failures;
+    return;
+  }
+  UndistortLutOptions options;
+  options.cache_dir = dir.string();
+
+  // Miss: built in memory and stored; the directory is created.
+  Projector first;
+  first.SetUndistortMode(UndistortMode::kFast);
+  Expect(first.LoadCalibration(calib_path, options) &&
+             first.undistort_lut() != nullptr &&
+             !first.undistort_lut()->storage.empty(),
+         "miss: built");
+  Expect(CacheFiles(dir).size() == 1, "miss: stored");
+
+  // Hit: mapped, identical to the built table.
+  Projector second;
+  second.SetUndistortMode(UndistortMode::kFast);
+  Expect(second.LoadCalibration(calib_path, options) &&
+             second.undistort_lut() != nullptr &&
+             second.undistort_lut()->storage.empty() &&
+             second.undistort_lut()->mapping != nullptr,
+         "hit: mapped");
+  Expect(SameTable(second.undistort_lut(), reference.undistort_lut()) &&
+             Same(Project(second), Project(reference)),
+         "hit: same table and projection");
+
+  // The other modes build nothing; switching to kFast maps the table.
+  Projector balanced;
+  Expect(balanced.LoadCalibration(calib_path, options) &&
+             balanced.undistort_lut() == nullptr,
+         "balanced: no table");
+  balanced.SetUndistortMode(UndistortMode::kFast);
+  Expect(balanced.undistort_lut() != nullptr &&
+             balanced.undistort_lut()->mapping != nullptr &&
+             balanced.compiled_calibration().lut1 != nullptr,
+         "balanced: mapped on entering fast");
+
+  // Other options or intrinsics are other entries.
+  UndistortLutOptions coarse = options;
+  coarse.stride = 8;
+  Projector third;
+  third.SetUndistortMode(UndistortMode::kFast);
+  Expect(third.LoadCalibration(calib_path, coarse) &&
+             third.undistort_lut() != nullptr &&
+             third.undistort_lut()->stride == 8 &&
+             !third.undistort_lut()->storage.empty(),
+         "key: stride");
+  Expect(CacheFiles(dir).size() == 2, "key: stride stored apart");
+  const roi_projector::CompiledCalibration& c =
+      reference.compiled_calibration();
+  const double fx = 1.0 / c.inv_fx1;
+  const double fy = 1.0 / c.inv_fy1;
+  Expect(roi_projector::LoadCachedUndistortLut(fx, fy, c.cx1, c.cy1, c.dist1,
+                                               options) != nullptr,
+         "key: lookup by intrinsics");
+  Expect(roi_projector::LoadCachedUndistortLut(fx * (1 + 1e-12), fy, c.cx1,
+                                               c.cy1, c.dist1,
+                                               options) == nullptr,
+         "key: changed focal length");
+  double dist[5];
+  std::memcpy(dist, c.dist1, sizeof(dist));
+  dist[4] += 1e-9;
+  Expect(roi_projector::LoadCachedUndistortLut(fx, fy, c.cx1, c.cy1, dist,
+                                               options) == nullptr,
+         "key: changed distortion");
+
+  // A damaged entry is a miss, and is rebuilt and replaced. Entries are
+  // renamed over, never rewritten in place, while mapped.
+  for (const std::filesystem::path& file : CacheFiles(dir)) {
+    std::vector<char> bytes;
+    {
+      std::ifstream in(file, std::ios::binary);
+      bytes.assign(std::istreambuf_iterator<char>(in),
+                   std::istreambuf_iterator<char>());
+    }
+    bytes[bytes.size() - 5] ^= 0x40;
+    const std::filesystem::path damaged = file.string() + ".damaged";
+    std::ofstream(damaged, std::ios::binary)
+        .write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    std::filesystem::rename(damaged, file);
+  }
+  Expect(roi_projector::LoadCachedUndistortLut(fx, fy, c.cx1, c.cy1, c.dist1,
+                                               options) == nullptr,
+         "damaged: rejected");
+  Projector rebuilt;
+  rebuilt.SetUndistortMode(UndistortMode::kFast);
+  Expect(rebuilt.LoadCalibration(calib_path, options) &&
+             !rebuilt.undistort_lut()->storage.empty() &&
+             SameTable(rebuilt.undistort_lut(), reference.undistort_lut()),
+         "damaged: rebuilt");
+  Expect(roi_projector::LoadCachedUndistortLut(fx, fy, c.cx1, c.cy1, c.dist1,
+                                               options) != nullptr,
+         "damaged: replaced");
+  // `second` still reads the mapping of the file replaced above.
+  Expect(Same(Project(second), Project(reference)),
+         "damaged: old mapping still valid");
+
+  // An unusable cache directory still yields a table.
+  UndistortLutOptions unusable = options;
+  unusable.cache_dir = calib_path + "/not_a_directory";
+  Projector fallback;
+  fallback.SetUndistortMode(UndistortMode::kFast);
+  Expect(fallback.LoadCalibration(calib_path, unusable) &&
+             SameTable(fallback.undistort_lut(), reference.undistort_lut()),
+         "unusable directory");
+}
+
+void CheckBackground(const std::string& calib_path,
+                     const std::filesystem::path& dir) {
+  Projector reference;
+  reference.SetUndistortMode(UndistortMode::kFast);
+  reference.LoadCalibration(calib_path);
+  UndistortLutOptions options;
+  options.cache_dir = dir.string();
+  options.build_in_background = true;
+  std::filesystem::remove_all(dir);
+
+  // A plain projector starts without the table and gets it on request.
+  Projector projector;
+  projector.SetUndistortMode(UndistortMode::kFast);
+  Expect(projector.LoadCalibration(calib_path, options) &&
+             projector.undistort_lut() == nullptr,
+         "background: no table on a miss");
+  projector.RebuildUndistortLut(options);
+  Expect(SameTable(projector.undistort_lut(), reference.undistort_lut()) &&
+             Same(Project(projector), Project(reference)),
+         "background: rebuilt");
+
+  // SharedProjector publishes at once, then again with the table. Loads
+  // keep the published mode, so kFast is published first.
+  std::filesystem::remove_all(dir);
+  {
+    roi_projector::SharedProjector shared;
+    shared.Publish(std::make_unique<Projector>(projector));
+    Expect(shared.Load(calib_path, options) && shared.version() >= 2,
+           "background: published");
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (shared.version() < 3 &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    Expect(shared.version() == 3 &&
+               SameTable(shared.Acquire()->undistort_lut(),
+                         reference.undistort_lut()) &&
+               Same(Project(*shared.Acquire()), Project(reference)),
+           "background: republished with the table");
+    Expect(CacheFiles(dir).size() == 1, "background: stored");
+
+    // Cached now, so the next load maps it and publishes once.
+    Expect(shared.Load(calib_path, options) && shared.version() == 4 &&
+               shared.Acquire()->undistort_lut() != nullptr &&
+               shared.Acquire()->undistort_lut()->mapping != nullptr,
+           "background: hit");
+  }
+
+  // A build overtaken by another publication is dropped rather than
+  // published over it.
+  std::filesystem::remove_all(dir);
+  {
+    roi_projector::SharedProjector shared;
+    shared.Publish(std::make_unique<Projector>(projector));
+    shared.Load(calib_path, options);
+    UndistortLutOptions analytic;
+    analytic.enabled = false;
+    auto later = std::make_unique<Projector>();
+    later->LoadCalibration(calib_path, analytic);
+    shared.Publish(std::move(later));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    Expect(shared.Acquire()->undistort_lut() == nullptr,
+           "overtaken: stale table published");
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string calib_path = (argc > 1) ? argv[1] : "test/calib_out.json";
+  const std::filesystem::path dir =
+      std::filesystem::temp_directory_path() / "test_undistort_cache";
+  std::filesystem::remove_all(dir);
+  CheckCache(calib_path, dir);
+  CheckBackground(calib_path, dir);
+  std::filesystem::remove_all(dir);
+  std::cout << (failures == 0 ? "undistort cache: ok\n"
+                              : "undistort cache: FAILED\n");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,310 @@
+// Dense undistortion lookup table for camera1.
+#include "undistort_lut.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+#include "calibration_binary.h"
+#include "mapped_file.h"
+#include "projection_kernel.h"
+
+namespace roi_projector {
+
+namespace {
+
+constexpr int kMaxStride = 64;
+
+// The table is built once, so nodes are solved in exact mode. Near the
+// image corners the 5-coefficient model may have no inverse at all; those
+// nodes are reported as not converged.
+bool SolveUndistort(double xd, double yd, const double dist[5], double& xu,
+                    double& yu) {
+  constexpr int kMaxIterations = 20;
+  constexpr double kTolerance = 1e-14;
+  detail::ScalarF64 x{0.0};
+  detail::ScalarF64 y{0.0};
+  const bool converged = detail::UndistortNormalized(
+      detail::ScalarF64{xd}, detail::ScalarF64{yd}, dist, kMaxIterations,
+      kTolerance, x, y, nullptr);
+  xu = x.v;
+  yu = y.v;
+  return converged;
+}
+
+int GridCount(int pixels, int stride) {
+  return (pixels - 1 + stride - 1) / stride + 1;
+}
+
+// Squared distortion residual of undistorted (xu, yu) against distorted
+// (xd, yd).
+double SquaredResidual(double xu, double yu, double xd, double yd,
+                       const double dist[5]) {
+  detail::ScalarF64 x{0.0};
+  detail::ScalarF64 y{0.0};
+  detail::DistortNormalized(detail::ScalarF64{xu}, detail::ScalarF64{yu},
+                            dist, x, y);
+  const double ex = x.v - xd;
+  const double ey = y.v - yd;
+  return ex * ex + ey * ey;
+}
+
+// Bilinear interpolation error peaks inside a cell and float rounding
+// anywhere, so the lookup is checked at the centre and the top and left
+// edge midpoints of every cell whose nodes all converged (Sample declines
+// the others). The lookup there is the mean of the nodes involved.
+double MeasureMaxResidual(const UndistortLut& lut, double fx, double fy,
+                          double cx, double cy, const double dist[5]) {
+  const double inv_fx = 1.0 / fx;
+  const double inv_fy = 1.0 / fy;
+  const double half = 0.5 * lut.stride;
+  const size_t row_floats = static_cast<size_t>(lut.cols) * 2;
+  double worst = 0.0;
+  for (int r = 0; r + 1 < lut.rows; ++r) {
+    const double v = static_cast<double>(r) * lut.stride;
+    const double yd_edge = (v - cy) * inv_fy;
+    const double yd_mid = (v + half - cy) * inv_fy;
+    const float* row = lut.data + static_cast<size_t>(r) * row_floats;
+    for (int c = 0; c + 1 < lut.cols; ++c) {
+      const float* p00 = row + static_cast<size_t>(c) * 2;
+      const float* p10 = p00 + row_floats;
+      const double x00 = p00[0], y00 = p00[1], x01 = p00[2], y01 = p00[3];
+      const double x10 = p10[0], y10 = p10[1], x11 = p10[2], y11 = p10[3];
+      if (!std::isfinite(x00 + y00 + x01 + y01 + x10 + y10 + x11 + y11)) {
+        continue;
+      }
+      const double u = static_cast<double>(c) * lut.stride;
+      const double xd_edge = (u - cx) * inv_fx;
+      const double xd_mid = (u + half - cx) * inv_fx;
+      worst = std::max(
+          {worst,
+           SquaredResidual(0.25 * (x00 + x01 + x10 + x11),
+                           0.25 * (y00 + y01 + y10 + y11), xd_mid, yd_mid,
+                           dist),
+           SquaredResidual(0.5 * (x00 + x01), 0.5 * (y00 + y01), xd_mid,
+                           yd_edge, dist),
+           SquaredResidual(0.5 * (x00 + x10), 0.5 * (y00 + y10), xd_edge,
+                           yd_mid, dist)});
+    }
+  }
+  return std::sqrt(worst);
+}
+
+// Cache files hold an LutCacheHeader, then the table at kLutCacheDataOffset.
+// They never leave the host, so values are in native byte order.
+constexpr char kLutCacheMagic[8] = {'R', 'O', 'I', 'L', 'U', 'T', 'C', '\0'};
+// Part of the key: bumped when the layout or the way tables are built
+// changes, so older entries are never mapped.
+constexpr uint32_t kLutCacheVersion = 2;
+
+// Everything BuildUndistortLut depends on. Its bytes, padding spelled out
+// and zeroed, are the cache key.
+struct LutCacheKey {
+  double fx;
+  double fy;
+  double cx;
+  double cy;
+  double dist[5];
+  int32_t width;
+  int32_t height;
+  int32_t stride;
+  uint32_t version;
+  uint64_t memory_budget_bytes;
+};
+
+struct LutCacheHeader {
+  char magic[8];
+  uint64_t checksum;  // CalibrationChecksum of the rest of the file
+  uint64_t file_bytes;
+  LutCacheKey key;
+  int32_t width;
+  int32_t height;
+  int32_t stride;
+  int32_t cols;
+  int32_t rows;
+  int32_t reserved;
+  double inv_stride;
+  double max_residual;
+};
+
+constexpr size_t kLutCacheDataOffset = (sizeof(LutCacheHeader) + 63) / 64 * 64;
+constexpr size_t kLutCacheChecksumStart =
+    offsetof(LutCacheHeader, checksum) + sizeof(uint64_t);
+
+LutCacheKey MakeCacheKey(double fx, double fy, double cx, double cy,
+                         const double dist[5],
+                         const UndistortLutOptions& options) {
+  LutCacheKey key;
+  std::memset(&key, 0, sizeof(key));
+  key.fx = fx;
+  key.fy = fy;
+  key.cx = cx;
+  key.cy = cy;
+  std::memcpy(key.dist, dist, sizeof(key.dist));
+  key.width = options.width;
+  key.height = options.height;
+  key.stride = options.stride;
+  key.version = kLutCacheVersion;
+  key.memory_budget_bytes = options.memory_budget_bytes;
+  return key;
+}
+
+std::string CachePath(const UndistortLutOptions& options,
+                      const LutCacheKey& key) {
+  char name[64];
+  std::snprintf(name, sizeof(name), "undistort_lut_%016llx.bin",
+                static_cast<unsigned long long>(
+                    CalibrationChecksum(&key, sizeof(key))));
+  return (std::filesystem::path(options.cache_dir) / name).string();
+}
+
+void StoreCachedLut(const std::string& path, const LutCacheKey& key,
+                    const UndistortLut& lut,
+                    const UndistortLutOptions& options) {
+  LutCacheHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kLutCacheMagic, sizeof(header.magic));
+  header.file_bytes = kLutCacheDataOffset + lut.SizeBytes();
+  header.key = key;
+  header.width = lut.width;
+  header.height = lut.height;
+  header.stride = lut.stride;
+  header.cols = lut.cols;
+  header.rows = lut.rows;
+  header.inv_stride = lut.inv_stride;
+  header.max_residual = lut.max_residual;
+
+  std::vector<unsigned char> bytes(header.file_bytes, 0);
+  unsigned char* const out = bytes.data();
+  std::memcpy(out + kLutCacheDataOffset, lut.data, lut.SizeBytes());
+  std::memcpy(out, &header, sizeof(header));
+  header.checksum = CalibrationChecksum(out + kLutCacheChecksumStart,
+                                        bytes.size() - kLutCacheChecksumStart);
+  std::memcpy(out, &header, sizeof(header));
+
+  std::error_code ec;
+  std::filesystem::create_directories(options.cache_dir, ec);
+  WriteFileAtomically(path, out, bytes.size());
+}
+
+}  // namespace
+
+std::shared_ptr<const UndistortLut> BuildUndistortLut(
+    double fx, double fy, double cx, double cy, const double dist[5],
+    const UndistortLutOptions& options) {
+  if (!options.enabled) {
+    return nullptr;
+  }
+  const int width = options.width > 0
+                        ? options.width
+                        : static_cast<int>(std::lround(2.0 * cx + 1.0));
+  const int height = options.height > 0
+                         ? options.height
+                         : static_cast<int>(std::lround(2.0 * cy + 1.0));
+  if (width < 2 || height < 2 || fx == 0.0 || fy == 0.0) {
+    return nullptr;
+  }
+
+  auto lut = std::make_shared<UndistortLut>();
+  lut->width = width;
+  lut->height = height;
+  lut->stride = std::max(1, options.stride);
+  for (;; ++lut->stride) {
+    if (lut->stride > kMaxStride) {
+      return nullptr;
+    }
+    lut->cols = GridCount(width, lut->stride);
+    lut->rows = GridCount(height, lut->stride);
+    if (lut->SizeBytes() <= options.memory_budget_bytes) {
+      break;
+    }
+  }
+  lut->inv_stride = 1.0 / lut->stride;
+
+  lut->storage.resize(static_cast<size_t>(lut->cols) * lut->rows * 2);
+  float* out = lut->storage.data();
+  for (int r = 0; r < lut->rows; ++r) {
+    const double yd = (static_cast<double>(r) * lut->stride - cy) / fy;
+    for (int c = 0; c < lut->cols; ++c) {
+      const double xd = (static_cast<double>(c) * lut->stride - cx) / fx;
+      double xu = 0.0;
+      double yu = 0.0;
+      if (!SolveUndistort(xd, yd, dist, xu, yu)) {
+        xu = std::nan("");
+        yu = std::nan("");
+      }
+      *out++ = static_cast<float>(xu);
+      *out++ = static_cast<float>(yu);
+    }
+  }
+  lut->data = lut->storage.data();
+  lut->max_residual = MeasureMaxResidual(*lut, fx, fy, cx, cy, dist);
+  return lut;
+}
+
+std::shared_ptr<const UndistortLut> LoadCachedUndistortLut(
+    double fx, double fy, double cx, double cy, const double dist[5],
+    const UndistortLutOptions& options) {
+  if (!options.enabled || options.cache_dir.empty()) {
+    return nullptr;
+  }
+  const LutCacheKey key = MakeCacheKey(fx, fy, cx, cy, dist, options);
+  std::shared_ptr<const MappedFile> file =
+      MappedFile::Open(CachePath(options, key));
+  if (file == nullptr || file->size() < kLutCacheDataOffset) {
+    return nullptr;
+  }
+  LutCacheHeader header;
+  std::memcpy(&header, file->data(), sizeof(header));
+  // The key is compared in full, so a hash collision is only a miss.
+  if (std::memcmp(header.magic, kLutCacheMagic, sizeof(header.magic)) != 0 ||
+      header.file_bytes != file->size() ||
+      std::memcmp(&header.key, &key, sizeof(key)) != 0 || header.cols < 2 ||
+      header.rows < 2 || header.stride < 1) {
+    return nullptr;
+  }
+  auto lut = std::make_shared<UndistortLut>();
+  lut->width = header.width;
+  lut->height = header.height;
+  lut->stride = header.stride;
+  lut->cols = header.cols;
+  lut->rows = header.rows;
+  lut->inv_stride = header.inv_stride;
+  lut->max_residual = header.max_residual;
+  if (file->size() - kLutCacheDataOffset != lut->SizeBytes() ||
+      CalibrationChecksum(file->data() + kLutCacheChecksumStart,
+                          file->size() - kLutCacheChecksumStart) !=
+          header.checksum) {
+    return nullptr;
+  }
+  lut->data =
+      reinterpret_cast<const float*>(file->data() + kLutCacheDataOffset);
+  lut->mapping = std::move(file);
+  return lut;
+}
+
+std::shared_ptr<const UndistortLut> LoadOrBuildUndistortLut(
+    double fx, double fy, double cx, double cy, const double dist[5],
+    const UndistortLutOptions& options) {
+  if (!options.enabled || options.cache_dir.empty()) {
+    return BuildUndistortLut(fx, fy, cx, cy, dist, options);
+  }
+  std::shared_ptr<const UndistortLut> lut =
+      LoadCachedUndistortLut(fx, fy, cx, cy, dist, options);
+  if (lut != nullptr) {
+    return lut;
+  }
+  lut = BuildUndistortLut(fx, fy, cx, cy, dist, options);
+  if (lut != nullptr) {
+    const LutCacheKey key = MakeCacheKey(fx, fy, cx, cy, dist, options);
+    StoreCachedLut(CachePath(options, key), key, *lut, options);
+  }
+  return lut;
+}
+
+}  // namespace roi_projector
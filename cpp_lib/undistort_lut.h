@@ -0,0 +1,125 @@
+// Dense undistortion lookup table for camera1.
+// Built by Projector in kFast so the projection hot path can replace
+// the iterative undistortion solve with a bilinear table fetch. Tables can
+// be kept in an on-disk cache and mapped instead of rebuilt.
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace roi_projector {
+
+struct UndistortLutOptions {
+  // Build or map a table when the projector enters kFast, the only mode
+  // that uses one (see UndistortMode); the other modes never build it.
+  bool enabled = true;
+  // camera1 image size in pixels; 0 derives it from the principal point
+  // (2 * c + 1), which matches the EpicEye 1920x1200 intrinsics.
+  int width = 0;
+  int height = 0;
+  // Requested grid spacing in pixels, grown until the table fits the budget.
+  // A table only serves the UndistortModes whose residual it meets (see
+  // UndistortLut::max_residual). With the test calibration, stride 2
+  // (4.6 MB) stays below 1e-6 and so serves kFast; stride 4 (1.2 MB) only
+  // below 3e-6, which no mode accepts.
+  int stride = 2;
+  size_t memory_budget_bytes = size_t{8} << 20;
+  // Directory of cached tables, created if missing; empty disables the
+  // cache. A table is stored under a hash of the camera1 intrinsics and
+  // distortion and of the options above, so a changed calibration or
+  // option never maps a stale table, and is mapped instead of rebuilt on
+  // the next load. Writing is best effort.
+  std::string cache_dir;
+  // A table missing from the cache is not built by LoadCalibration: the
+  // projector starts without one (per-point solve) until
+  // Projector::RebuildUndistortLut. SharedProjector::Load builds it on a
+  // background thread and republishes the calibration with it.
+  bool build_in_background = false;
+};
+
+// Undistorted normalized coordinates of camera1 sampled every `stride`
+// pixels, stored as interleaved float (x, y) pairs, row-major.
+// Nodes whose solve did not converge hold NaN.
+struct UndistortLut {
+  int width = 0;
+  int height = 0;
+  int stride = 1;
+  int cols = 0;
+  int rows = 0;
+  double inv_stride = 1.0;
+  // Largest distortion residual |D(lookup) - xd| of Sample, in normalized
+  // camera1 units, measured at build at every cell centre and edge
+  // midpoint. Projector uses the table only in the modes whose tolerance
+  // exceeds it, and never in kExact.
+  double max_residual = 0.0;
+  const float* data = nullptr;  // cols * rows * 2 floats
+  std::vector<float> storage;   // owns `data` when built in memory
+  // Keeps `data` mapped when loaded from a binary calibration file or the
+  // table cache.
+  std::shared_ptr<const void> mapping;
+
+  size_t SizeBytes() const noexcept {
+    return static_cast<size_t>(cols) * static_cast<size_t>(rows) * 2 *
+           sizeof(float);
+  }
+
+  // Bilinear lookup at camera1 pixel (u, v). Returns false outside the table
+  // or next to a node that did not converge; callers then solve directly.
+  bool Sample(double u, double v, double& xu, double& yu) const noexcept {
+    return SampleFor<void>(u, v, xu, yu);
+  }
+
+  // Sample, instantiated per `Lane`. The ISA kernels pass their lane type,
+  // which has internal linkage, so the copy they compile with ISA flags
+  // stays in their unit instead of becoming the shared Sample (see
+  // projection_kernel.h). Calls nothing, for the same reason.
+  template <class Lane>
+  bool SampleFor(double u, double v, double& xu, double& yu) const noexcept {
+    if (!(u >= 0.0 && v >= 0.0)) {
+      return false;
+    }
+    const double gx = u * inv_stride;
+    const double gy = v * inv_stride;
+    if (!(gx < cols - 1 && gy < rows - 1)) {
+      return false;
+    }
+    const int ix = static_cast<int>(gx);
+    const int iy = static_cast<int>(gy);
+    const double tx = gx - ix;
+    const double ty = gy - iy;
+    const float* p00 = data + (static_cast<size_t>(iy) * cols + ix) * 2;
+    const float* p10 = p00 + static_cast<size_t>(cols) * 2;
+    const double w00 = (1.0 - tx) * (1.0 - ty);
+    const double w01 = tx * (1.0 - ty);
+    const double w10 = (1.0 - tx) * ty;
+    const double w11 = tx * ty;
+    xu = w00 * p00[0] + w01 * p00[2] + w10 * p10[0] + w11 * p10[2];
+    yu = w00 * p00[1] + w01 * p00[3] + w10 * p10[1] + w11 * p10[3];
+    // x - x is 0 for finite x and NaN for inf/NaN.
+    return xu - xu == 0.0 && yu - yu == 0.0;
+  }
+};
+
+// Builds the table for intrinsics (fx, fy, cx, cy) and k1,k2,p1,p2,k3.
+// Returns null when disabled or when no stride fits the memory budget.
+std::shared_ptr<const UndistortLut> BuildUndistortLut(
+    double fx, double fy, double cx, double cy, const double dist[5],
+    const UndistortLutOptions& options);
+
+// The table BuildUndistortLut would return, mapped from options.cache_dir.
+// Null when disabled, without a cache directory, on a miss, or when the
+// cached file is damaged (checksum mismatch).
+std::shared_ptr<const UndistortLut> LoadCachedUndistortLut(
+    double fx, double fy, double cx, double cy, const double dist[5],
+    const UndistortLutOptions& options);
+
+// LoadCachedUndistortLut, or on a miss BuildUndistortLut with the result
+// stored in the cache. Without a cache directory, BuildUndistortLut.
+std::shared_ptr<const UndistortLut> LoadOrBuildUndistortLut(
+    double fx, double fy, double cx, double cy, const double dist[5],
+    const UndistortLutOptions& options);
+
+}  // namespace roi_projector